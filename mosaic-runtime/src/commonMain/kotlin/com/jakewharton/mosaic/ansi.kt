@@ -31,6 +31,11 @@ internal const val inBandResizeMode = 2048
 internal const val inBandResizeEnable = "$CSI?${inBandResizeMode}h"
 internal const val inBandResizeDisable = "$CSI?${inBandResizeMode}l"
 
+// https://sw.kovidgoyal.net/kitty/keyboard-protocol/#progressive-enhancement
+internal const val kittyKeyboardDisambiguateFlag = 1
+internal const val kittyKeyboardPushDisambiguate = "$CSI>${kittyKeyboardDisambiguateFlag}u"
+internal const val kittyKeyboardPop = "$CSI<u"
+
 internal const val ansiReset = "${CSI}0"
 internal const val clearLine = "${CSI}K"
 internal const val clearDisplay = "${CSI}J"
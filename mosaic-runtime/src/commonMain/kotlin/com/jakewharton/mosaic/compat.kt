@@ -1,35 +1,141 @@
 package com.jakewharton.mosaic
 
+import androidx.collection.mutableIntObjectMapOf
 import com.jakewharton.mosaic.layout.KeyEvent
 import com.jakewharton.mosaic.terminal.event.KeyboardEvent
+import com.jakewharton.mosaic.terminal.event.TextEvent
+import kotlin.concurrent.Volatile
+import kotlinx.coroutines.channels.ReceiveChannel
+import kotlinx.coroutines.delay
 
-internal fun KeyboardEvent.toKeyEventOrNull(): KeyEvent? {
+/** A source of key events which is drained by the composition once per frame. */
+internal interface KeyEventQueue {
+	/** Return the next [KeyEvent], or null if none are currently available. */
+	fun poll(): KeyEvent?
+}
+
+internal class ChannelKeyEventQueue(
+	private val channel: ReceiveChannel<KeyEvent>,
+) : KeyEventQueue {
+	override fun poll(): KeyEvent? = channel.tryReceive().getOrNull()
+}
+
+/**
+ * A single-producer, single-consumer queue of key presses stored as primitive records.
+ *
+ * The terminal event loop is the only producer and the frame listener is the only consumer.
+ * Records are converted to [KeyEvent]s only when polled, and those instances are interned so that
+ * steady-state input does not allocate.
+ */
+internal class KeyEventRing(
+	private val capacity: Int = 1024,
+) : KeyEventQueue {
+	init {
+		require(capacity > 0 && (capacity and (capacity - 1)) == 0) {
+			"Capacity must be a power of two: $capacity"
+		}
+	}
+
+	private val mask = capacity - 1
+
+	/** Pairs of (codepoint, modifiers) for each record. */
+	private val records = IntArray(capacity * 2)
+
+	/** Index of the next record to read. Only written by the consumer. */
+	@Volatile
+	private var head = 0
+
+	/** Index of the next record to write. Only written by the producer. */
+	@Volatile
+	private var tail = 0
+
+	/** Keyed by codepoint shifted left three bits and or'd with the shift, alt, and ctrl bits. */
+	private val keyEvents = mutableIntObjectMapOf<KeyEvent>()
+
+	/**
+	 * Enqueue a key press using a [KeyboardEvent] codepoint and modifiers. Returns false if the
+	 * ring is full.
+	 */
+	fun offer(codepoint: Int, modifiers: Int): Boolean {
+		val tail = tail
+		if (tail - head == capacity) return false
+		val index = (tail and mask) shl 1
+		records[index] = codepoint
+		records[index + 1] = modifiers
+		// Publish the record only after it has been written.
+		this.tail = tail + 1
+		return true
+	}
+
+	/** Enqueue a key press, suspending while the ring is full to let the consumer catch up. */
+	suspend fun send(codepoint: Int, modifiers: Int) {
+		while (!offer(codepoint, modifiers)) {
+			delay(1)
+		}
+	}
+
+	override fun poll(): KeyEvent? {
+		val head = head
+		if (head == tail) return null
+		val index = (head and mask) shl 1
+		val codepoint = records[index]
+		val modifiers = records[index + 1] and KeyModifierMask
+		this.head = head + 1
+
+		val key = (codepoint shl 3) or modifiers
+		return keyEvents.getOrPut(key) {
+			KeyEvent(
+				key = checkNotNull(keyName(codepoint)),
+				alt = (modifiers and KeyboardEvent.ModifierAlt) != 0,
+				ctrl = (modifiers and KeyboardEvent.ModifierCtrl) != 0,
+				shift = (modifiers and KeyboardEvent.ModifierShift) != 0,
+			)
+		}
+	}
+}
+
+/** The [KeyboardEvent] modifiers which are reflected in a [KeyEvent]. */
+private const val KeyModifierMask =
+	KeyboardEvent.ModifierShift or KeyboardEvent.ModifierAlt or KeyboardEvent.ModifierCtrl
+
+private val AsciiKeyNames = Array(127 - 32) { (it + 32).toChar().toString() }
+private val FunctionKeyNames = Array(57399 - 57364) { "F${it + 1}" }
+
+private fun keyName(codepoint: Int): String? {
+	return when (codepoint) {
+		9 -> "Tab"
+		13 -> "Enter"
+		27 -> "Escape"
+		in 32..126 -> AsciiKeyNames[codepoint - 32]
+		127 -> "Backspace"
+		57350 -> "ArrowLeft"
+		57351 -> "ArrowRight"
+		57352 -> "ArrowUp"
+		57353 -> "ArrowDown"
+		57348 -> "Insert"
+		57349 -> "Delete"
+		57354 -> "PageUp"
+		57355 -> "PageDown"
+		57356 -> "Home"
+		57357 -> "End"
+		in 57364..57398 -> FunctionKeyNames[codepoint - 57364]
+		else -> null
+	}
+}
+
+internal suspend fun KeyboardEvent.sendTo(keyEvents: KeyEventRing) {
 	if (eventType != KeyboardEvent.EventTypePress) {
-		return null
-	}
-
-	return KeyEvent(
-		key = when (val codepoint = codepoint) {
-			9 -> "Tab"
-			13 -> "Enter"
-			27 -> "Escape"
-			in 32..126 -> codepoint.toChar().toString()
-			127 -> "Backspace"
-			57350 -> "ArrowLeft"
-			57351 -> "ArrowRight"
-			57352 -> "ArrowUp"
-			57353 -> "ArrowDown"
-			57348 -> "Insert"
-			57349 -> "Delete"
-			57354 -> "PageUp"
-			57355 -> "PageDown"
-			57356 -> "Home"
-			57357 -> "End"
-			in 57364..57398 -> "F" + (codepoint - 57363)
-			else -> throw UnsupportedOperationException(toString())
-		},
-		alt = alt,
-		ctrl = ctrl,
-		shift = shift,
-	)
+		return
+	}
+	if (keyName(codepoint) == null) {
+		throw UnsupportedOperationException(toString())
+	}
+	keyEvents.send(codepoint, modifiers)
+}
+
+/** A [TextEvent] only contains printable ASCII, so each character maps directly to a key. */
+internal suspend fun TextEvent.sendTo(keyEvents: KeyEventRing) {
+	for (char in text) {
+		keyEvents.send(char.code, 0)
+	}
 }
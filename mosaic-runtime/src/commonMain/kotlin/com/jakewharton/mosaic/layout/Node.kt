@@ -98,6 +98,20 @@ internal class MosaicNode(
 	val children = ArrayList<MosaicNode>()
 	var staticState: StaticState? = null
 
+	var parent: MosaicNode? = null
+		private set
+
+	/** The number of [KeyLayer]s in this node's modifier chain. */
+	private var keyLayerCount = 0
+
+	/**
+	 * The number of [KeyLayer]s in this node and all of its descendants. Key dispatch uses this
+	 * only to prune subtrees without key handlers. It is not a focus index: every subtree which
+	 * has a handler is still visited in order until one consumes the event.
+	 */
+	var subtreeKeyLayerCount = 0
+		private set
+
 	private val bottomLayer: MosaicNodeLayer = BottomLayer(this)
 	var topLayer: MosaicNodeLayer = bottomLayer
 		private set
@@ -109,6 +123,7 @@ internal class MosaicNode(
 		private set
 
 	fun setModifier(modifier: Modifier) {
+		var keyLayerCount = 0
 		topLayer = modifier.foldOut(bottomLayer) { element, nextLayer ->
 			var nextLayer = nextLayer
 			// The Modifier class can inherit from several key Modifier types
@@ -121,6 +136,7 @@ internal class MosaicNode(
 			}
 			if (element is KeyModifier) {
 				nextLayer = KeyLayer(element, nextLayer)
+				keyLayerCount++
 			}
 			if (element is ParentDataModifier) {
 				parentData = element.modifyParentData(parentData)
@@ -130,6 +146,36 @@ internal class MosaicNode(
 			}
 			nextLayer
 		}
+		adjustSubtreeKeyLayerCount(keyLayerCount - this.keyLayerCount)
+		this.keyLayerCount = keyLayerCount
+	}
+
+	fun insertChild(index: Int, child: MosaicNode) {
+		child.parent = this
+		children.add(index, child)
+		adjustSubtreeKeyLayerCount(child.subtreeKeyLayerCount)
+	}
+
+	fun removeChildren(index: Int, count: Int) {
+		val removed = children.subList(index, index + count)
+		var keyLayerCount = 0
+		for (i in removed.indices) {
+			val child = removed[i]
+			child.parent = null
+			keyLayerCount += child.subtreeKeyLayerCount
+		}
+		removed.clear()
+		adjustSubtreeKeyLayerCount(-keyLayerCount)
+	}
+
+	/** Update [subtreeKeyLayerCount] of this node and its ancestors. This is O(depth). */
+	private fun adjustSubtreeKeyLayerCount(delta: Int) {
+		if (delta == 0) return
+		var node: MosaicNode? = this
+		while (node != null) {
+			node.subtreeKeyLayerCount += delta
+			node = node.parent
+		}
 	}
 
 	override fun measure(constraints: Constraints): Placeable =
@@ -172,12 +218,14 @@ internal class MosaicNode(
 				statics += child.paint()
 				child.paintStaticsTo(statics)
 			}
-			children.clear()
+			removeChildren(0, children.size)
 			this.staticState = null
 		}
 	}
 
 	fun sendKeyEvent(keyEvent: KeyEvent): Boolean {
+		// Prune this subtree since nothing in it handles key events.
+		if (subtreeKeyLayerCount == 0) return false
 		return topLayer.sendKeyEvent(keyEvent)
 	}
 
@@ -218,8 +266,10 @@ private class BottomLayer(
 	}
 
 	override fun sendKeyEvent(keyEvent: KeyEvent): Boolean {
-		for (child in node.children) {
-			if (child.sendKeyEvent(keyEvent)) {
+		val children = node.children
+		for (index in children.indices) {
+			val child = children[index]
+			if (child.subtreeKeyLayerCount != 0 && child.sendKeyEvent(keyEvent)) {
 				return true
 			}
 		}
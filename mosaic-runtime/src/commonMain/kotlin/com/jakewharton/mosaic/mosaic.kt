@@ -24,6 +24,7 @@ import androidx.lifecycle.compose.LocalLifecycleOwner
 import com.jakewharton.finalization.withFinalizationHook
 import com.jakewharton.mosaic.layout.KeyEvent
 import com.jakewharton.mosaic.layout.MosaicNode
+import com.jakewharton.mosaic.terminal.EventOverflow
 import com.jakewharton.mosaic.terminal.TerminalReader
 import com.jakewharton.mosaic.terminal.event.CapabilityQueryEvent
 import com.jakewharton.mosaic.terminal.event.DecModeReportEvent
@@ -38,6 +39,8 @@ import com.jakewharton.mosaic.terminal.event.OperatingStatusResponseEvent
 import com.jakewharton.mosaic.terminal.event.PrimaryDeviceAttributesEvent
 import com.jakewharton.mosaic.terminal.event.ResizeEvent
 import com.jakewharton.mosaic.terminal.event.SystemThemeEvent
+import com.jakewharton.mosaic.terminal.event.TextEvent
+import com.jakewharton.mosaic.tty.Tty
 import com.jakewharton.mosaic.ui.BoxMeasurePolicy
 import com.jakewharton.mosaic.ui.unit.IntSize
 import kotlin.concurrent.Volatile
@@ -52,7 +55,6 @@ import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.IO
 import kotlinx.coroutines.Job
 import kotlinx.coroutines.channels.Channel
-import kotlinx.coroutines.channels.Channel.Factory.UNLIMITED
 import kotlinx.coroutines.channels.consumeEach
 import kotlinx.coroutines.delay
 import kotlinx.coroutines.launch
@@ -72,12 +74,24 @@ private const val StageDefaultQueries = 1
 private const val StageNormalOperation = 0
 
 public suspend fun runMosaic(content: @Composable () -> Unit) {
-	val reader = TerminalReader()
+	runMosaic(Tty.bind(), rawMode = env("MOSAIC_RAW_MODE") != "false", content)
+}
+
+/**
+ * Run [content] reading input from and writing output to [tty], which will be closed on return.
+ */
+internal suspend fun runMosaic(tty: Tty, rawMode: Boolean, content: @Composable () -> Unit) {
+	// Bound memory if the composition stalls while input floods in. Keys are never discarded.
+	val reader = TerminalReader(tty, capacity = 1024, onOverflow = EventOverflow.Coalesce)
+	// Pastes and other bulk input are delivered as a single event per read rather than per byte.
+	reader.parser.emitTextEvents = true
+	// Only the latest of a burst of resize events matters since each one triggers a relayout.
+	reader.coalesceEvents = true
 
 	// Entering raw mode can fail, so perform it before any additional control sequences which change
 	// settings. We also need to be in character mode to query capabilities with control sequences.
-	if (env("MOSAIC_RAW_MODE") != "false") {
-		reader.tty.enableRawMode()
+	if (rawMode) {
+		tty.enableRawMode()
 	}
 
 	// Each of these will become true when their respective feature is recognized by the terminal
@@ -86,13 +100,15 @@ public suspend fun runMosaic(content: @Composable () -> Unit) {
 	var toggleFocus = false
 	var toggleInBandResize = false
 	var toggleSystemTheme = false
+	var toggleKittyKeyboard = false
 
 	withFinalizationHook(
 		hook = {
-			if (toggleSystemTheme) print(systemThemeDisable)
-			if (toggleInBandResize) print(inBandResizeDisable)
-			if (toggleFocus) print(focusDisable)
-			if (toggleCursor) print(cursorEnable)
+			if (toggleKittyKeyboard) tty.print(kittyKeyboardPop)
+			if (toggleSystemTheme) tty.print(systemThemeDisable)
+			if (toggleInBandResize) tty.print(inBandResizeDisable)
+			if (toggleFocus) tty.print(focusDisable)
+			if (toggleCursor) tty.print(cursorEnable)
 			reader.close()
 		},
 		block = {
@@ -100,10 +116,10 @@ public suspend fun runMosaic(content: @Composable () -> Unit) {
 				reader.runParseLoop()
 			}
 
-			val keyEvents = Channel<KeyEvent>(UNLIMITED)
+			val keyEvents = KeyEventRing()
 			val terminalState = mutableStateOf(Terminal.Default)
 
-			print("${CSI}0c")
+			tty.print("${CSI}0c")
 			var stage = StageDeviceAttributes
 
 			var supportsSynchronizedRendering = false
@@ -119,7 +135,7 @@ public suspend fun runMosaic(content: @Composable () -> Unit) {
 					for (event in reader.events) {
 						if (DebugBootstrap) {
 							if (stage != StageNormalOperation) {
-								print("$event\r\n")
+								tty.print("$event\r\n")
 							}
 						}
 						when (event) {
@@ -134,7 +150,7 @@ public suspend fun runMosaic(content: @Composable () -> Unit) {
 								}
 
 								stage = StageCapabilityQueries
-								print(
+								tty.print(
 									"$CSI?${cursorMode}\$p" +
 										"$CSI?${focusMode}\$p" +
 										"$CSI?${synchronizedRenderingMode}\$p" +
@@ -155,7 +171,7 @@ public suspend fun runMosaic(content: @Composable () -> Unit) {
 									cursorMode -> {
 										if (event.setting == Setting.Set) {
 											toggleCursor = true
-											print(cursorDisable)
+											tty.print(cursorDisable)
 										}
 									}
 									focusMode -> {
@@ -163,7 +179,7 @@ public suspend fun runMosaic(content: @Composable () -> Unit) {
 											toggleFocus = true
 											// Enabling focus notification _might_ trigger an initial event. There is
 											// otherwise no explicit way to request the initial value.
-											print(focusEnable)
+											tty.print(focusEnable)
 										}
 									}
 									synchronizedRenderingMode -> {
@@ -174,7 +190,7 @@ public suspend fun runMosaic(content: @Composable () -> Unit) {
 									systemThemeMode -> {
 										if (event.setting == Setting.Reset) {
 											toggleSystemTheme = true
-											print(
+											tty.print(
 												systemThemeEnable +
 													"$CSI?996n", // Current system theme query.
 											)
@@ -184,7 +200,7 @@ public suspend fun runMosaic(content: @Composable () -> Unit) {
 										if (event.setting == Setting.Reset) {
 											toggleInBandResize = true
 											// Enabling in-band resize will trigger an initial event.
-											print(inBandResizeEnable)
+											tty.print(inBandResizeEnable)
 										}
 									}
 								}
@@ -195,7 +211,7 @@ public suspend fun runMosaic(content: @Composable () -> Unit) {
 										// By enabling these modes (or by sending an explicit default value query after
 										// enabling the mode) wait for a reply about the default with a second DSR.
 										stage = StageDefaultQueries
-										print("${CSI}5n")
+										tty.print("${CSI}5n")
 									} else {
 										stage = StageNormalOperation
 										bootstrapDone.complete(Unit)
@@ -208,6 +224,13 @@ public suspend fun runMosaic(content: @Composable () -> Unit) {
 							is KittyKeyboardQueryEvent -> {
 								if (stage == StageCapabilityQueries) {
 									supportsKittyKeyboard = true
+									// With disambiguation, an Esc key press is always encoded as an escape sequence
+									// so the parser no longer needs to wait for bytes following a bare escape.
+									reader.parser.kittyDisambiguateEscapeCodes = true
+									if (!event.disambiguateEscapeCodes) {
+										toggleKittyKeyboard = true
+										tty.print(kittyKeyboardPushDisambiguate)
+									}
 								}
 							}
 							is KittyGraphicsEvent -> {
@@ -237,9 +260,10 @@ public suspend fun runMosaic(content: @Composable () -> Unit) {
 								terminalState.update { copy(focused = event.focused) }
 							}
 							is KeyboardEvent -> {
-								event.toKeyEventOrNull()?.let {
-									keyEvents.trySend(it)
-								}
+								event.sendTo(keyEvents)
+							}
+							is TextEvent -> {
+								event.sendTo(keyEvents)
 							}
 							is ResizeEvent -> {
 								terminalState.update { copy(size = IntSize(event.columns, event.rows)) }
@@ -265,18 +289,18 @@ public suspend fun runMosaic(content: @Composable () -> Unit) {
 				bootstrapDone.await()
 			}
 			if (DebugBootstrap) {
-				print("\r\n")
+				tty.print("\r\n")
 			}
 
 			if (!toggleInBandResize) {
 				terminalState.update {
 					copy(
-						size = reader.tty.currentSize().let { (columns, rows) ->
+						size = tty.currentSize().let { (columns, rows) ->
 							IntSize(columns, rows)
 						},
 					)
 				}
-				reader.tty.enableWindowResizeEvents()
+				tty.enableWindowResizeEvents()
 			}
 
 			val ansiLevel = detectAnsiLevel()
@@ -286,7 +310,7 @@ public suspend fun runMosaic(content: @Composable () -> Unit) {
 				AnsiRendering(ansiLevel, supportsSynchronizedRendering, supportsKittyUnderlines)
 			}
 
-			runMosaicComposition(rendering, keyEvents, terminalState, content)
+			runMosaicComposition(tty, rendering, keyEvents, terminalState, content)
 
 			eventJob.cancel()
 		},
@@ -294,8 +318,9 @@ public suspend fun runMosaic(content: @Composable () -> Unit) {
 }
 
 internal suspend fun runMosaicComposition(
+	tty: Tty,
 	rendering: Rendering,
-	keyEvents: Channel<KeyEvent>,
+	keyEvents: KeyEventQueue,
 	terminalState: MutableState<Terminal>,
 	content: @Composable () -> Unit,
 ) {
@@ -303,7 +328,7 @@ internal suspend fun runMosaicComposition(
 	val mosaicComposition = MosaicComposition(
 		coroutineContext = coroutineContext + clock,
 		onDraw = { rootNode ->
-			print(rendering.render(rootNode).toString())
+			tty.print(rendering.render(rootNode).toString())
 		},
 		keyEvents = keyEvents,
 		terminalState = terminalState,
@@ -326,6 +351,15 @@ internal suspend fun runMosaicComposition(
 	mosaicComposition.awaitComplete()
 }
 
+/** Write all of [text] to the output stream, retrying partial writes. */
+private fun Tty.print(text: String) {
+	val bytes = text.encodeToByteArray()
+	var offset = 0
+	while (offset < bytes.size) {
+		offset += writeOutput(bytes, offset, bytes.size - offset)
+	}
+}
+
 internal inline fun <T> MutableState<T>.update(updater: T.() -> T) {
 	value = value.updater()
 }
@@ -354,13 +388,13 @@ public fun Mosaic(
 	keyEvents: Channel<KeyEvent>,
 	terminalState: State<Terminal>,
 ): Mosaic {
-	return MosaicComposition(coroutineContext, onDraw, keyEvents, terminalState)
+	return MosaicComposition(coroutineContext, onDraw, ChannelKeyEventQueue(keyEvents), terminalState)
 }
 
 internal class MosaicComposition(
 	coroutineContext: CoroutineContext,
 	private val onDraw: (Mosaic) -> Unit,
-	private val keyEvents: Channel<KeyEvent>,
+	private val keyEvents: KeyEventQueue,
 	private val terminalState: State<Terminal>,
 ) : Mosaic,
 	LifecycleOwner {
@@ -471,7 +505,7 @@ internal class MosaicComposition(
 				externalClock.withFrameNanos { nanos ->
 					// Drain any pending key events before triggering the frame.
 					while (true) {
-						val keyEvent = keyEvents.tryReceive().getOrNull() ?: break
+						val keyEvent = keyEvents.poll() ?: break
 						val keyHandled = rootNode.sendKeyEvent(keyEvent)
 						if (!keyHandled && keyEvent == ctrlC) {
 							job.cancel()
@@ -556,11 +590,11 @@ internal class MosaicNodeApplier(
 	}
 
 	override fun insertBottomUp(index: Int, instance: MosaicNode) {
-		current.children.add(index, instance)
+		current.insertChild(index, instance)
 	}
 
 	override fun remove(index: Int, count: Int) {
-		current.children.remove(index, count)
+		current.removeChildren(index, count)
 	}
 
 	override fun move(from: Int, to: Int, count: Int) {
@@ -1,5 +1,6 @@
 package com.jakewharton.mosaic.text
 
+import androidx.collection.MutableObjectIntMap
 import androidx.compose.runtime.Immutable
 import androidx.compose.runtime.Stable
 import com.jakewharton.mosaic.text.AnnotatedString.Builder
@@ -99,26 +100,21 @@ public class AnnotatedString internal constructor(
 	 */
 	public class Builder(capacity: Int = 16) : Appendable {
 
-		private data class MutableRange<T>(
-			val item: T,
-			val start: Int,
-			var end: Int = Int.MIN_VALUE,
-		) {
-			/**
-			 * Create an immutable [Range] object.
-			 *
-			 * @param defaultEnd if the end is not set yet, it will be set to this value.
-			 */
-			fun toRange(defaultEnd: Int = Int.MIN_VALUE): Range<T> {
-				val end = if (end == Int.MIN_VALUE) defaultEnd else end
-				check(end != Int.MIN_VALUE) { "Item.end should be set first" }
-				return Range(item = item, start = start, end = end)
-			}
-		}
-
 		private val text = StringBuilder(capacity)
-		private val spanStyles = ArrayList<MutableRange<SpanStyle>>()
-		private val styleStack = ArrayList<MutableRange<out Any>>()
+
+		/** Packed (style index, start, end) triples. An unset end is [Int.MIN_VALUE]. */
+		private var ranges = IntArray(RANGE_FIELDS * 4)
+		private var rangeCount = 0
+
+		/** Distinct styles referenced by index from [ranges]. */
+		private val styles = ArrayList<SpanStyle>()
+
+		/** Index of each style in [styles]. */
+		private val styleIndices = MutableObjectIntMap<SpanStyle>()
+
+		/** Indices into [ranges] of pushed styles which have not yet been popped. */
+		private var styleStack = IntArray(4)
+		private var styleStackSize = 0
 
 		/**
 		 * Create an [Builder] instance using the given [String].
@@ -232,7 +228,7 @@ public class AnnotatedString internal constructor(
 		 * @param end the exclusive end offset of the range
 		 */
 		public fun addStyle(style: SpanStyle, start: Int, end: Int) {
-			spanStyles.add(MutableRange(item = style, start = start, end = end))
+			addRange(style, start, end)
 		}
 
 		/**
@@ -242,11 +238,12 @@ public class AnnotatedString internal constructor(
 		 * @param style SpanStyle to be applied
 		 */
 		public fun pushStyle(style: SpanStyle): Int {
-			MutableRange(item = style, start = text.length).also {
-				styleStack.add(it)
-				spanStyles.add(it)
+			val rangeIndex = addRange(style, text.length, Int.MIN_VALUE)
+			if (styleStackSize == styleStack.size) {
+				styleStack = styleStack.copyOf(styleStackSize * 2)
 			}
-			return styleStack.size - 1
+			styleStack[styleStackSize++] = rangeIndex
+			return styleStackSize - 1
 		}
 
 		/**
@@ -255,10 +252,10 @@ public class AnnotatedString internal constructor(
 		 * @see pushStyle
 		 */
 		public fun pop() {
-			check(styleStack.isNotEmpty()) { "Nothing to pop." }
+			check(styleStackSize > 0) { "Nothing to pop." }
 			// pop the last element
-			val item = styleStack.removeAt(styleStack.size - 1)
-			item.end = text.length
+			val rangeIndex = styleStack[--styleStackSize]
+			ranges[rangeIndex * RANGE_FIELDS + 2] = text.length
 		}
 
 		/**
@@ -271,8 +268,8 @@ public class AnnotatedString internal constructor(
 		 * @see pushStyle
 		 */
 		public fun pop(index: Int) {
-			check(index < styleStack.size) { "$index should be less than ${styleStack.size}" }
-			while ((styleStack.size - 1) >= index) {
+			check(index < styleStackSize) { "$index should be less than $styleStackSize" }
+			while ((styleStackSize - 1) >= index) {
 				pop()
 			}
 		}
@@ -281,16 +278,61 @@ public class AnnotatedString internal constructor(
 		 * Constructs an [AnnotatedString] based on the configurations applied to the [Builder].
 		 */
 		public fun toAnnotatedString(): AnnotatedString {
+			val length = text.length
+			val spanStyles = if (rangeCount == 0) {
+				null
+			} else {
+				val ranges = ranges
+				List(rangeCount) { rangeIndex ->
+					val offset = rangeIndex * RANGE_FIELDS
+					val end = ranges[offset + 2]
+					Range(
+						item = styles[ranges[offset]],
+						start = ranges[offset + 1],
+						end = if (end == Int.MIN_VALUE) length else end,
+					)
+				}
+			}
 			return AnnotatedString(
 				text = text.toString(),
-				spanStylesOrNull = spanStyles
-					.map { it.toRange(text.length) }
-					.ifEmpty { null },
+				spanStylesOrNull = spanStyles,
 			)
 		}
+
+		/**
+		 * Remove all text and styles from this [Builder] so that it can be reused to build another
+		 * [AnnotatedString]. Internal storage is retained to avoid re-allocating it.
+		 */
+		public fun clear() {
+			text.clear()
+			rangeCount = 0
+			styles.clear()
+			styleIndices.clear()
+			styleStackSize = 0
+		}
+
+		private fun addRange(style: SpanStyle, start: Int, end: Int): Int {
+			// Identical styles are common (e.g., syntax highlighting) so only retain one instance.
+			val styleIndex = styleIndices.getOrPut(style) {
+				styles.add(style)
+				styles.size - 1
+			}
+
+			val rangeIndex = rangeCount++
+			val offset = rangeIndex * RANGE_FIELDS
+			if (offset == ranges.size) {
+				ranges = ranges.copyOf(offset * 2)
+			}
+			ranges[offset] = styleIndex
+			ranges[offset + 1] = start
+			ranges[offset + 2] = end
+			return rangeIndex
+		}
 	}
 }
 
+private const val RANGE_FIELDS = 3
+
 /**
  * Helper function used to find the [SpanStyle]s in the given range and also convert the
  * range of those [SpanStyle]s to local range.
@@ -0,0 +1,73 @@
+package com.jakewharton.mosaic.text
+
+import androidx.compose.runtime.Stable
+import androidx.compose.runtime.getValue
+import androidx.compose.runtime.mutableIntStateOf
+import androidx.compose.runtime.setValue
+
+/**
+ * An append-only buffer of lines intended for tail-style log views.
+ *
+ * Lines are stored in fixed-size chunks so that appending is amortized O(1) regardless of how
+ * many lines are already present, and lookup by index is O(1). Pair with the
+ * [Text][com.jakewharton.mosaic.ui.Text] overload which accepts a [LineBuffer] to only measure
+ * and draw the lines which are visible.
+ *
+ * Reads of [lineCount] and [get] are observed, so appending to a buffer from a composition's
+ * coroutine will trigger a re-layout of any [Text][com.jakewharton.mosaic.ui.Text] displaying it.
+ * This class is not thread-safe.
+ */
+@Stable
+public class LineBuffer {
+	private val chunks = ArrayList<Array<String?>>()
+
+	/** The number of lines in this buffer. */
+	public var lineCount: Int by mutableIntStateOf(0)
+		private set
+
+	/** Return the line at [index] which must be in the range [0, [lineCount]). */
+	public operator fun get(index: Int): String {
+		val lineCount = lineCount
+		if (index < 0 || index >= lineCount) {
+			throw IndexOutOfBoundsException("index: $index, lineCount: $lineCount")
+		}
+		return chunks[index ushr CHUNK_SHIFT][index and CHUNK_MASK]!!
+	}
+
+	/**
+	 * Append [value] as a new line. Each `\n` in [value] starts an additional line, matching
+	 * the behavior of `Text` for a `String` containing newlines.
+	 */
+	public fun appendLine(value: String) {
+		var count = lineCount
+		var start = 0
+		while (true) {
+			val end = value.indexOf('\n', start)
+			count = appendInternal(count, if (end == -1) value.substring(start) else value.substring(start, end))
+			if (end == -1) break
+			start = end + 1
+		}
+		lineCount = count
+	}
+
+	/** Remove all lines from this buffer. */
+	public fun clear() {
+		chunks.clear()
+		lineCount = 0
+	}
+
+	private fun appendInternal(index: Int, line: String): Int {
+		val chunkIndex = index ushr CHUNK_SHIFT
+		if (chunkIndex == chunks.size) {
+			chunks += arrayOfNulls<String>(CHUNK_SIZE)
+		}
+		chunks[chunkIndex][index and CHUNK_MASK] = line
+		return index + 1
+	}
+
+	override fun toString(): String = "LineBuffer(lineCount=$lineCount)"
+}
+
+private const val CHUNK_SHIFT = 10
+private const val CHUNK_SIZE = 1 shl CHUNK_SHIFT
+private const val CHUNK_MASK = CHUNK_SIZE - 1
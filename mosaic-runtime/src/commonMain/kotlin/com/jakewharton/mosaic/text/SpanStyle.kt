@@ -28,13 +28,35 @@ public class SpanStyle(
 	 */
 	@Stable
 	public fun merge(other: SpanStyle? = null): SpanStyle {
-		if (other == null) return this
+		if (other == null || other === this) return this
+		val color = other.color.takeOrElse { this.color }
+		val background = other.background.takeOrElse { this.background }
+		val textStyle = other.textStyle.takeOrElse { this.textStyle }
+		val underlineStyle = other.underlineStyle.takeOrElse { this.underlineStyle }
+		val underlineColor = other.underlineColor.takeOrElse { this.underlineColor }
+		// Avoid allocating when the result is identical to either input.
+		if (color == this.color &&
+			background == this.background &&
+			textStyle == this.textStyle &&
+			underlineStyle == this.underlineStyle &&
+			underlineColor == this.underlineColor
+		) {
+			return this
+		}
+		if (color == other.color &&
+			background == other.background &&
+			textStyle == other.textStyle &&
+			underlineStyle == other.underlineStyle &&
+			underlineColor == other.underlineColor
+		) {
+			return other
+		}
 		return SpanStyle(
-			color = other.color.takeOrElse { this.color },
-			background = other.background.takeOrElse { this.background },
-			textStyle = other.textStyle.takeOrElse { this.textStyle },
-			underlineStyle = other.underlineStyle.takeOrElse { this.underlineStyle },
-			underlineColor = other.underlineColor.takeOrElse { this.underlineColor },
+			color = color,
+			background = background,
+			textStyle = textStyle,
+			underlineStyle = underlineStyle,
+			underlineColor = underlineColor,
 		)
 	}
 
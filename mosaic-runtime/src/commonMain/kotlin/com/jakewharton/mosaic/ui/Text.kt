@@ -8,7 +8,9 @@ import com.jakewharton.mosaic.layout.drawBehind
 import com.jakewharton.mosaic.modifier.Modifier
 import com.jakewharton.mosaic.text.AnnotatedString
 import com.jakewharton.mosaic.text.AnnotatedStringTextLayout
+import com.jakewharton.mosaic.text.LineBuffer
 import com.jakewharton.mosaic.text.StringTextLayout
+import de.cketti.codepoints.codePointCount
 import kotlin.jvm.JvmName
 
 @Composable
@@ -70,3 +72,61 @@ public fun Text(
 		},
 	)
 }
+
+/**
+ * Display the lines of a [LineBuffer].
+ *
+ * When the incoming height is bounded, only the last lines which fit are measured and drawn,
+ * so the cost of each frame is proportional to the visible window rather than the size of
+ * the buffer.
+ */
+@Composable
+@MosaicComposable
+public fun Text(
+	value: LineBuffer,
+	modifier: Modifier = Modifier,
+	color: Color = Color.Unspecified,
+	background: Color = Color.Unspecified,
+	textStyle: TextStyle = TextStyle.Unspecified,
+	underlineStyle: UnderlineStyle = UnderlineStyle.Unspecified,
+	underlineColor: Color = Color.Unspecified,
+) {
+	val window = remember { LineBufferWindow() }
+
+	Layout(
+		content = EmptyLineBufferContent,
+		debugInfo = {
+			"Text($value)"
+		},
+		measurePolicy = { _, constraints ->
+			val lineCount = value.lineCount
+			val height = if (constraints.hasBoundedHeight) {
+				minOf(lineCount, constraints.maxHeight)
+			} else {
+				lineCount
+			}
+			val start = lineCount - height
+			var width = 0
+			for (index in start until lineCount) {
+				val line = value[index]
+				width = maxOf(width, line.codePointCount(0, line.length))
+			}
+			window.start = start
+			window.end = lineCount
+			layout(width, height) {}
+		},
+		modifier = modifier.drawBehind {
+			val start = window.start
+			for (index in start until window.end) {
+				drawText(index - start, 0, value[index], color, background, textStyle, underlineStyle, underlineColor)
+			}
+		},
+	)
+}
+
+private val EmptyLineBufferContent: @Composable () -> Unit = {}
+
+private class LineBufferWindow {
+	var start = 0
+	var end = 0
+}
@@ -0,0 +1,78 @@
+package com.jakewharton.mosaic
+
+import assertk.assertThat
+import assertk.assertions.isEqualTo
+import assertk.assertions.isFalse
+import assertk.assertions.isNull
+import assertk.assertions.isSameInstanceAs
+import assertk.assertions.isTrue
+import com.jakewharton.mosaic.layout.KeyEvent
+import com.jakewharton.mosaic.terminal.event.KeyboardEvent
+import com.jakewharton.mosaic.terminal.event.KeyboardEvent.Companion.ModifierCtrl
+import com.jakewharton.mosaic.terminal.event.KeyboardEvent.Companion.ModifierShift
+import com.jakewharton.mosaic.terminal.event.TextEvent
+import kotlin.test.Test
+import kotlinx.coroutines.test.runTest
+
+class KeyEventRingTest {
+	private val ring = KeyEventRing(capacity = 4)
+
+	@Test fun emptyPollReturnsNull() {
+		assertThat(ring.poll()).isNull()
+	}
+
+	@Test fun pollReturnsInOrder() {
+		ring.offer('a'.code, 0)
+		ring.offer('b'.code, ModifierCtrl)
+		ring.offer(13, ModifierShift)
+
+		assertThat(ring.poll()).isEqualTo(KeyEvent("a"))
+		assertThat(ring.poll()).isEqualTo(KeyEvent("b", ctrl = true))
+		assertThat(ring.poll()).isEqualTo(KeyEvent("Enter", shift = true))
+		assertThat(ring.poll()).isNull()
+	}
+
+	@Test fun offerFailsWhenFull() {
+		repeat(4) {
+			assertThat(ring.offer('a'.code, 0)).isTrue()
+		}
+		assertThat(ring.offer('a'.code, 0)).isFalse()
+
+		ring.poll()
+		assertThat(ring.offer('b'.code, 0)).isTrue()
+	}
+
+	@Test fun wrapsAround() {
+		repeat(10) {
+			ring.offer('a'.code + it, 0)
+			assertThat(ring.poll()).isEqualTo(KeyEvent(('a'.code + it).toChar().toString()))
+		}
+	}
+
+	@Test fun keyEventsAreInterned() {
+		ring.offer(57364, 0)
+		ring.offer(57364, 0)
+
+		val first = ring.poll()
+		assertThat(first).isEqualTo(KeyEvent("F1"))
+		assertThat(ring.poll()).isSameInstanceAs(first)
+	}
+
+	@Test fun keyboardEventReleaseIgnored() = runTest {
+		KeyboardEvent('a'.code, eventType = KeyboardEvent.EventTypeRelease).sendTo(ring)
+		assertThat(ring.poll()).isNull()
+	}
+
+	@Test fun keyboardEventUnsupportedThrows() = runTest {
+		assertFailure<UnsupportedOperationException> {
+			KeyboardEvent(0x1F600).sendTo(ring)
+		}
+	}
+
+	@Test fun textEventSendsEachCharacter() = runTest {
+		TextEvent("hi").sendTo(ring)
+		assertThat(ring.poll()).isEqualTo(KeyEvent("h"))
+		assertThat(ring.poll()).isEqualTo(KeyEvent("i"))
+		assertThat(ring.poll()).isNull()
+	}
+}
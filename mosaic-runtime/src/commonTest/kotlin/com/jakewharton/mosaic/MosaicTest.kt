@@ -19,6 +19,7 @@ import com.jakewharton.mosaic.layout.size
 import com.jakewharton.mosaic.layout.width
 import com.jakewharton.mosaic.modifier.Modifier
 import com.jakewharton.mosaic.testing.runMosaicTest
+import com.jakewharton.mosaic.tty.TestTty
 import com.jakewharton.mosaic.ui.AnsiLevel
 import com.jakewharton.mosaic.ui.Box
 import com.jakewharton.mosaic.ui.Filler
@@ -26,7 +27,6 @@ import com.jakewharton.mosaic.ui.Spacer
 import com.jakewharton.mosaic.ui.Text
 import com.jakewharton.mosaic.ui.unit.IntOffset
 import kotlin.test.Test
-import kotlinx.coroutines.channels.Channel
 import kotlinx.coroutines.delay
 import kotlinx.coroutines.test.runTest
 
@@ -105,21 +105,24 @@ class MosaicTest {
 		var frameTimeA = 0L
 		var frameTimeB = 0L
 
-		runMosaicComposition(
-			rendering = AnsiRendering(
-				ansiLevel = AnsiLevel.NONE,
-				synchronizedRendering = false,
-				supportsKittyUnderlines = false,
-			),
-			keyEvents = Channel(),
-			terminalState = mutableStateOf(Terminal.Default),
-		) {
-			LaunchedEffect(Unit) {
-				withFrameNanos { frameTimeNanos ->
-					frameTimeA = frameTimeNanos
-				}
-				withFrameNanos { frameTimeNanos ->
-					frameTimeB = frameTimeNanos
+		TestTty.create().use { testTty ->
+			runMosaicComposition(
+				tty = testTty.tty,
+				rendering = AnsiRendering(
+					ansiLevel = AnsiLevel.NONE,
+					synchronizedRendering = false,
+					supportsKittyUnderlines = false,
+				),
+				keyEvents = KeyEventRing(),
+				terminalState = mutableStateOf(Terminal.Default),
+			) {
+				LaunchedEffect(Unit) {
+					withFrameNanos { frameTimeNanos ->
+						frameTimeA = frameTimeNanos
+					}
+					withFrameNanos { frameTimeNanos ->
+						frameTimeB = frameTimeNanos
+					}
 				}
 			}
 		}
@@ -2,9 +2,16 @@ package com.jakewharton.mosaic
 
 import androidx.compose.runtime.Applier
 import assertk.assertThat
+import assertk.assertions.containsExactly
 import assertk.assertions.isEqualTo
+import assertk.assertions.isNull
+import assertk.assertions.isTrue
 import com.jakewharton.mosaic.layout.DebugPolicy
+import com.jakewharton.mosaic.layout.KeyEvent
 import com.jakewharton.mosaic.layout.MosaicNode
+import com.jakewharton.mosaic.layout.onKeyEvent
+import com.jakewharton.mosaic.layout.onPreviewKeyEvent
+import com.jakewharton.mosaic.modifier.Modifier
 import com.jakewharton.mosaic.ui.NodeFactory
 import kotlin.test.Test
 
@@ -183,6 +190,59 @@ class NodeApplierTest {
 		assertChildren(three, four, one, two)
 	}
 
+	@Test fun keyLayerCountTracksInsertAndRemove() {
+		val one = textNode("one")
+		one.setModifier(Modifier.onKeyEvent { false })
+		applier.insert(0, one)
+		val two = textNode("two")
+		applier.insert(1, two)
+		assertThat(applier.root.subtreeKeyLayerCount).isEqualTo(1)
+
+		applier.down(two)
+		val three = textNode("three")
+		three.setModifier(Modifier.onPreviewKeyEvent { false }.onKeyEvent { false })
+		applier.insert(0, three)
+		applier.up()
+		assertThat(two.subtreeKeyLayerCount).isEqualTo(2)
+		assertThat(applier.root.subtreeKeyLayerCount).isEqualTo(3)
+
+		applier.remove(0, 1)
+		assertThat(applier.root.subtreeKeyLayerCount).isEqualTo(2)
+		assertThat(one.parent).isNull()
+
+		applier.remove(0, 1)
+		assertThat(applier.root.subtreeKeyLayerCount).isEqualTo(0)
+	}
+
+	@Test fun keyLayerCountTracksModifierChanges() {
+		val one = textNode("one")
+		applier.insert(0, one)
+		one.setModifier(Modifier.onKeyEvent { false })
+		assertThat(applier.root.subtreeKeyLayerCount).isEqualTo(1)
+		one.setModifier(Modifier.onKeyEvent { false }.onKeyEvent { false })
+		assertThat(applier.root.subtreeKeyLayerCount).isEqualTo(2)
+		one.setModifier(Modifier)
+		assertThat(applier.root.subtreeKeyLayerCount).isEqualTo(0)
+	}
+
+	@Test fun keyEventSkipsSubtreesWithoutHandlers() {
+		val events = mutableListOf<String>()
+		val one = textNode("one")
+		applier.insert(0, one)
+		val two = textNode("two")
+		two.setModifier(Modifier.onKeyEvent { events += "two"; false })
+		applier.insert(1, two)
+		val three = textNode("three")
+		three.setModifier(Modifier.onKeyEvent { events += "three"; true })
+		applier.insert(2, three)
+		val four = textNode("four")
+		four.setModifier(Modifier.onKeyEvent { events += "four"; true })
+		applier.insert(3, four)
+
+		assertThat(applier.root.sendKeyEvent(KeyEvent("a"))).isTrue()
+		assertThat(events).containsExactly("two", "three")
+	}
+
 	private fun assertChildren(vararg nodes: MosaicNode) {
 		assertThat(applier.root.children).isEqualTo(nodes.toList())
 	}
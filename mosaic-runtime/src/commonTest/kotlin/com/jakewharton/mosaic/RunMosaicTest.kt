@@ -0,0 +1,51 @@
+package com.jakewharton.mosaic
+
+import assertk.assertThat
+import assertk.assertions.contains
+import assertk.assertions.isEqualTo
+import com.jakewharton.mosaic.tty.TestTty
+import com.jakewharton.mosaic.ui.Text
+import kotlin.test.Test
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.test.runTest
+import kotlinx.coroutines.withContext
+
+class RunMosaicTest {
+	@Test fun rendersToTty() = runTest {
+		TestTty.create().use { testTty ->
+			// Replies to the bootstrap queries from a terminal which supports in-band resize events.
+			testTty.writeInput(
+				"${CSI}?62c" + // Primary device attributes
+					"${CSI}?2048;2\$y" + // In-band resize mode is reset
+					"${CSI}0n" + // Capability queries done
+					"${CSI}48;24;80;0;0t" + // Initial in-band resize event
+					"${CSI}0n", // Default queries done
+			)
+
+			// The bootstrap waits on input read from another thread, so it cannot use virtual time.
+			withContext(Dispatchers.Default) {
+				runMosaic(testTty.tty, rawMode = false) {
+					Text("Hello")
+				}
+			}
+
+			assertThat(testTty.readOutput()).contains("Hello")
+		}
+	}
+
+	private fun TestTty.writeInput(data: String) {
+		val bytes = data.encodeToByteArray()
+		assertThat(writeInput(bytes, 0, bytes.size)).isEqualTo(bytes.size)
+	}
+
+	private fun TestTty.readOutput(): String {
+		val output = StringBuilder()
+		val buffer = ByteArray(8192)
+		while (true) {
+			val read = readOutput(buffer, 0, buffer.size)
+			if (read == 0) break
+			output.append(buffer.decodeToString(endIndex = read))
+		}
+		return output.toString()
+	}
+}
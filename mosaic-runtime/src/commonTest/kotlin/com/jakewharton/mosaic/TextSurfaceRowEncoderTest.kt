@@ -0,0 +1,151 @@
+package com.jakewharton.mosaic
+
+import assertk.assertThat
+import assertk.assertions.isEqualTo
+import com.jakewharton.mosaic.tty.RowEncoder
+import com.jakewharton.mosaic.ui.AnsiLevel
+import com.jakewharton.mosaic.ui.Color
+import com.jakewharton.mosaic.ui.TextStyle
+import com.jakewharton.mosaic.ui.UnderlineStyle
+import com.jakewharton.mosaic.ui.isUnspecifiedColor
+import kotlin.test.Test
+
+/** Asserts that [RowEncoder] produces the same output as [TextSurface.appendRowTo]. */
+class TextSurfaceRowEncoderTest {
+	private val surface = TextSurface(width = 8, height = 6).apply {
+		// Plain text with trailing blanks.
+		"hello".forEachIndexed { column, char -> this[0, column].codePoint = char.code }
+
+		// Colors which change mid-row, including a trailing styled blank.
+		"colors".forEachIndexed { column, char ->
+			val pixel = this[1, column]
+			pixel.codePoint = char.code
+			pixel.foreground = if (column < 3) Color.Red else Color.Blue
+			pixel.background = if (column % 2 == 0) Color(16, 32, 48) else Color.Unspecified
+		}
+		this[1, 7].background = Color.Green
+
+		// Text styles toggling on and off.
+		val styles = listOf(
+			TextStyle.Bold,
+			TextStyle.Bold + TextStyle.Italic,
+			TextStyle.Dim,
+			TextStyle.Empty,
+			TextStyle.Invert + TextStyle.Strikethrough,
+			TextStyle.Strikethrough,
+		)
+		styles.forEachIndexed { column, style ->
+			val pixel = this[2, column]
+			pixel.codePoint = 'a'.code + column
+			pixel.textStyle = style
+		}
+
+		// Every underline style along with underline colors.
+		val underlines = listOf(
+			UnderlineStyle.Straight,
+			UnderlineStyle.Double,
+			UnderlineStyle.Curly,
+			UnderlineStyle.Dotted,
+			UnderlineStyle.Dashed,
+			UnderlineStyle.None,
+			UnderlineStyle.Straight,
+		)
+		underlines.forEachIndexed { column, underline ->
+			val pixel = this[3, column]
+			pixel.codePoint = 'A'.code + column
+			pixel.underlineStyle = underline
+			pixel.underlineColor = if (column in 2..3) Color.Magenta else Color.Unspecified
+		}
+
+		// Non-ASCII code points.
+		intArrayOf(0xE9, 0x1F600, 0x4E2D, 'x'.code).forEachIndexed { column, codePoint ->
+			val pixel = this[4, column]
+			pixel.codePoint = codePoint
+			pixel.foreground = if (codePoint == 'x'.code) Color.Unspecified else Color.Yellow
+		}
+
+		// Row 5 is entirely blank.
+	}
+
+	@Test fun ansiNone() {
+		assertParity(AnsiLevel.NONE, supportsKittyUnderlines = false)
+	}
+
+	@Test fun ansi16() {
+		assertParity(AnsiLevel.ANSI16, supportsKittyUnderlines = false)
+	}
+
+	@Test fun ansi256() {
+		assertParity(AnsiLevel.ANSI256, supportsKittyUnderlines = false)
+	}
+
+	@Test fun truecolor() {
+		assertParity(AnsiLevel.TRUECOLOR, supportsKittyUnderlines = false)
+	}
+
+	@Test fun truecolorKittyUnderlines() {
+		assertParity(AnsiLevel.TRUECOLOR, supportsKittyUnderlines = true)
+	}
+
+	private fun assertParity(ansiLevel: AnsiLevel, supportsKittyUnderlines: Boolean) {
+		var flags = 0
+		if (ansiLevel == AnsiLevel.NONE) flags = flags or RowEncoder.FlagPlain
+		if (supportsKittyUnderlines) flags = flags or RowEncoder.FlagKittyUnderlines
+
+		val width = surface.width
+		val codePoints = IntArray(width)
+		val attributes = IntArray(width * RowEncoder.AttributeCount)
+		val output = ByteArray(RowEncoder.maxSize(width))
+		for (row in 0 until surface.height) {
+			for (column in 0 until width) {
+				val pixel = surface[row, column]
+				codePoints[column] = pixel.codePoint
+				val cell = column * RowEncoder.AttributeCount
+				attributes[cell + RowEncoder.ForegroundIndex] = pixel.foreground.toRowColor(ansiLevel)
+				attributes[cell + RowEncoder.BackgroundIndex] = pixel.background.toRowColor(ansiLevel)
+				attributes[cell + RowEncoder.UnderlineColorIndex] = pixel.underlineColor.toRowColor(ansiLevel)
+				attributes[cell + RowEncoder.StyleIndex] = pixel.toRowStyle()
+			}
+			val written = RowEncoder.encode(codePoints, attributes, 0, width, flags, output, 0)
+
+			val expected = buildString { surface.appendRowTo(this, row, ansiLevel, supportsKittyUnderlines) }
+			assertThat(output.decodeToString(endIndex = written), "row $row").isEqualTo(expected)
+		}
+	}
+
+	private fun Color.toRowColor(ansiLevel: AnsiLevel): Int {
+		if (isUnspecifiedColor) return RowEncoder.UnspecifiedColor
+		return when (ansiLevel) {
+			AnsiLevel.ANSI16 -> {
+				val code = toAnsi16Code()
+				if (code == ansiFgColorReset || code == ansiBgColorReset) {
+					RowEncoder.UnspecifiedColor
+				} else {
+					RowEncoder.ansi16Color(code)
+				}
+			}
+			AnsiLevel.ANSI256 -> RowEncoder.ansi256Color(toAnsi256Code())
+			// Colors are not encoded without ANSI support, but are still not blank.
+			AnsiLevel.NONE, AnsiLevel.TRUECOLOR -> RowEncoder.rgbColor(redInt, greenInt, blueInt)
+		}
+	}
+
+	private fun TextPixel.toRowStyle(): Int {
+		var style = 0
+		if (TextStyle.Bold in textStyle) style = style or RowEncoder.Bold
+		if (TextStyle.Dim in textStyle) style = style or RowEncoder.Dim
+		if (TextStyle.Italic in textStyle) style = style or RowEncoder.Italic
+		if (TextStyle.Invert in textStyle) style = style or RowEncoder.Invert
+		if (TextStyle.Strikethrough in textStyle) style = style or RowEncoder.Strikethrough
+		val underline = when (underlineStyle) {
+			UnderlineStyle.None -> RowEncoder.UnderlineNone
+			UnderlineStyle.Straight -> RowEncoder.UnderlineStraight
+			UnderlineStyle.Double -> RowEncoder.UnderlineDouble
+			UnderlineStyle.Curly -> RowEncoder.UnderlineCurly
+			UnderlineStyle.Dotted -> RowEncoder.UnderlineDotted
+			UnderlineStyle.Dashed -> RowEncoder.UnderlineDashed
+			else -> RowEncoder.UnderlineUnspecified
+		}
+		return RowEncoder.style(style, underline)
+	}
+}
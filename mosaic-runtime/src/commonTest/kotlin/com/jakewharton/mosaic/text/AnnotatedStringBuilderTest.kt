@@ -6,6 +6,7 @@ import assertk.assertions.hasSize
 import assertk.assertions.isEmpty
 import assertk.assertions.isEqualTo
 import assertk.assertions.isInstanceOf
+import assertk.assertions.isSameInstanceAs
 import com.jakewharton.mosaic.text.AnnotatedString.Range
 import com.jakewharton.mosaic.ui.Color
 import com.jakewharton.mosaic.ui.TextStyle
@@ -578,6 +579,48 @@ class AnnotatedStringBuilderTest {
 		assertThat(buildResult2).isEqualTo(expectedResult)
 	}
 
+	@Test fun clear_allowsReuse() {
+		val builder = AnnotatedString.Builder()
+		builder.pushStyle(SpanStyle(color = Color.Red))
+		builder.append("ab")
+
+		builder.clear()
+		builder.append("cd")
+		builder.addStyle(SpanStyle(color = Color.Blue), 0, 1)
+
+		val expected = AnnotatedString.Builder("cd").apply {
+			addStyle(SpanStyle(color = Color.Blue), 0, 1)
+		}.toAnnotatedString()
+		assertThat(builder.toAnnotatedString()).isEqualTo(expected)
+		assertFailure { builder.pop() }.isInstanceOf<IllegalStateException>()
+	}
+
+	@Test fun identicalStylesAreInterned() {
+		val annotatedString = with(AnnotatedString.Builder("abc")) {
+			addStyle(SpanStyle(color = Color.Red), 0, 1)
+			addStyle(SpanStyle(color = Color.Red), 2, 3)
+			toAnnotatedString()
+		}
+
+		val spanStyles = annotatedString.spanStyles
+		assertThat(spanStyles).hasSize(2)
+		assertThat(spanStyles[1].item).isSameInstanceAs(spanStyles[0].item)
+	}
+
+	@Test fun manyNestedStyles() {
+		val annotatedString = with(AnnotatedString.Builder()) {
+			repeat(20) {
+				pushStyle(SpanStyle(color = Color.Red))
+				append('a')
+			}
+			pop(0)
+			toAnnotatedString()
+		}
+
+		assertThat(annotatedString.spanStyles).hasSize(20)
+		assertThat(annotatedString.spanStyles[19]).isEqualTo(Range(SpanStyle(color = Color.Red), 19, 20))
+	}
+
 	private fun createAnnotatedString(
 		text: String,
 		color: Color = Color.Red,
@@ -0,0 +1,100 @@
+package com.jakewharton.mosaic.text
+
+import assertk.assertThat
+import assertk.assertions.isEqualTo
+import com.jakewharton.mosaic.layout.height
+import com.jakewharton.mosaic.modifier.Modifier
+import com.jakewharton.mosaic.render
+import com.jakewharton.mosaic.testing.MosaicSnapshots
+import com.jakewharton.mosaic.testing.runMosaicTest
+import com.jakewharton.mosaic.ui.Text
+import kotlin.test.Test
+import kotlin.test.assertFailsWith
+import kotlinx.coroutines.test.runTest
+
+class LineBufferTest {
+	@Test fun emptyByDefault() {
+		val buffer = LineBuffer()
+		assertThat(buffer.lineCount).isEqualTo(0)
+		assertFailsWith<IndexOutOfBoundsException> { buffer[0] }
+	}
+
+	@Test fun appendLine() {
+		val buffer = LineBuffer()
+		buffer.appendLine("one")
+		buffer.appendLine("two")
+		assertThat(buffer.lineCount).isEqualTo(2)
+		assertThat(buffer[0]).isEqualTo("one")
+		assertThat(buffer[1]).isEqualTo("two")
+	}
+
+	@Test fun appendLineSplitsOnNewlines() {
+		val buffer = LineBuffer()
+		buffer.appendLine("one\ntwo\n")
+		assertThat(buffer.lineCount).isEqualTo(3)
+		assertThat(buffer[0]).isEqualTo("one")
+		assertThat(buffer[1]).isEqualTo("two")
+		assertThat(buffer[2]).isEqualTo("")
+	}
+
+	@Test fun appendAcrossChunks() {
+		val buffer = LineBuffer()
+		repeat(5_000) {
+			buffer.appendLine(it.toString())
+		}
+		assertThat(buffer.lineCount).isEqualTo(5_000)
+		assertThat(buffer[0]).isEqualTo("0")
+		assertThat(buffer[1023]).isEqualTo("1023")
+		assertThat(buffer[1024]).isEqualTo("1024")
+		assertThat(buffer[4_999]).isEqualTo("4999")
+		assertFailsWith<IndexOutOfBoundsException> { buffer[5_000] }
+	}
+
+	@Test fun clear() {
+		val buffer = LineBuffer()
+		buffer.appendLine("one")
+		buffer.clear()
+		assertThat(buffer.lineCount).isEqualTo(0)
+		buffer.appendLine("two")
+		assertThat(buffer[0]).isEqualTo("two")
+	}
+
+	@Test fun textDrawsAllLinesWhenUnbounded() = runTest {
+		runMosaicTest(MosaicSnapshots) {
+			val buffer = LineBuffer()
+			buffer.appendLine("one\ntwo\nthree")
+			setContent {
+				Text(buffer)
+			}
+
+			assertThat(awaitSnapshot().paint().render()).isEqualTo("one\ntwo\nthree")
+		}
+	}
+
+	@Test fun textDrawsTailWindowWhenBounded() = runTest {
+		runMosaicTest(MosaicSnapshots) {
+			val buffer = LineBuffer()
+			buffer.appendLine("one\ntwo\nthree")
+			setContent {
+				Text(buffer, modifier = Modifier.height(2))
+			}
+
+			assertThat(awaitSnapshot().paint().render()).isEqualTo("two\nthree")
+		}
+	}
+
+	@Test fun textUpdatesOnAppend() = runTest {
+		runMosaicTest(MosaicSnapshots) {
+			val buffer = LineBuffer()
+			buffer.appendLine("zero\none")
+			setContent {
+				Text(buffer, modifier = Modifier.height(2))
+			}
+			assertThat(awaitSnapshot().paint().render()).isEqualTo("zero\none")
+
+			buffer.appendLine("two")
+			buffer.appendLine("three")
+			assertThat(awaitSnapshot().paint().render()).isEqualTo("two\nthree")
+		}
+	}
+}
@@ -2,8 +2,10 @@ package com.jakewharton.mosaic.text
 
 import assertk.assertThat
 import assertk.assertions.isEqualTo
+import assertk.assertions.isSameInstanceAs
 import com.jakewharton.mosaic.ui.Color
 import com.jakewharton.mosaic.ui.TextStyle
+import com.jakewharton.mosaic.ui.UnderlineStyle
 import kotlin.test.Test
 
 class SpanStyleTest {
@@ -48,6 +50,29 @@ class SpanStyleTest {
 		assertThat(newSpanStyle).isEqualTo(style)
 	}
 
+	@Test fun mergeWithUnspecifiedOtherReturnsThisInstance() {
+		val style = SpanStyle(color = Color.Red)
+
+		val newSpanStyle = style.merge(SpanStyle())
+
+		assertThat(newSpanStyle).isSameInstanceAs(style)
+	}
+
+	@Test fun mergeWithFullySpecifiedOtherReturnsOtherInstance() {
+		val style = SpanStyle(color = Color.Red)
+		val otherStyle = SpanStyle(
+			color = Color.Blue,
+			background = Color.Green,
+			textStyle = TextStyle.Bold,
+			underlineStyle = UnderlineStyle.Straight,
+			underlineColor = Color.Red,
+		)
+
+		val newSpanStyle = style.merge(otherStyle)
+
+		assertThat(newSpanStyle).isSameInstanceAs(otherStyle)
+	}
+
 	@Test fun mergeWithOthersColorIsNullShouldUseThisColor() {
 		val style = SpanStyle(color = Color.Red)
 
@@ -0,0 +1,61 @@
+package com.jakewharton.mosaic.terminal
+
+/**
+ * Tracks how long the bytes of an escape sequence take to arrive after its first read, and uses
+ * that to choose how long to wait for bytes following a lone escape before treating it as an
+ * <kbd>Esc</kbd> key press.
+ *
+ * A local terminal delivers each sequence in a single read, whereas a remote connection may split
+ * one across reads separated by the network's burst timing. Only the most recent [SampleCount]
+ * sequences are considered so that the timeout follows a change in connection.
+ */
+internal class EscapeGapEstimator {
+	private val samples = IntArray(SampleCount)
+	private var sampleIndex = 0
+	private var sampleSize = 0
+
+	/** Reusable storage for sorting [samples]. */
+	private val sorted = IntArray(SampleCount)
+
+	/** Record the largest gap in microseconds between reads which contributed to one sequence. */
+	fun record(gapMicros: Int) {
+		samples[sampleIndex] = gapMicros
+		sampleIndex = (sampleIndex + 1) % SampleCount
+		if (sampleSize < SampleCount) {
+			sampleSize++
+		}
+	}
+
+	/** The 99th percentile gap in microseconds, or -1 if too few sequences have been seen. */
+	fun p99Micros(): Int {
+		val size = sampleSize
+		if (size < MinimumSampleCount) return -1
+
+		val sorted = sorted
+		samples.copyInto(sorted, endIndex = size)
+		sorted.sort(toIndex = size)
+		return sorted[(size * 99 + 99) / 100 - 1]
+	}
+
+	/**
+	 * The time in milliseconds to wait for a byte following a lone escape. This is [Multiplier]
+	 * times the [99th percentile gap][p99Micros] bounded by [FloorMillis] and [CeilingMillis], or
+	 * [CeilingMillis] until enough sequences have been seen.
+	 */
+	fun timeoutMillis(): Int {
+		val p99Micros = p99Micros()
+		if (p99Micros == -1) return CeilingMillis
+		val millis = (p99Micros.toLong() * Multiplier + 999) / 1000
+		return millis.coerceIn(FloorMillis.toLong(), CeilingMillis.toLong()).toInt()
+	}
+
+	override fun toString(): String = "EscapeGapEstimator(p99Micros=${p99Micros()})"
+
+	internal companion object {
+		const val SampleCount = 128
+		const val MinimumSampleCount = 16
+		const val Multiplier = 4
+		const val FloorMillis = 10
+		const val CeilingMillis = 100
+	}
+}
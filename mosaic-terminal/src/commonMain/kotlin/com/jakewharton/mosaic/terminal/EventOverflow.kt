@@ -0,0 +1,31 @@
+package com.jakewharton.mosaic.terminal
+
+import com.jakewharton.mosaic.terminal.event.BracketedPasteEvent
+import com.jakewharton.mosaic.terminal.event.BracketedPasteTextEvent
+import com.jakewharton.mosaic.terminal.event.KeyboardEvent
+import com.jakewharton.mosaic.terminal.event.TextEvent
+
+/**
+ * The behavior of a [TerminalReader] when its [events][TerminalReader.events] buffer is full.
+ *
+ * Events which may be discarded are those which are superseded by later events of the same kind
+ * such as mouse, resize, and focus events. [KeyboardEvent]s, [TextEvent]s, bracketed paste events
+ * ([BracketedPasteEvent] and [BracketedPasteTextEvent]), and responses to queries are never
+ * discarded.
+ */
+public enum class EventOverflow {
+	/** Block the reader until the consumer receives an event. */
+	Block,
+
+	/**
+	 * Discard the oldest buffered event which may be discarded. If there is no such event, the
+	 * new event is discarded if it may be, otherwise the reader blocks.
+	 */
+	DropOldest,
+
+	/**
+	 * Replace adjacent buffered mouse motion and resize events with the latest of each run, and
+	 * then behave like [DropOldest] if that did not free any space.
+	 */
+	Coalesce,
+}
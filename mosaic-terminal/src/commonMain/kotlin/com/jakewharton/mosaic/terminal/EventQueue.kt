@@ -0,0 +1,164 @@
+package com.jakewharton.mosaic.terminal
+
+import com.jakewharton.mosaic.terminal.event.Event
+import com.jakewharton.mosaic.terminal.event.FocusEvent
+import com.jakewharton.mosaic.terminal.event.MouseEvent
+import com.jakewharton.mosaic.terminal.event.ResizeEvent
+import com.jakewharton.mosaic.terminal.event.UnknownEvent
+import kotlinx.coroutines.channels.Channel
+import kotlinx.coroutines.channels.ReceiveChannel
+import kotlinx.coroutines.channels.trySendBlocking
+
+/**
+ * A channel of events with an [EventOverflow] policy applied when it reaches its capacity.
+ *
+ * Events are sent from the parse loop and from [com.jakewharton.mosaic.tty.Tty.Callback], which
+ * may run on another thread such as that of a [com.jakewharton.mosaic.tty.TtyReactor], so all
+ * sends are serialized by a spin lock which is only ever held briefly.
+ */
+internal class EventQueue(
+	capacity: Int,
+	private val overflow: EventOverflow,
+) {
+	private val channel = Channel<Event>(capacity)
+	private val lock = atomicBooleanOf(false)
+	private val dropped = atomicLongOf(0L)
+	private val coalesced = atomicLongOf(0L)
+
+	/**
+	 * An upper bound on the number of events in [channel] which may be dropped or coalesced.
+	 * Receiving only lowers the true count, so when this is zero a full channel is not drained.
+	 * Guarded by [lock].
+	 */
+	private var droppableCount = 0
+
+	/** Reusable storage for events removed from [channel] while making room. Guarded by [lock]. */
+	private val pending = ArrayList<Event>()
+
+	val events: ReceiveChannel<Event> get() = channel
+
+	val droppedCount: Long get() = dropped.get()
+	val coalescedCount: Long get() = coalesced.get()
+
+	fun recordCoalesced() {
+		coalesced.incrementAndGet()
+	}
+
+	/** Send [event] from the parse loop, blocking if required by [overflow]. */
+	fun send(event: Event) {
+		if (!offer(event)) {
+			channel.trySendBlocking(event)
+		}
+	}
+
+	/**
+	 * Send [event] from a callback without blocking for room, discarding it if the channel is full
+	 * and [overflow] cannot make room.
+	 */
+	fun trySend(event: Event) {
+		if (!offer(event)) {
+			dropped.incrementAndGet()
+		}
+	}
+
+	private fun offer(event: Event): Boolean {
+		while (!lock.compareAndSet(false, true)) {
+			// Only contended by another sender which holds the lock briefly.
+		}
+		try {
+			return offerLocked(event)
+		} finally {
+			lock.set(false)
+		}
+	}
+
+	/** @return false if [event] could not be sent without blocking. */
+	private fun offerLocked(event: Event): Boolean {
+		if (trySendLocked(event)) return true
+		if (overflow == EventOverflow.Block) return false
+		if (droppableCount == 0) return dropIfDroppable(event)
+
+		// Channels cannot remove elements from the middle, so take them all out and put back those
+		// which remain. The consumer can only observe the order in which they are received.
+		val pending = pending
+		while (true) {
+			pending += channel.tryReceive().getOrNull() ?: break
+		}
+		val size = pending.size
+		if (overflow == EventOverflow.Coalesce) {
+			coalesceAdjacent(pending)
+		}
+		if (pending.size == size) {
+			val index = pending.indexOfFirst { it.isDroppable() }
+			if (index != -1) {
+				pending.removeAt(index)
+				dropped.incrementAndGet()
+			}
+		}
+		droppableCount = 0
+		for (i in pending.indices) {
+			trySendLocked(pending[i])
+		}
+		pending.clear()
+
+		if (trySendLocked(event)) return true
+		return dropIfDroppable(event)
+	}
+
+	private fun trySendLocked(event: Event): Boolean {
+		if (!channel.trySend(event).isSuccess) return false
+		if (event.isDroppable()) {
+			droppableCount++
+		}
+		return true
+	}
+
+	private fun dropIfDroppable(event: Event): Boolean {
+		if (event.isDroppable()) {
+			dropped.incrementAndGet()
+			return true
+		}
+		return false
+	}
+
+	private fun coalesceAdjacent(events: ArrayList<Event>) {
+		var write = 0
+		for (read in events.indices) {
+			val event = events[read]
+			if (write > 0) {
+				val previous = events[write - 1]
+				if (previous.isCoalescable() && previous.isCoalescableWith(event)) {
+					events[write - 1] = event
+					coalesced.incrementAndGet()
+					continue
+				}
+			}
+			events[write++] = event
+		}
+		while (events.size > write) {
+			events.removeAt(events.lastIndex)
+		}
+	}
+}
+
+internal fun Event.isCoalescable(): Boolean {
+	return this is ResizeEvent ||
+		(this is MouseEvent && (type == MouseEvent.Type.Motion || type == MouseEvent.Type.Drag))
+}
+
+internal fun Event.isCoalescableWith(other: Event): Boolean {
+	return when (this) {
+		is ResizeEvent -> other is ResizeEvent
+		is MouseEvent -> other is MouseEvent &&
+			other.type == type &&
+			other.button == button &&
+			other.shift == shift &&
+			other.alt == alt &&
+			other.ctrl == ctrl
+		else -> false
+	}
+}
+
+private fun Event.isDroppable(): Boolean {
+	return this is MouseEvent || this is ResizeEvent || this is FocusEvent || this is UnknownEvent
+}
@@ -5,10 +5,9 @@ import com.jakewharton.mosaic.terminal.event.Event
 import com.jakewharton.mosaic.terminal.event.FocusEvent
 import com.jakewharton.mosaic.terminal.event.ResizeEvent
 import com.jakewharton.mosaic.tty.Tty
-import kotlinx.coroutines.channels.SendChannel
 
-internal class EventChannelTtyCallback(
-	private val events: SendChannel<Event>,
+internal class EventQueueTtyCallback(
+	private val events: EventQueue,
 	private val emitDebugEvents: Boolean,
 ) : Tty.Callback {
 	override fun onFocus(focused: Boolean) {
@@ -28,6 +27,8 @@ internal class EventChannelTtyCallback(
 	}
 
 	private fun sendEvent(event: Event) {
+		// Callbacks may be invoked on a reactor thread which serves other instances, so they must
+		// not wait for the consumer to make room.
 		events.trySend(event)
 		if (emitDebugEvents) {
 			events.trySend(DebugEvent(event, byteArrayOf()))
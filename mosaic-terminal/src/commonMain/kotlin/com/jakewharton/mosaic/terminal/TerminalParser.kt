@@ -1,6 +1,7 @@
 package com.jakewharton.mosaic.terminal
 
 import com.jakewharton.mosaic.terminal.event.BracketedPasteEvent
+import com.jakewharton.mosaic.terminal.event.BracketedPasteTextEvent
 import com.jakewharton.mosaic.terminal.event.CapabilityQueryEvent
 import com.jakewharton.mosaic.terminal.event.DecModeReportEvent
 import com.jakewharton.mosaic.terminal.event.Event
@@ -16,31 +17,75 @@ import com.jakewharton.mosaic.terminal.event.OperatingStatusResponseEvent
 import com.jakewharton.mosaic.terminal.event.PaletteColorEvent
 import com.jakewharton.mosaic.terminal.event.PrimaryDeviceAttributesEvent
 import com.jakewharton.mosaic.terminal.event.ResizeEvent
+import com.jakewharton.mosaic.terminal.event.StringSequenceChunkEvent
 import com.jakewharton.mosaic.terminal.event.SystemThemeEvent
 import com.jakewharton.mosaic.terminal.event.TerminalColorEvent
 import com.jakewharton.mosaic.terminal.event.TerminalVersionEvent
 import com.jakewharton.mosaic.terminal.event.TertiaryDeviceAttributesEvent
+import com.jakewharton.mosaic.terminal.event.TextEvent
 import com.jakewharton.mosaic.terminal.event.UnknownEvent
 import com.jakewharton.mosaic.terminal.event.XtermCharacterSizeEvent
 import com.jakewharton.mosaic.terminal.event.XtermPixelSizeEvent
 import com.jakewharton.mosaic.tty.Tty
 import kotlin.concurrent.Volatile
+import kotlin.time.TimeSource
 
 public class TerminalParser(
 	private val tty: Tty,
 ) {
 	private companion object {
 		private const val BufferSize = 8 * 1024
-		private const val BareEscapeDisambiguationReadTimeoutMillis = 100
+
+		/** `CSI 201 ~` */
+		private val BracketedPasteEnd = byteArrayOf(0x1B, 0x5B, 0x32, 0x30, 0x31, 0x7E)
 	}
 
 	private val buffer = ByteArray(BufferSize)
 	private var offset = 0
 	private var limit = 0
 
+	/** True when between bracketed paste markers and [streamBracketedPaste] was enabled. */
+	private var inBracketedPaste = false
+
+	/**
+	 * The byte following the escape of a string sequence which did not fit in [buffer] and whose
+	 * remaining payload is being streamed as [StringSequenceChunkEvent]s, or 0.
+	 */
+	private var streamingStringIntroducer = 0
+
+	/**
+	 * Distance from the start of a partially-received string sequence before which no string
+	 * terminator exists. This allows searches to resume after each read rather than rescan.
+	 */
+	private var stringTerminatorSearchOffset = 0
+
+	/** Like [stringTerminatorSearchOffset], but for the BEL which may also end some sequences. */
+	private var bellSearchOffset = 0
+
+	/**
+	 * True when a sequence which did not fit in [buffer] was reported as an [UnknownEvent] and its
+	 * remaining bytes are being discarded through its final byte by [stateMachine].
+	 */
+	private var discardingSequence = false
+
+	/** Finds escape sequence boundaries when [scanWithStateMachine] is enabled. */
+	private val stateMachine = VtStateMachine()
+
+	/** Chooses the timeout of the read which disambiguates a bare escape. */
+	private val escapeGaps = EscapeGapEstimator()
+
+	/**
+	 * The largest gap in microseconds between reads which have contributed to the escape sequence at
+	 * the start of the buffer, or 0 if it has arrived in a single read.
+	 */
+	private var escapeGapMicros = 0
+
 	@TestApi
 	internal fun copyBuffer() = buffer.copyOfRange(offset, limit)
 
+	/** True when bytes from a previous read have yet to be parsed by [next]. */
+	internal fun hasBufferedInput() = offset < limit
+
 	/**
 	 * Indicate whether Kitty's
 	 * [escape code disambiguation](https://sw.kovidgoyal.net/kitty/keyboard-protocol/#disambiguate-escape-codes)
@@ -68,6 +113,61 @@ public class TerminalParser(
 	@Volatile
 	public var xtermExtendedUtf8Mouse: Boolean = false
 
+	/**
+	 * Indicate whether runs of printable ASCII should be reported as a single [TextEvent].
+	 *
+	 * Normally, each character is parsed into its own [KeyboardEvent]. Large inputs such as a paste
+	 * will then produce one event per byte. Setting this property to true causes contiguous runs of
+	 * two or more printable ASCII bytes to instead produce one [TextEvent] per read.
+	 */
+	@Volatile
+	public var emitTextEvents: Boolean = false
+
+	/**
+	 * Indicate whether text between bracketed paste markers should be reported as
+	 * [BracketedPasteTextEvent]s.
+	 *
+	 * Normally, pasted text is parsed like any other input which produces keyboard events for each
+	 * character. Setting this property to true causes all bytes following a
+	 * [BracketedPasteEvent] start to be delivered verbatim in one or more chunks until the
+	 * corresponding [BracketedPasteEvent] end. Escape sequences within the paste are not
+	 * interpreted, and the paste does not need to fit in the parser's buffer.
+	 */
+	@Volatile
+	public var streamBracketedPaste: Boolean = false
+
+	/**
+	 * Indicate whether the end of each escape sequence should be found using a table-driven state
+	 * machine before it is parsed.
+	 *
+	 * Normally, an incomplete escape sequence is searched again from its start after every read.
+	 * Setting this property to true causes each byte of a sequence to be examined only once, no
+	 * matter how many reads it spans, which benefits long sequences such as OSC and DCS responses
+	 * arriving in small reads. The same events are produced, except that an OSC sequence is always
+	 * terminated by its first BEL rather than preferring a later `ESC \` in the same read.
+	 */
+	@Volatile
+	public var scanWithStateMachine: Boolean = false
+
+	/**
+	 * The 99th percentile time in microseconds between reads which each contained part of the same
+	 * escape sequence, measured over recent sequences, or -1 if too few sequences have been seen.
+	 * A sequence which arrived in a single read counts as 0.
+	 *
+	 * This is intended for diagnostics, and is computed on each call.
+	 */
+	public val escapeSequenceGapMicros: Int get() = escapeGaps.p99Micros()
+
+	/**
+	 * The time in milliseconds which the parser will currently wait for more bytes after a bare
+	 * escape (`0x1b`) before reporting an <kbd>Esc</kbd> key press.
+	 *
+	 * This is a small multiple of [escapeSequenceGapMicros] bounded to between 10 and 100
+	 * milliseconds, or 100 milliseconds until enough escape sequences have been seen. It is not
+	 * used when [kittyDisambiguateEscapeCodes] is enabled.
+	 */
+	public val bareEscapeTimeoutMillis: Int get() = escapeGaps.timeoutMillis()
+
 	/**
 	 * A version of [next] which also returns the bytes that produced the event.
 	 *
@@ -107,29 +207,54 @@ public class TerminalParser(
 			limit -= offset
 			offset = 0
 
-			if (kittyDisambiguateEscapeCodes || limit != 1 || buffer[0] != 0x1B.toByte()) {
-				// Common case: we are using the Kitty keyboard protocol to disambiguate escape keys, or
-				// the buffer contains anything other than a bare escape. Do a normal read for more data.
+			if (limit == BufferSize) {
+				// The buffer is full of a single incomplete sequence. Drain it rather than performing an
+				// empty read which would otherwise be indistinguishable from an interrupt.
+				return parseOverflow(buffer)
+			}
+
+			if (kittyDisambiguateEscapeCodes ||
+				inBracketedPaste ||
+				streamingStringIntroducer != 0 ||
+				limit != 1 ||
+				buffer[0] != 0x1B.toByte()
+			) {
+				// Common case: we are using the Kitty keyboard protocol to disambiguate escape keys, we are
+				// inside a paste or string where escapes are not keys, or the buffer contains anything
+				// other than a bare escape. Do a normal read for more data.
+				// Only time reads which continue a sequence past its introducer. The byte after a lone
+				// escape may be typed by the user as an Alt-modified key.
+				val continuingEscape = limit > 1 &&
+					buffer[0] == 0x1B.toByte() &&
+					!inBracketedPaste &&
+					streamingStringIntroducer == 0
+				val readStart = if (continuingEscape) TimeSource.Monotonic.markNow() else null
 				val read = tty.readInput(buffer, limit, BufferSize - limit)
 				if (read == -1) break // EOF
 				if (read == 0) return null // Interrupt
 
+				if (readStart != null) {
+					recordEscapeGap(readStart)
+				}
 				limit += read
 				continue
 			}
 
 			// Otherwise, perform a quick read to see if we have any more bytes. This will allow us to
 			// determine whether the bare escape was truly a legacy keyboard escape event, or just the
-			// start of some other escape sequence.
+			// start of some other escape sequence. This gap is not sampled since it may be the user
+			// typing an Alt-modified key.
 			val read = tty.readInputWithTimeout(
 				buffer,
 				1,
 				BufferSize - 1,
-				BareEscapeDisambiguationReadTimeoutMillis,
+				escapeGaps.timeoutMillis(),
 			)
 			if (read == 0) {
 				// We know the offset is 0, so resetting the limit effectively consumes the byte.
 				limit = 0
+				stateMachine.reset()
+				escapeGapMicros = 0
 				return KeyboardEvent(0x1B)
 			}
 			if (read == -1) break // EOF
@@ -151,32 +276,71 @@ public class TerminalParser(
 	 * or `null` if a full sequence was not available before reaching [limit].
 	 */
 	private fun tryParse(buffer: ByteArray, start: Int, limit: Int): Event? {
+		if (inBracketedPaste) {
+			return parseBracketedPaste(buffer, start, limit)
+		}
+		if (streamingStringIntroducer != 0) {
+			return parseStringChunk(buffer, start, limit)
+		}
+		if (discardingSequence) {
+			return discardSequence(buffer, start, limit)
+		}
+
 		val b1 = buffer[start].toInt() and 0xff
 		if (b1 == 0x1B) {
-			val b2Index = start + 1
-			// If this escape is at the end of the buffer, request another read to ensure we can
-			// differentiate between a bare escape and one starting a sequence. Note: The caller is
-			// expected to handle the case of a bare escape, as we will otherwise endlessly return null.
-			if (b2Index == limit) return null
-
-			when (val b2 = buffer[b2Index].toInt()) {
-				0x4F -> return parseSs3(buffer, start, limit)
-				0x50 -> return parseDcs(buffer, start, limit)
-				0x58 -> return parseSos(buffer, start, limit)
-				0x5B -> return parseCsi(buffer, start, limit)
-				0x5D -> return parseOsc(buffer, start, limit)
-				0x5E -> return parsePm(buffer, start, limit)
-				0x5F -> return parseApc(buffer, start, limit)
-				else -> {
-					offset = start + 2
-					return KeyboardEvent(b2, modifiers = KeyboardEvent.ModifierAlt)
+			val event = if (scanWithStateMachine) {
+				val end = stateMachine.scan(buffer, start, limit, xtermExtendedUtf8Mouse)
+				if (end == -1) return null
+				// The sequence is complete, so more bytes cannot help a parse which needs them.
+				parseEscape(buffer, start, end) ?: run {
+					offset = end
+					UnknownEvent(buffer.copyOfRange(start, end))
+				}
+			} else {
+				stateMachine.reset()
+				parseEscape(buffer, start, limit)
+			}
+			if (event != null) {
+				// Sequences are at least three bytes. Two bytes are an escape and an Alt-modified key
+				// whose timing is the user's rather than the terminal's, so it is not sampled.
+				if (offset - start > 2) {
+					escapeGaps.record(escapeGapMicros)
 				}
+				escapeGapMicros = 0
 			}
+			return event
 		} else {
 			return parseGround(buffer, start, limit, b1)
 		}
 	}
 
+	private fun recordEscapeGap(readStart: TimeSource.Monotonic.ValueTimeMark) {
+		val gapMicros = readStart.elapsedNow().inWholeMicroseconds.coerceAtMost(Int.MAX_VALUE.toLong())
+		escapeGapMicros = maxOf(escapeGapMicros, gapMicros.toInt())
+	}
+
+	private fun parseEscape(buffer: ByteArray, start: Int, limit: Int): Event? {
+		val b2Index = start + 1
+		// If this escape is at the end of the buffer, request another read to ensure we can
+		// differentiate between a bare escape and one starting a sequence. Note: The caller is
+		// expected to handle the case of a bare escape, as we will otherwise endlessly return null.
+		if (b2Index == limit) return null
+
+		when (val b2 = buffer[b2Index].toInt()) {
+			0x4F -> return parseSs3(buffer, start, limit)
+			0x50 -> return parseDcs(buffer, start, limit)
+			0x58 -> return parseSos(buffer, start, limit)
+			0x5B -> return parseCsi(buffer, start, limit)
+			0x5D -> return parseOsc(buffer, start, limit)
+			0x5E -> return parsePm(buffer, start, limit)
+			0x5F -> return parseApc(buffer, start, limit)
+			else -> {
+				offset = start + 2
+				return KeyboardEvent(b2, modifiers = KeyboardEvent.ModifierAlt)
+			}
+		}
+	}
+
 	private fun parseGround(buffer: ByteArray, start: Int, limit: Int, b1: Int): Event? {
 		if (b1 <= 0x1a) {
 			offset = start + 1
@@ -190,6 +354,14 @@ public class TerminalParser(
 			}
 		}
 
+		if (b1 in 0x20..0x7E && emitTextEvents) {
+			val end = buffer.indexOfNonPrintableAscii(start + 1, limit)
+			if (end - start > 1) {
+				offset = end
+				return TextEvent(buffer.decodeToString(start, end))
+			}
+		}
+
 		// TODO Non-UTF-8 support?
 		// TODO multi-codepoint grapheme support
 		val codepoint = buffer.parseUtf8(
@@ -281,7 +453,10 @@ public class TerminalParser(
 						21 -> KeyboardEvent.F10
 						23 -> KeyboardEvent.F11
 						24 -> KeyboardEvent.F12
-						200 -> return BracketedPasteEvent(start = true)
+						200 -> {
+							inBracketedPaste = streamBracketedPaste
+							return BracketedPasteEvent(start = true)
+						}
 						201 -> return BracketedPasteEvent(start = false)
 						57427 -> KeyboardEvent.KpBegin
 						else -> break@error
@@ -852,14 +1027,17 @@ public class TerminalParser(
 		var stIndex: Int
 		val end: Int
 		found@ do {
-			var searchFrom = b3Index
+			var searchFrom = maxOf(b3Index, start + stringTerminatorSearchOffset)
 			while (true) {
 				stIndex = buffer.indexOfOrElse(0x1B.toByte(), searchFrom, limit, orElse = { break })
 
 				// If found at end of range, underflow.
 				// TODO What if we are not in raw mode and this is a bare escape after a BEL?
 				val slashIndex = stIndex + 1
-				if (slashIndex == limit) return null
+				if (slashIndex == limit) {
+					stringTerminatorSearchOffset = stIndex - start
+					return null
+				}
 
 				if (buffer[slashIndex] == '\\'.code.toByte()) {
 					end = stIndex + 2
@@ -869,15 +1047,142 @@ public class TerminalParser(
 			}
 
 			// Common case: no terminator in buffer and BEL not allowed. Underflow!
+			stringTerminatorSearchOffset = limit - start
 			if (!allowBell) return null
 
 			// Rare case: fallback to searching for BEL.
-			stIndex = buffer.indexOfOrElse(7.toByte(), b3Index, limit, orElse = { return null })
+			val bellSearchFrom = maxOf(b3Index, start + bellSearchOffset)
+			stIndex = buffer.indexOfOrElse(
+				7.toByte(),
+				bellSearchFrom,
+				limit,
+				orElse = {
+					bellSearchOffset = limit - start
+					return null
+				},
+			)
 			end = stIndex + 1
 		} while (false)
 
 		offset = end
+		stringTerminatorSearchOffset = 0
+		bellSearchOffset = 0
 		return handler(b3Index, stIndex)
 			?: UnknownEvent(buffer.copyOfRange(start, end))
 	}
+
+	private fun parseBracketedPaste(buffer: ByteArray, start: Int, limit: Int): Event? {
+		if (buffer[start] == 0x1B.toByte()) {
+			val markerEnd = start + BracketedPasteEnd.size
+			val compareEnd = minOf(markerEnd, limit)
+			if (buffer.contentRangeEquals(start, compareEnd, BracketedPasteEnd)) {
+				if (compareEnd < markerEnd) return null // Potential end marker. Underflow!
+
+				offset = markerEnd
+				inBracketedPaste = false
+				return BracketedPasteEvent(start = false)
+			}
+		}
+
+		// Deliver everything up to the next potential end marker, but never split a UTF-8 sequence.
+		var end = buffer.indexOfOrDefault(0x1B.toByte(), start + 1, limit, limit)
+		if (end == limit) {
+			end = buffer.utf8BoundaryBefore(start, limit)
+			if (end == start) return null // Incomplete UTF-8 sequence. Underflow!
+		}
+		offset = end
+		return BracketedPasteTextEvent(buffer.decodeToString(start, end))
+	}
+
+	private fun parseStringChunk(buffer: ByteArray, start: Int, limit: Int): Event? {
+		val introducer = streamingStringIntroducer
+		var end = limit
+		var terminatorEnd = -1
+		found@ do {
+			var searchFrom = start
+			while (true) {
+				val escIndex = buffer.indexOfOrElse(0x1B.toByte(), searchFrom, limit, orElse = { break })
+				val slashIndex = escIndex + 1
+				if (slashIndex == limit) {
+					// Potential terminator at the end of the buffer. Hold it back for the next read.
+					end = escIndex
+					break@found
+				}
+				if (buffer[slashIndex] == '\\'.code.toByte()) {
+					end = escIndex
+					terminatorEnd = escIndex + 2
+					break@found
+				}
+				searchFrom = slashIndex
+			}
+		} while (false)
+
+		if (introducer == ']'.code) {
+			// OSC may alternatively be terminated by BEL.
+			val belIndex = buffer.indexOf(7.toByte(), start, end)
+			if (belIndex != -1) {
+				end = belIndex
+				terminatorEnd = belIndex + 1
+			}
+		}
+
+		if (terminatorEnd == -1) {
+			if (end == start) return null // Underflow!
+			offset = end
+			return StringSequenceChunkEvent(introducer, buffer.copyOfRange(start, end), last = false)
+		}
+
+		offset = terminatorEnd
+		streamingStringIntroducer = 0
+		return StringSequenceChunkEvent(introducer, buffer.copyOfRange(start, end), last = true)
+	}
+
+	/**
+	 * Called when [buffer] is entirely filled by a sequence which could not be parsed. String
+	 * sequences switch to being streamed, and anything else is reported as unknown with the rest of
+	 * the sequence discarded by [discardSequence].
+	 */
+	private fun parseOverflow(buffer: ByteArray): Event {
+		stringTerminatorSearchOffset = 0
+		bellSearchOffset = 0
+		stateMachine.reset()
+		escapeGapMicros = 0
+		if (buffer[0] == 0x1B.toByte()) {
+			when (val introducer = buffer[1].toInt()) {
+				0x50, 0x58, 0x5D, 0x5E, 0x5F -> {
+					streamingStringIntroducer = introducer
+					// Hold back the final byte in case it is the escape of a string terminator.
+					val end = BufferSize - 1
+					offset = end
+					return StringSequenceChunkEvent(introducer, buffer.copyOfRange(2, end), last = false)
+				}
+			}
+
+			val end = stateMachine.scan(buffer, 0, BufferSize, xtermExtendedUtf8Mouse)
+			if (end != -1) {
+				offset = end
+				return UnknownEvent(buffer.copyOfRange(0, end))
+			}
+			stateMachine.discardScanned(BufferSize)
+			discardingSequence = true
+		}
+		offset = BufferSize
+		return UnknownEvent(buffer.copyOf())
+	}
+
+	/**
+	 * Consume bytes through the final byte of the sequence reported by [parseOverflow], then parse
+	 * whatever follows it.
+	 */
+	private fun discardSequence(buffer: ByteArray, start: Int, limit: Int): Event? {
+		val end = stateMachine.scan(buffer, start, limit, xtermExtendedUtf8Mouse)
+		if (end == -1) {
+			stateMachine.discardScanned(limit - start)
+			offset = limit
+			return null
+		}
+		discardingSequence = false
+		offset = end
+		return if (end < limit) tryParse(buffer, end, limit) else null
+	}
 }
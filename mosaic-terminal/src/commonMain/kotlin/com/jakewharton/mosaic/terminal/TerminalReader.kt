@@ -3,7 +3,7 @@ package com.jakewharton.mosaic.terminal
 import com.jakewharton.mosaic.terminal.event.DebugEvent
 import com.jakewharton.mosaic.terminal.event.Event
 import com.jakewharton.mosaic.tty.Tty
-import kotlinx.coroutines.channels.Channel
+import kotlin.concurrent.Volatile
 import kotlinx.coroutines.channels.Channel.Factory.UNLIMITED
 import kotlinx.coroutines.channels.ReceiveChannel
 
@@ -15,26 +15,80 @@ import kotlinx.coroutines.channels.ReceiveChannel
  *
  * @param emitDebugEvents When true, each event sent to [TerminalReader.events] will be followed
  * by a [DebugEvent] that contains the original event and the bytes which produced it.
+ * @param capacity The number of events which can be buffered in [TerminalReader.events] before
+ * [onOverflow] applies. Either a positive value or [UNLIMITED].
+ * @param onOverflow The behavior when [capacity] events are already buffered.
  */
-public fun TerminalReader(emitDebugEvents: Boolean = false): TerminalReader {
-	val tty = Tty.bind()
-	val events = Channel<Event>(UNLIMITED)
-	val callback = EventChannelTtyCallback(events, emitDebugEvents)
+public fun TerminalReader(
+	emitDebugEvents: Boolean = false,
+	capacity: Int = UNLIMITED,
+	onOverflow: EventOverflow = EventOverflow.Block,
+): TerminalReader {
+	requireValidCapacity(capacity)
+	return TerminalReader(Tty.bind(), emitDebugEvents, capacity, onOverflow)
+}
+
+/**
+ * Create a [TerminalReader] which will read from [tty]. The returned reader takes ownership of
+ * [tty] and will close it when closed.
+ *
+ * This allows reading from a [Tty] other than the one bound to this process' streams, such as
+ * one created by [com.jakewharton.mosaic.tty.TestTty].
+ *
+ * @see TerminalReader
+ */
+public fun TerminalReader(
+	tty: Tty,
+	emitDebugEvents: Boolean = false,
+	capacity: Int = UNLIMITED,
+	onOverflow: EventOverflow = EventOverflow.Block,
+): TerminalReader {
+	requireValidCapacity(capacity)
+	val events = EventQueue(capacity, onOverflow)
+	val callback = EventQueueTtyCallback(events, emitDebugEvents)
 	tty.setCallback(callback)
 	val parser = TerminalParser(tty)
 	return TerminalReader(tty, parser, events, emitDebugEvents)
 }
 
+private fun requireValidCapacity(capacity: Int) {
+	require(capacity > 0 || capacity == UNLIMITED) { "capacity must be positive or UNLIMITED: $capacity" }
+}
+
 public class TerminalReader internal constructor(
 	public val tty: Tty,
-	private val parser: TerminalParser,
-	events: Channel<Event>,
+	/** The parser used by [runParseLoop]. Its properties may be changed at any time. */
+	public val parser: TerminalParser,
+	private val queue: EventQueue,
 	private val emitDebugEvents: Boolean,
 ) : AutoCloseable {
-	private val _events = events
-
 	/** Events read as a result of calls to [runParseLoop]. */
-	public val events: ReceiveChannel<Event> get() = _events
+	public val events: ReceiveChannel<Event> get() = queue.events
+
+	/** The number of events which were discarded because [events] was full. */
+	public val droppedEventCount: Long get() = queue.droppedCount
+
+	/**
+	 * The number of events which were replaced by a later event of the same kind, either by
+	 * [coalesceEvents] or by [EventOverflow.Coalesce].
+	 */
+	public val coalescedEventCount: Long get() = queue.coalescedCount
+
+	/**
+	 * Indicate whether bursts of mouse motion and resize events should be coalesced.
+	 *
+	 * Normally, every parsed event is sent to [events]. Dragging the mouse or resizing the window
+	 * can produce dozens of these events in a single read, each of which causes work for the
+	 * consumer. Setting this property to true causes consecutive mouse motion (or drag) events
+	 * for the same button, or consecutive resize events, to be replaced by the latest one when
+	 * more input is already available. Button presses and releases, keys, and all other events are
+	 * still sent in the order they were received.
+	 *
+	 * This has no effect when debug events are enabled, or on resize events delivered through
+	 * [Tty.Callback].
+	 */
+	@Volatile
+	public var coalesceEvents: Boolean = false
 
 	/**
 	 * Perform blocking reads from stdin to parse and emit to [events].
@@ -43,19 +97,45 @@ public class TerminalReader internal constructor(
 	 */
 	public fun runParseLoop() {
 		if (!emitDebugEvents) {
+			// A coalescable event which is held while more input is available to replace it.
+			var pending: Event? = null
 			while (true) {
 				val event = parser.next() ?: break
-				_events.trySend(event)
+				if (coalesceEvents && event.isCoalescable()) {
+					if (pending != null) {
+						if (pending.isCoalescableWith(event)) {
+							queue.recordCoalesced()
+						} else {
+							queue.send(pending)
+						}
+					}
+					pending = event
+				} else {
+					if (pending != null) {
+						queue.send(pending)
+						pending = null
+					}
+					queue.send(event)
+				}
+
+				// Never hold an event across a potentially-blocking read.
+				if (pending != null && !parser.hasBufferedInput()) {
+					queue.send(pending)
+					pending = null
+				}
+			}
+			if (pending != null) {
+				queue.send(pending)
 			}
 		} else {
 			while (true) {
 				val (event, bytes) = parser.debugNext() ?: break
-				_events.trySend(event)
-				_events.trySend(DebugEvent(event, bytes))
+				queue.send(event)
+				queue.send(DebugEvent(event, bytes))
 			}
 		}
 		// TODO Hmmm catch EOF?
-		//  _events.close()
+		//  events.close()
 	}
 
 	/** Cause [runParseLoop] to return. */
@@ -0,0 +1,170 @@
+package com.jakewharton.mosaic.terminal
+
+/**
+ * A table-driven scanner for the boundaries of escape sequences in the style of the DEC/Paul
+ * Williams [VT500-series parser](https://vt100.net/emu/dec_ansi_parser).
+ *
+ * Each byte is examined exactly once, even when a sequence arrives across multiple reads, as the
+ * current state and scan position are retained between calls to [scan]. Interpreting the bytes of
+ * a complete sequence is left to [TerminalParser].
+ *
+ * The states mirror the sequence boundaries which [TerminalParser] recognizes rather than the full
+ * VT500 grammar. Notably, CAN and SUB do not abort a sequence, an escape inside a string sequence
+ * only terminates it when followed by `\`, and legacy X10 mouse reports consume three trailing
+ * values after their `M` final byte.
+ */
+internal class VtStateMachine {
+	private var state = StateGround
+
+	/** Distance from the start of the current sequence to the next byte to be scanned. */
+	private var position = 0
+
+	/** Number of X10 mouse values which have yet to be fully scanned. */
+	private var mouseValuesRemaining = 0
+
+	/** Number of UTF-8 continuation bytes expected before the current mouse value is complete. */
+	private var utf8BytesRemaining = 0
+
+	/**
+	 * Scan the escape sequence which starts at [start]. Successive calls must use the same [start]
+	 * relative to the sequence bytes and a [limit] which is at least as large as the previous call.
+	 *
+	 * @param utf8Mouse Whether X10 mouse values are UTF-8 encoded (mode 1005).
+	 * @return The index immediately after the final byte of the sequence, or -1 if [limit] was
+	 * reached before the sequence completed.
+	 */
+	fun scan(buffer: ByteArray, start: Int, limit: Int, utf8Mouse: Boolean): Int {
+		val transitions = Transitions
+		var state = state
+		var index = start + position
+		while (index < limit) {
+			val b = buffer[index++].toInt() and 0xFF
+
+			if (state == StateMouse) {
+				if (utf8BytesRemaining != 0) {
+					utf8BytesRemaining--
+				} else if (utf8Mouse) {
+					utf8BytesRemaining = utf8ContinuationCount(b)
+				}
+				if (utf8BytesRemaining == 0 && --mouseValuesRemaining == 0) {
+					reset()
+					return index
+				}
+				continue
+			}
+
+			val transition = transitions[(state shl 8) or b].toInt()
+			state = transition and StateMask
+			when (transition ushr ActionShift) {
+				ActionComplete -> {
+					reset()
+					return index
+				}
+				ActionMouse -> {
+					mouseValuesRemaining = 3
+					utf8BytesRemaining = 0
+				}
+			}
+		}
+
+		this.state = state
+		position = index - start
+		return -1
+	}
+
+	/**
+	 * Forget the first [count] scanned bytes of the current sequence which the caller has discarded.
+	 * Successive calls to [scan] then use a `start` relative to the remaining bytes.
+	 */
+	fun discardScanned(count: Int) {
+		position -= count
+	}
+
+	/** Discard any partially-scanned sequence. */
+	fun reset() {
+		state = StateGround
+		position = 0
+	}
+
+	override fun toString(): String = "VtStateMachine(state=$state, position=$position)"
+}
+
+private fun utf8ContinuationCount(b1: Int) = when {
+	b1 and 0b11100000 == 0b11000000 -> 1
+	b1 and 0b11110000 == 0b11100000 -> 2
+	b1 and 0b11111000 == 0b11110000 -> 3
+	// ASCII, or an invalid lead byte which the parser will reject on its own.
+	else -> 0
+}
+
+private const val StateGround = 0
+private const val StateEscape = 1
+private const val StateCsiEntry = 2
+private const val StateCsiParam = 3
+private const val StateSs3 = 4
+private const val StateOscString = 5
+private const val StateOscEscape = 6
+private const val StateString = 7
+private const val StateStringEscape = 8
+
+/** Scanned by counting bytes rather than through [Transitions]. */
+private const val StateMouse = 9
+private const val StateCount = 10
+private const val StateMask = 0xF
+
+/** Move to the next state. */
+private const val ActionNone = 0
+
+/** The current byte is the last of the sequence. */
+private const val ActionComplete = 1
+
+/** The current byte is the `M` of a legacy X10 mouse report whose values follow. */
+private const val ActionMouse = 2
+private const val ActionShift = 4
+
+/**
+ * Transitions indexed by `(state shl 8) or byte`. Each entry packs an action in its upper bits and
+ * the next state in its lower bits. The table is computed once from the range rules below.
+ */
+private val Transitions = ByteArray(StateCount shl 8).apply {
+	fun on(state: Int, bytes: IntRange, next: Int, action: Int = ActionNone) {
+		val transition = ((action shl ActionShift) or next).toByte()
+		for (b in bytes) {
+			this[(state shl 8) or b] = transition
+		}
+	}
+
+	on(StateGround, 0x00..0xFF, StateGround, ActionComplete)
+	on(StateGround, 0x1B..0x1B, StateEscape)
+
+	// ESC followed by anything other than an introducer is an Alt-modified key.
+	on(StateEscape, 0x00..0xFF, StateGround, ActionComplete)
+	on(StateEscape, 0x4F..0x4F, StateSs3) // O
+	on(StateEscape, 0x50..0x50, StateString) // P (DCS)
+	on(StateEscape, 0x58..0x58, StateString) // X (SOS)
+	on(StateEscape, 0x5B..0x5B, StateCsiEntry) // [
+	on(StateEscape, 0x5D..0x5D, StateOscString) // ]
+	on(StateEscape, 0x5E..0x5F, StateString) // ^ (PM) and _ (APC)
+
+	on(StateCsiEntry, 0x00..0x3F, StateCsiParam)
+	on(StateCsiEntry, 0x40..0xFF, StateGround, ActionComplete)
+	on(StateCsiEntry, 0x4D..0x4D, StateMouse, ActionMouse) // M
+	on(StateCsiParam, 0x00..0x3F, StateCsiParam)
+	on(StateCsiParam, 0x40..0xFF, StateGround, ActionComplete)
+
+	on(StateSs3, 0x00..0xFF, StateGround, ActionComplete)
+
+	on(StateOscString, 0x00..0xFF, StateOscString)
+	on(StateOscString, 0x07..0x07, StateGround, ActionComplete) // BEL
+	on(StateOscString, 0x1B..0x1B, StateOscEscape)
+	on(StateOscEscape, 0x00..0xFF, StateOscString)
+	on(StateOscEscape, 0x07..0x07, StateGround, ActionComplete) // BEL
+	on(StateOscEscape, 0x1B..0x1B, StateOscEscape)
+	on(StateOscEscape, 0x5C..0x5C, StateGround, ActionComplete) // \
+
+	on(StateString, 0x00..0xFF, StateString)
+	on(StateString, 0x1B..0x1B, StateStringEscape)
+	on(StateStringEscape, 0x00..0xFF, StateString)
+	on(StateStringEscape, 0x1B..0x1B, StateStringEscape)
+	on(StateStringEscape, 0x5C..0x5C, StateGround, ActionComplete) // \
+}
@@ -40,6 +40,78 @@ internal inline fun ByteArray.indexOfFirstOrElse(
 	return orElse()
 }
 
+/**
+ * Return the index of the first byte between [start] (inclusive) and [end] (exclusive) which is
+ * not printable ASCII (`0x20..0x7E`), or [end] if there is no such byte.
+ *
+ * Eight bytes are tested at a time by packing them into a [Long] and checking every lane for a
+ * value below `0x20` or above `0x7E` at once (SWAR). The final partial word is tested bytewise.
+ */
+internal fun ByteArray.indexOfNonPrintableAscii(start: Int, end: Int): Int {
+	var index = start
+	val wordEnd = end - 7
+	while (index < wordEnd) {
+		val word = readLongLe(index)
+		// A lane's high bit is set if its byte is < 0x20 (first term) or > 0x7E (second term).
+		val lanes = ((word - LanesOf20) and word.inv()) or ((word + LanesOf01) or word)
+		if (lanes and LanesOf80 != 0L) break
+		index += 8
+	}
+	while (index < end) {
+		// Bytes >= 0x80 are negative and are thus also caught by the first comparison.
+		val byte = this[index]
+		if (byte < 0x20 || byte > 0x7E) return index
+		index++
+	}
+	return end
+}
+
+private const val LanesOf01 = 0x0101010101010101L
+private const val LanesOf20 = 0x2020202020202020L
+
+// 0x8080808080808080 as a signed value.
+private const val LanesOf80 = -0x7F7F7F7F7F7F7F80L
+
+private fun ByteArray.readLongLe(index: Int): Long {
+	return (this[index].toLong() and 0xFF) or
+		(this[index + 1].toLong() and 0xFF shl 8) or
+		(this[index + 2].toLong() and 0xFF shl 16) or
+		(this[index + 3].toLong() and 0xFF shl 24) or
+		(this[index + 4].toLong() and 0xFF shl 32) or
+		(this[index + 5].toLong() and 0xFF shl 40) or
+		(this[index + 6].toLong() and 0xFF shl 48) or
+		(this[index + 7].toLong() and 0xFF shl 56)
+}
+
+internal fun ByteArray.contentRangeEquals(start: Int, end: Int, other: ByteArray): Boolean {
+	for (i in start until end) {
+		if (this[i] != other[i - start]) return false
+	}
+	return true
+}
+
+/**
+ * Return the largest index between [start] and [end] (both inclusive) which does not split a
+ * UTF-8 encoded codepoint.
+ */
+internal fun ByteArray.utf8BoundaryBefore(start: Int, end: Int): Int {
+	val floor = maxOf(start, end - 4)
+	for (i in end - 1 downTo floor) {
+		val b = this[i].toInt()
+		// Skip continuation bytes to find the lead byte of the final codepoint.
+		if (b and 0b11000000 == 0b10000000) continue
+
+		val size = when {
+			b and 0b11100000 == 0b11000000 -> 2
+			b and 0b11110000 == 0b11100000 -> 3
+			b and 0b11111000 == 0b11110000 -> 4
+			else -> 1
+		}
+		return if (i + size > end) i else end
+	}
+	return end
+}
+
 internal inline fun ByteArray.parseIntDigits(start: Int, end: Int, orElse: () -> Int): Int {
 	error@ do {
 		if (end > start) {
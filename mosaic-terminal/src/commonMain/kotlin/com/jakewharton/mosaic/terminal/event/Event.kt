@@ -91,6 +91,16 @@ public class KeyboardEvent(
 	}
 }
 
+/**
+ * A run of two or more printable ASCII characters which were read together, such as from a paste.
+ * Only produced when [TerminalParser.emitTextEvents][com.jakewharton.mosaic.terminal.TerminalParser.emitTextEvents]
+ * is enabled. Each character would otherwise have been a [KeyboardEvent] with no modifiers.
+ */
+@Poko
+public class TextEvent(
+	public val text: String,
+) : Event
+
 @Poko
 public class FocusEvent(
 	public val focused: Boolean,
@@ -101,6 +111,30 @@ public class BracketedPasteEvent(
 	public val start: Boolean,
 ) : Event
 
+/**
+ * A chunk of text which was pasted between a start and end [BracketedPasteEvent]. Only produced
+ * when [TerminalParser.streamBracketedPaste][com.jakewharton.mosaic.terminal.TerminalParser.streamBracketedPaste]
+ * is enabled. A single paste may be delivered as any number of chunks.
+ */
+@Poko
+public class BracketedPasteTextEvent(
+	public val text: String,
+) : Event
+
+/**
+ * A chunk of the payload of a string sequence (DCS, SOS, OSC, PM, or APC) which was too large to
+ * be parsed as a single event. The first chunk starts immediately after the sequence introducer,
+ * and the chunk where [last] is true excludes the string terminator.
+ */
+@Poko
+public class StringSequenceChunkEvent(
+	/** The byte following the escape which introduced the sequence, such as `]` for OSC. */
+	public val introducer: Int,
+	// TODO ByteString once it moves into the stdlib.
+	@ReadArrayContent public val bytes: ByteArray,
+	public val last: Boolean,
+) : Event
+
 @Poko
 public class PrimaryDeviceAttributesEvent(
 	public val id: Int,
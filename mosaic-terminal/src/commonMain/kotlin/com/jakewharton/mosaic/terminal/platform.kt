@@ -0,0 +1,17 @@
+package com.jakewharton.mosaic.terminal
+
+internal expect class AtomicBoolean
+
+internal expect inline fun AtomicBoolean.set(value: Boolean)
+
+internal expect inline fun AtomicBoolean.compareAndSet(expect: Boolean, update: Boolean): Boolean
+
+internal expect inline fun atomicBooleanOf(initialValue: Boolean): AtomicBoolean
+
+internal expect class AtomicLong
+
+internal expect inline fun AtomicLong.get(): Long
+
+internal expect inline fun AtomicLong.incrementAndGet(): Long
+
+internal expect inline fun atomicLongOf(initialValue: Long): AtomicLong
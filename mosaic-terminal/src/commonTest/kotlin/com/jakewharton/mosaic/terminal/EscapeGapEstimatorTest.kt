@@ -0,0 +1,46 @@
+package com.jakewharton.mosaic.terminal
+
+import assertk.assertThat
+import assertk.assertions.isEqualTo
+import com.jakewharton.mosaic.terminal.EscapeGapEstimator.Companion.CeilingMillis
+import com.jakewharton.mosaic.terminal.EscapeGapEstimator.Companion.FloorMillis
+import com.jakewharton.mosaic.terminal.EscapeGapEstimator.Companion.MinimumSampleCount
+import com.jakewharton.mosaic.terminal.EscapeGapEstimator.Companion.SampleCount
+import kotlin.test.Test
+
+class EscapeGapEstimatorTest {
+	private val estimator = EscapeGapEstimator()
+
+	@Test fun ceilingUntilEnoughSamples() {
+		repeat(MinimumSampleCount - 1) { estimator.record(0) }
+		assertThat(estimator.p99Micros()).isEqualTo(-1)
+		assertThat(estimator.timeoutMillis()).isEqualTo(CeilingMillis)
+
+		estimator.record(0)
+		assertThat(estimator.p99Micros()).isEqualTo(0)
+	}
+
+	@Test fun singleReadSequencesUseFloor() {
+		repeat(SampleCount) { estimator.record(0) }
+		assertThat(estimator.timeoutMillis()).isEqualTo(FloorMillis)
+	}
+
+	@Test fun multipleOfP99() {
+		repeat(SampleCount - 1) { estimator.record(5_000) }
+		// A single outlier does not affect the 99th percentile.
+		estimator.record(1_000_000)
+		assertThat(estimator.p99Micros()).isEqualTo(5_000)
+		assertThat(estimator.timeoutMillis()).isEqualTo(20)
+	}
+
+	@Test fun boundedByCeiling() {
+		repeat(SampleCount) { estimator.record(50_000) }
+		assertThat(estimator.timeoutMillis()).isEqualTo(CeilingMillis)
+	}
+
+	@Test fun oldSamplesAreForgotten() {
+		repeat(SampleCount) { estimator.record(50_000) }
+		repeat(SampleCount) { estimator.record(0) }
+		assertThat(estimator.timeoutMillis()).isEqualTo(FloorMillis)
+	}
+}
@@ -0,0 +1,120 @@
+package com.jakewharton.mosaic.terminal
+
+import assertk.assertThat
+import assertk.assertions.containsExactly
+import assertk.assertions.isEqualTo
+import com.jakewharton.mosaic.terminal.event.Event
+import com.jakewharton.mosaic.terminal.event.KeyboardEvent
+import com.jakewharton.mosaic.terminal.event.MouseEvent
+import com.jakewharton.mosaic.terminal.event.MouseEvent.Type
+import com.jakewharton.mosaic.terminal.event.ResizeEvent
+import kotlin.test.Test
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.channels.Channel
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.test.runTest
+import kotlinx.coroutines.withContext
+
+class EventQueueTest {
+	private fun EventQueue.receiveAll(): List<Event> = buildList {
+		while (true) {
+			add(events.tryReceive().getOrNull() ?: break)
+		}
+	}
+
+	@Test fun unlimitedNeverOverflows() {
+		val queue = EventQueue(Channel.UNLIMITED, EventOverflow.DropOldest)
+		repeat(10_000) { queue.send(MouseEvent(it, 0, Type.Motion)) }
+		assertThat(queue.receiveAll().size).isEqualTo(10_000)
+		assertThat(queue.droppedCount).isEqualTo(0L)
+	}
+
+	@Test fun concurrentNonBlockingSendsAreNotDropped() = runTest {
+		val queue = EventQueue(Channel.UNLIMITED, EventOverflow.DropOldest)
+		withContext(Dispatchers.Default) {
+			launch {
+				repeat(10_000) { queue.trySend(ResizeEvent(it, 0, 0, 0)) }
+			}
+			repeat(10_000) { queue.send(KeyboardEvent('a'.code)) }
+		}
+		assertThat(queue.receiveAll().size).isEqualTo(20_000)
+		assertThat(queue.droppedCount).isEqualTo(0L)
+	}
+
+	@Test fun blockDiscardsNonBlockingSends() {
+		val queue = EventQueue(1, EventOverflow.Block)
+		queue.send(KeyboardEvent('a'.code))
+		queue.trySend(ResizeEvent(1, 2, 3, 4))
+		assertThat(queue.receiveAll()).containsExactly(KeyboardEvent('a'.code))
+		assertThat(queue.droppedCount).isEqualTo(1L)
+	}
+
+	@Test fun dropOldestSkipsKeys() {
+		val queue = EventQueue(3, EventOverflow.DropOldest)
+		queue.send(KeyboardEvent('a'.code))
+		queue.send(MouseEvent(1, 0, Type.Motion))
+		queue.send(KeyboardEvent('b'.code))
+		queue.send(MouseEvent(2, 0, Type.Motion))
+		assertThat(queue.receiveAll()).containsExactly(
+			KeyboardEvent('a'.code),
+			KeyboardEvent('b'.code),
+			MouseEvent(2, 0, Type.Motion),
+		)
+		assertThat(queue.droppedCount).isEqualTo(1L)
+	}
+
+	@Test fun dropOldestDiscardsNewWhenOnlyKeysBuffered() {
+		val queue = EventQueue(2, EventOverflow.DropOldest)
+		queue.send(KeyboardEvent('a'.code))
+		queue.send(KeyboardEvent('b'.code))
+		queue.send(ResizeEvent(1, 2, 3, 4))
+		assertThat(queue.receiveAll()).containsExactly(
+			KeyboardEvent('a'.code),
+			KeyboardEvent('b'.code),
+		)
+		assertThat(queue.droppedCount).isEqualTo(1L)
+	}
+
+	@Test fun dropOldestIgnoresReceivedEvents() {
+		val queue = EventQueue(2, EventOverflow.DropOldest)
+		queue.send(MouseEvent(1, 0, Type.Motion))
+		assertThat(queue.receiveAll()).containsExactly(MouseEvent(1, 0, Type.Motion))
+		queue.send(KeyboardEvent('a'.code))
+		queue.send(KeyboardEvent('b'.code))
+		queue.send(MouseEvent(2, 0, Type.Motion))
+		queue.send(ResizeEvent(1, 2, 3, 4))
+		assertThat(queue.receiveAll()).containsExactly(
+			KeyboardEvent('a'.code),
+			KeyboardEvent('b'.code),
+		)
+		assertThat(queue.droppedCount).isEqualTo(2L)
+	}
+
+	@Test fun coalesceReplacesAdjacentMotion() {
+		val queue = EventQueue(3, EventOverflow.Coalesce)
+		queue.send(MouseEvent(1, 0, Type.Motion))
+		queue.send(MouseEvent(2, 0, Type.Motion))
+		queue.send(KeyboardEvent('a'.code))
+		queue.send(MouseEvent(3, 0, Type.Motion))
+		assertThat(queue.receiveAll()).containsExactly(
+			MouseEvent(2, 0, Type.Motion),
+			KeyboardEvent('a'.code),
+			MouseEvent(3, 0, Type.Motion),
+		)
+		assertThat(queue.coalescedCount).isEqualTo(1L)
+		assertThat(queue.droppedCount).isEqualTo(0L)
+	}
+
+	@Test fun coalesceFallsBackToDropOldest() {
+		val queue = EventQueue(2, EventOverflow.Coalesce)
+		queue.send(ResizeEvent(1, 2, 3, 4))
+		queue.send(KeyboardEvent('a'.code))
+		queue.send(KeyboardEvent('b'.code))
+		assertThat(queue.receiveAll()).containsExactly(
+			KeyboardEvent('a'.code),
+			KeyboardEvent('b'.code),
+		)
+		assertThat(queue.coalescedCount).isEqualTo(0L)
+		assertThat(queue.droppedCount).isEqualTo(1L)
+	}
+}
@@ -0,0 +1,124 @@
+package com.jakewharton.mosaic.terminal
+
+import assertk.assertThat
+import assertk.assertions.containsExactly
+import assertk.assertions.isEqualTo
+import com.jakewharton.mosaic.terminal.event.Event
+import com.jakewharton.mosaic.terminal.event.KeyboardEvent
+import com.jakewharton.mosaic.terminal.event.KeyboardEvent.Companion.ModifierCtrl
+import com.jakewharton.mosaic.terminal.event.UnknownEvent
+import com.jakewharton.mosaic.tty.TestTty
+import kotlin.test.Test
+import kotlinx.coroutines.test.runTest
+
+/**
+ * Replays recorded sessions through a parser with and without [TerminalParser.scanWithStateMachine]
+ * and asserts that the same events are produced.
+ */
+class TerminalParserStateMachineTest {
+	private fun parseAll(hex: String, configure: TerminalParser.() -> Unit): List<Event> {
+		TestTty.create().use { testTty ->
+			val parser = TerminalParser(testTty.tty).apply(configure)
+			// Every session ends with Ctrl+C which does not otherwise appear.
+			val bytes = (hex + "03").hexToByteArray()
+			assertThat(testTty.writeInput(bytes, 0, bytes.size)).isEqualTo(bytes.size)
+
+			val events = mutableListOf<Event>()
+			while (true) {
+				val event = parser.next()!!
+				if (event == KeyboardEvent('c'.code, modifiers = ModifierCtrl)) break
+				events += event
+			}
+			assertThat(parser.copyBuffer().toHexString()).isEqualTo("")
+			return events
+		}
+	}
+
+	private fun assertParity(hex: String, configure: TerminalParser.() -> Unit = {}) {
+		val expected = parseAll(hex, configure)
+		val actual = parseAll(hex) {
+			configure()
+			scanWithStateMachine = true
+		}
+		assertThat(actual).isEqualTo(expected)
+	}
+
+	@Test fun startupResponses() = runTest {
+		assertParity(
+			"1b5b3f36323b32326331" + // Primary device attributes
+				"1b50217c37423036463835351b5c" + // Tertiary device attributes
+				"1b5b306e" + // Operating status
+				"1b503e7c6b6974747928302e34302e31291b5c" + // Terminal version
+				"1b5b3f313030343b322479" + // Focus mode report
+				"1b5b3f3075" + // Kitty keyboard query
+				"1b5b3f323034383b312479" + // In-band resize mode report
+				"1b5b34383b32343b38303b3438303b3634307400" + // In-band resize
+				"1b5b3f3939373b316e" + // System theme
+				"1b5d31303b7267623a666666662f666666662f666666661b5c" + // Foreground color
+				"1b5d31313b7267623a303030302f303030302f303030301b5c" + // Background color
+				"1b5b306e", // Operating status
+		)
+	}
+
+	@Test fun typing() = runTest {
+		assertParity(
+			"68656c6c6f" + "7f" + "0d" + "c3a9" + "e28988" + "1b61" + "1b4f41" + "1b5b313b3541" +
+				"1b5b333b357e" + "1b5b31303475" + "1b5b3130343b3275" + "09" + "00",
+		)
+	}
+
+	@Test fun typingWithTextEvents() = runTest {
+		assertParity("68656c6c6f20776f726c64" + "1b5b41" + "616263", configure = { emitTextEvents = true })
+	}
+
+	@Test fun mouseDrag() = runTest {
+		assertParity(
+			"1b5b3c303b31303b32304d" +
+				"1b5b3c33323b31313b32304d" +
+				"1b5b3c33323b31323b32314d" +
+				"1b5b3c33323b31333b32314d" +
+				"1b5b3c303b31333b32316d" +
+				"1b5b4d204837" +
+				"1b5b4d404837" +
+				"1b5b4d234837",
+		)
+	}
+
+	@Test fun mouseDragUtf8() = runTest {
+		assertParity(
+			"1b5b4d20c4a037" + "1b5b4d40c4a1c4a2" + "1b5b4d23c4a237",
+			configure = { xtermExtendedUtf8Mouse = true },
+		)
+	}
+
+	@Test fun focusAndPaste() = runTest {
+		assertParity(
+			"1b5b4f" + "1b5b49" + "1b5b3230307e" + "68656c6c6f0d" + "1b5b3230317e" + "1b5b4f",
+		)
+	}
+
+	@Test fun stringSequences() = runTest {
+		assertParity(
+			"1b5f47693d313b4f4b1b5c" + // Kitty graphics
+				"1b5d32323b3f5f5f63757272656e745f5f1b5c" + // Kitty pointer query
+				"1b5d31303b7267623a666666662f666666662f6666666607" + // BEL-terminated color
+				"1b5e686d6d1b5c" + // PM
+				"1b58736f731b5c" + // SOS
+				"1b5d32321b611b5c", // Escape inside of a string
+		)
+	}
+
+	@Test fun malformed() = runTest {
+		assertParity("1b4f1b5b306e" + "1b5b3f313030343b2479" + "ff" + "1b5b313b2f48")
+	}
+
+	@Test fun unrecognizedCompleteCsi() = runTest {
+		// CSI 1 2 3 ; 4 5 6 z has a valid final byte but no meaning.
+		val hex = "1b5b3132333b3435367a" + "61"
+		assertParity(hex)
+		assertThat(parseAll(hex) { scanWithStateMachine = true }).containsExactly(
+			UnknownEvent("1b5b3132333b3435367a".hexToByteArray()),
+			KeyboardEvent('a'.code),
+		)
+	}
+}
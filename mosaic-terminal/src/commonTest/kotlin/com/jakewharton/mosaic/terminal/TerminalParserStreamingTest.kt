@@ -0,0 +1,131 @@
+package com.jakewharton.mosaic.terminal
+
+import assertk.assertThat
+import assertk.assertions.isEqualTo
+import assertk.assertions.isInstanceOf
+import com.jakewharton.mosaic.terminal.event.BracketedPasteEvent
+import com.jakewharton.mosaic.terminal.event.BracketedPasteTextEvent
+import com.jakewharton.mosaic.terminal.event.KeyboardEvent
+import com.jakewharton.mosaic.terminal.event.StringSequenceChunkEvent
+import com.jakewharton.mosaic.terminal.event.UnknownEvent
+import kotlin.test.Test
+import kotlin.time.Duration.Companion.milliseconds
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.delay
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.test.runTest
+
+class TerminalParserStreamingTest : BaseTerminalParserTest() {
+	@Test fun pasteNotStreamedByDefault() = runTest {
+		testTty.writeHex("1b5b3230307e" + "6162" + "1b5b3230317e")
+		assertThat(parser.next()).isEqualTo(BracketedPasteEvent(start = true))
+		assertThat(parser.next()).isEqualTo(KeyboardEvent('a'.code))
+		assertThat(parser.next()).isEqualTo(KeyboardEvent('b'.code))
+		assertThat(parser.next()).isEqualTo(BracketedPasteEvent(start = false))
+	}
+
+	@Test fun pasteStreamed() = runTest {
+		parser.streamBracketedPaste = true
+		testTty.writeHex("1b5b3230307e" + "68656c6c6f0d" + "1b5b3230317e")
+		assertThat(parser.next()).isEqualTo(BracketedPasteEvent(start = true))
+		assertThat(parser.next()).isEqualTo(BracketedPasteTextEvent("hello\r"))
+		assertThat(parser.next()).isEqualTo(BracketedPasteEvent(start = false))
+	}
+
+	@Test fun pasteStreamedDoesNotInterpretEscapes() = runTest {
+		parser.streamBracketedPaste = true
+		testTty.writeHex("1b5b3230307e" + "611b5b4162" + "1b5b3230317e" + "63")
+		assertThat(parser.next()).isEqualTo(BracketedPasteEvent(start = true))
+		assertThat(parser.next()).isEqualTo(BracketedPasteTextEvent("a"))
+		assertThat(parser.next()).isEqualTo(BracketedPasteTextEvent("\u001b[Ab"))
+		assertThat(parser.next()).isEqualTo(BracketedPasteEvent(start = false))
+		assertThat(parser.next()).isEqualTo(KeyboardEvent('c'.code))
+	}
+
+	@Test fun pasteStreamedLargerThanBuffer() = runTest {
+		parser.streamBracketedPaste = true
+		val text = "é".repeat(10_000)
+		testTty.writeHex("1b5b3230307e" + text.encodeToByteArray().toHexString() + "1b5b3230317e")
+		assertThat(parser.next()).isEqualTo(BracketedPasteEvent(start = true))
+
+		val pasted = StringBuilder()
+		while (true) {
+			val event = parser.next()
+			if (event is BracketedPasteTextEvent) {
+				pasted.append(event.text)
+			} else {
+				assertThat(event).isEqualTo(BracketedPasteEvent(start = false))
+				break
+			}
+		}
+		assertThat(pasted.toString()).isEqualTo(text)
+	}
+
+	@Test fun stringSequenceLargerThanBuffer() = runTest {
+		val payload = "a".repeat(10_000)
+		testTty.writeHex("1b5d" + payload.encodeToByteArray().toHexString() + "1b5c" + "62")
+
+		val received = StringBuilder()
+		while (true) {
+			val event = parser.next()
+			assertThat(event).isInstanceOf<StringSequenceChunkEvent>()
+			event as StringSequenceChunkEvent
+			assertThat(event.introducer).isEqualTo(']'.code)
+			received.append(event.bytes.decodeToString())
+			if (event.last) break
+		}
+		assertThat(received.toString()).isEqualTo(payload)
+		assertThat(parser.next()).isEqualTo(KeyboardEvent('b'.code))
+	}
+
+	@Test fun oscLargerThanBufferTerminatedByBell() = runTest {
+		val payload = "a".repeat(10_000)
+		testTty.writeHex("1b5d" + payload.encodeToByteArray().toHexString() + "07")
+
+		val received = StringBuilder()
+		while (true) {
+			val event = parser.next() as StringSequenceChunkEvent
+			received.append(event.bytes.decodeToString())
+			if (event.last) break
+		}
+		assertThat(received.toString()).isEqualTo(payload)
+	}
+
+	@Test fun oscTerminatedByBellSplitAcrossReads() = runTest {
+		// An unknown OSC so that the whole sequence is returned as-is.
+		val first = "1b5d39393b" + "61".repeat(100)
+		val second = "62".repeat(100) + "07"
+		testTty.writeHex(first)
+		backgroundScope.launch(Dispatchers.Default) {
+			delay(50.milliseconds)
+			testTty.writeHex(second)
+		}
+		assertThat(parser.next()).isEqualTo(UnknownEvent((first + second).hexToByteArray()))
+	}
+
+	@Test fun altKeysNotSampledAsEscapeGaps() = runTest {
+		testTty.writeHex("1b61".repeat(EscapeGapEstimator.MinimumSampleCount))
+		repeat(EscapeGapEstimator.MinimumSampleCount) {
+			assertThat(parser.next()).isEqualTo(KeyboardEvent('a'.code, modifiers = KeyboardEvent.ModifierAlt))
+		}
+		assertThat(parser.escapeSequenceGapMicros).isEqualTo(-1)
+
+		testTty.writeHex("1b5b41".repeat(EscapeGapEstimator.MinimumSampleCount))
+		repeat(EscapeGapEstimator.MinimumSampleCount) {
+			assertThat(parser.next()).isEqualTo(KeyboardEvent(KeyboardEvent.Up))
+		}
+		assertThat(parser.escapeSequenceGapMicros).isEqualTo(0)
+	}
+
+	@Test fun unknownSequenceLargerThanBuffer() = runTest {
+		// A CSI sequence whose parameters do not fit in the buffer, followed by a key.
+		testTty.writeHex("1b5b" + "3b".repeat(9_000) + "6d" + "61")
+
+		val first = parser.next()
+		assertThat(first).isInstanceOf<UnknownEvent>()
+		first as UnknownEvent
+		assertThat(first.bytes.size).isEqualTo(8 * 1024)
+		// The remainder of the sequence is discarded through its final byte.
+		assertThat(parser.next()).isEqualTo(KeyboardEvent('a'.code))
+	}
+}
@@ -0,0 +1,63 @@
+package com.jakewharton.mosaic.terminal
+
+import assertk.assertThat
+import assertk.assertions.isEqualTo
+import com.jakewharton.mosaic.terminal.event.KeyboardEvent
+import com.jakewharton.mosaic.terminal.event.TextEvent
+import kotlin.test.BeforeTest
+import kotlin.test.Test
+import kotlinx.coroutines.test.runTest
+
+class TerminalParserTextEventTest : BaseTerminalParserTest() {
+	@BeforeTest fun before() {
+		parser.emitTextEvents = true
+	}
+
+	@Test fun singleCharacterIsKeyboardEvent() = runTest {
+		testTty.writeHex("61")
+		assertThat(parser.next()).isEqualTo(KeyboardEvent('a'.code))
+	}
+
+	@Test fun shortRun() = runTest {
+		testTty.writeHex("616263")
+		assertThat(parser.next()).isEqualTo(TextEvent("abc"))
+	}
+
+	@Test fun longRun() = runTest {
+		val text = "The quick brown fox jumps over the lazy dog 0123456789 ~!@#$%^&*()"
+		testTty.writeHex(text.encodeToByteArray().toHexString())
+		assertThat(parser.next()).isEqualTo(TextEvent(text))
+	}
+
+	@Test fun runStopsAtControlCharacter() = runTest {
+		testTty.writeHex("6162636465666768696a0d6b6c")
+		assertThat(parser.next()).isEqualTo(TextEvent("abcdefghij"))
+		assertThat(parser.next()).isEqualTo(KeyboardEvent(0x0D))
+		assertThat(parser.next()).isEqualTo(TextEvent("kl"))
+	}
+
+	@Test fun runStopsAtEscape() = runTest {
+		testTty.writeHex("616263646566676869" + "1b5b41")
+		assertThat(parser.next()).isEqualTo(TextEvent("abcdefghi"))
+		assertThat(parser.next()).isEqualTo(KeyboardEvent(KeyboardEvent.Up))
+	}
+
+	@Test fun runStopsAtDelete() = runTest {
+		testTty.writeHex("61626364656667687f")
+		assertThat(parser.next()).isEqualTo(TextEvent("abcdefgh"))
+		assertThat(parser.next()).isEqualTo(KeyboardEvent(0x7F))
+	}
+
+	@Test fun runStopsAtNonAscii() = runTest {
+		testTty.writeHex("6162636465666768" + "c3a9")
+		assertThat(parser.next()).isEqualTo(TextEvent("abcdefgh"))
+		assertThat(parser.next()).isEqualTo(KeyboardEvent('é'.code))
+	}
+
+	@Test fun disabledByDefault() = runTest {
+		parser.emitTextEvents = false
+		testTty.writeHex("6162")
+		assertThat(parser.next()).isEqualTo(KeyboardEvent('a'.code))
+		assertThat(parser.next()).isEqualTo(KeyboardEvent('b'.code))
+	}
+}
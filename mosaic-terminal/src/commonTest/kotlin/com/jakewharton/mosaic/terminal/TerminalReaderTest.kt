@@ -0,0 +1,104 @@
+package com.jakewharton.mosaic.terminal
+
+import assertk.assertThat
+import assertk.assertions.containsExactly
+import assertk.assertions.isEqualTo
+import com.jakewharton.mosaic.terminal.event.Event
+import com.jakewharton.mosaic.terminal.event.KeyboardEvent
+import com.jakewharton.mosaic.terminal.event.MouseEvent
+import com.jakewharton.mosaic.terminal.event.MouseEvent.Button
+import com.jakewharton.mosaic.terminal.event.MouseEvent.Type
+import com.jakewharton.mosaic.terminal.event.ResizeEvent
+import com.jakewharton.mosaic.tty.TestTty
+import kotlin.test.AfterTest
+import kotlin.test.Test
+import kotlinx.coroutines.channels.Channel.Factory.UNLIMITED
+import kotlinx.coroutines.test.runTest
+
+class TerminalReaderTest {
+	private val testTty = TestTty.create()
+	private val reader = TerminalReader(
+		testTty.tty,
+		TerminalParser(testTty.tty),
+		EventQueue(UNLIMITED, EventOverflow.Block),
+		emitDebugEvents = false,
+	)
+
+	@AfterTest fun after() {
+		testTty.close()
+	}
+
+	/** Parse all of [hex] in a single read and return the resulting events. */
+	private fun readAll(hex: String): List<Event> {
+		val bytes = hex.hexToByteArray()
+		assertThat(testTty.writeInput(bytes, 0, bytes.size)).isEqualTo(bytes.size)
+		// Input takes precedence over the interrupt, so the loop returns once all input is parsed.
+		reader.interrupt()
+		reader.runParseLoop()
+		return buildList {
+			while (true) {
+				add(reader.events.tryReceive().getOrNull() ?: break)
+			}
+		}
+	}
+
+	@Test fun eventsNotCoalescedByDefault() = runTest {
+		assertThat(readAll("1b5b3c33353b313b314d" + "1b5b3c33353b323b314d")).containsExactly(
+			MouseEvent(0, 0, Type.Motion),
+			MouseEvent(1, 0, Type.Motion),
+		)
+	}
+
+	@Test fun motionCoalesced() = runTest {
+		reader.coalesceEvents = true
+		assertThat(
+			readAll("1b5b3c33353b313b314d" + "1b5b3c33353b323b314d" + "1b5b3c33353b333b314d"),
+		).containsExactly(
+			MouseEvent(2, 0, Type.Motion),
+		)
+	}
+
+	@Test fun dragCoalescedButPressAndReleasePassThrough() = runTest {
+		reader.coalesceEvents = true
+		assertThat(
+			readAll(
+				"1b5b3c303b313b314d" + // Press
+					"1b5b3c33323b323b314d" + // Drag
+					"1b5b3c33323b333b314d" + // Drag
+					"1b5b3c303b333b316d", // Release
+			),
+		).containsExactly(
+			MouseEvent(0, 0, Type.Press, Button.Left),
+			MouseEvent(2, 0, Type.Drag, Button.Left),
+			MouseEvent(2, 0, Type.Release, Button.Left),
+		)
+	}
+
+	@Test fun keysFlushPendingInOrder() = runTest {
+		reader.coalesceEvents = true
+		assertThat(
+			readAll(
+				"1b5b3c33353b313b314d" + "1b5b3c33353b323b314d" +
+					"61" +
+					"1b5b3c33353b333b314d" + "1b5b3c33353b343b314d",
+			),
+		).containsExactly(
+			MouseEvent(1, 0, Type.Motion),
+			KeyboardEvent('a'.code),
+			MouseEvent(3, 0, Type.Motion),
+		)
+	}
+
+	@Test fun resizeCoalesced() = runTest {
+		reader.coalesceEvents = true
+		assertThat(
+			readAll(
+				"1b5b34383b313b323b333b3474" +
+					"1b5b34383b353b363b373b3874" +
+					"1b5b34383b393b31303b31313b313274",
+			),
+		).containsExactly(
+			ResizeEvent(10, 9, 12, 11),
+		)
+	}
+}
@@ -0,0 +1,89 @@
+package com.jakewharton.mosaic.terminal
+
+import assertk.assertThat
+import assertk.assertions.isEqualTo
+import kotlin.test.Test
+
+class VtStateMachineTest {
+	private val stateMachine = VtStateMachine()
+
+	/** Scan [hex] one byte at a time and return the index at which a sequence completed, or -1. */
+	private fun scanBytewise(hex: String, utf8Mouse: Boolean = false): Int {
+		val bytes = hex.hexToByteArray()
+		for (limit in 1..bytes.size) {
+			val end = stateMachine.scan(bytes, 0, limit, utf8Mouse)
+			if (end != -1) return end
+		}
+		return -1
+	}
+
+	@Test fun bareEscapeIsIncomplete() {
+		assertThat(scanBytewise("1b")).isEqualTo(-1)
+	}
+
+	@Test fun altKey() {
+		assertThat(scanBytewise("1b6162")).isEqualTo(2)
+	}
+
+	@Test fun altEscape() {
+		assertThat(scanBytewise("1b1b")).isEqualTo(2)
+	}
+
+	@Test fun ss3() {
+		assertThat(scanBytewise("1b4f4162")).isEqualTo(3)
+	}
+
+	@Test fun csi() {
+		assertThat(scanBytewise("1b5b313b324162")).isEqualTo(6)
+	}
+
+	@Test fun csiIncomplete() {
+		assertThat(scanBytewise("1b5b313b32")).isEqualTo(-1)
+	}
+
+	@Test fun csiResumesAcrossCalls() {
+		val bytes = "1b5b3f313030343b322479".hexToByteArray()
+		assertThat(stateMachine.scan(bytes, 0, 5, utf8Mouse = false)).isEqualTo(-1)
+		assertThat(stateMachine.scan(bytes, 0, 9, utf8Mouse = false)).isEqualTo(-1)
+		assertThat(stateMachine.scan(bytes, 0, bytes.size, utf8Mouse = false)).isEqualTo(bytes.size)
+	}
+
+	@Test fun csiSgrMouseIsNotX10() {
+		assertThat(scanBytewise("1b5b3c303b31303b32304d62")).isEqualTo(11)
+	}
+
+	@Test fun x10Mouse() {
+		assertThat(scanBytewise("1b5b4d20483762")).isEqualTo(6)
+	}
+
+	@Test fun x10MouseUtf8() {
+		assertThat(scanBytewise("1b5b4d20c4a03762", utf8Mouse = true)).isEqualTo(7)
+	}
+
+	@Test fun oscTerminatedByStringTerminator() {
+		assertThat(scanBytewise("1b5d32323b311b5c62")).isEqualTo(8)
+	}
+
+	@Test fun oscTerminatedByBell() {
+		assertThat(scanBytewise("1b5d32323b310762")).isEqualTo(7)
+	}
+
+	@Test fun oscTerminatedByBellAfterEscape() {
+		assertThat(scanBytewise("1b5d32321b0762")).isEqualTo(6)
+	}
+
+	@Test fun dcsIgnoresBell() {
+		assertThat(scanBytewise("1b503e7c07611b5c62")).isEqualTo(8)
+	}
+
+	@Test fun stringEscapeNotFollowedBySlashContinues() {
+		assertThat(scanBytewise("1b5f471b611b1b5c62")).isEqualTo(8)
+	}
+
+	@Test fun resetDiscardsPartialSequence() {
+		val partial = "1b5b3132".hexToByteArray()
+		assertThat(stateMachine.scan(partial, 0, partial.size, utf8Mouse = false)).isEqualTo(-1)
+		stateMachine.reset()
+		assertThat(scanBytewise("1b61")).isEqualTo(2)
+	}
+}
@@ -0,0 +1,35 @@
+package com.jakewharton.mosaic.terminal
+
+internal actual typealias AtomicBoolean = java.util.concurrent.atomic.AtomicBoolean
+
+@Suppress("NOTHING_TO_INLINE", "EXTENSION_SHADOWED_BY_MEMBER")
+internal actual inline fun AtomicBoolean.set(value: Boolean) {
+	set(value)
+}
+
+@Suppress("NOTHING_TO_INLINE", "EXTENSION_SHADOWED_BY_MEMBER")
+internal actual inline fun AtomicBoolean.compareAndSet(expect: Boolean, update: Boolean): Boolean {
+	return compareAndSet(expect, update)
+}
+
+@Suppress("NOTHING_TO_INLINE")
+internal actual inline fun atomicBooleanOf(initialValue: Boolean): AtomicBoolean {
+	return AtomicBoolean(initialValue)
+}
+
+internal actual typealias AtomicLong = java.util.concurrent.atomic.AtomicLong
+
+@Suppress("NOTHING_TO_INLINE", "EXTENSION_SHADOWED_BY_MEMBER")
+internal actual inline fun AtomicLong.get(): Long {
+	return get()
+}
+
+@Suppress("NOTHING_TO_INLINE", "EXTENSION_SHADOWED_BY_MEMBER")
+internal actual inline fun AtomicLong.incrementAndGet(): Long {
+	return incrementAndGet()
+}
+
+@Suppress("NOTHING_TO_INLINE")
+internal actual inline fun atomicLongOf(initialValue: Long): AtomicLong {
+	return AtomicLong(initialValue)
+}
@@ -0,0 +1,40 @@
+package com.jakewharton.mosaic.terminal
+
+import kotlin.concurrent.AtomicInt
+
+internal actual typealias AtomicBoolean = AtomicInt
+
+@Suppress("NOTHING_TO_INLINE")
+internal actual inline fun AtomicBoolean.set(value: Boolean) {
+	this.value = value.toInt()
+}
+
+@Suppress("NOTHING_TO_INLINE")
+internal actual inline fun AtomicBoolean.compareAndSet(expect: Boolean, update: Boolean): Boolean {
+	return compareAndSet(expect.toInt(), update.toInt())
+}
+
+@Suppress("NOTHING_TO_INLINE")
+internal actual inline fun atomicBooleanOf(initialValue: Boolean): AtomicBoolean {
+	return AtomicInt(initialValue.toInt())
+}
+
+@Suppress("NOTHING_TO_INLINE")
+private inline fun Boolean.toInt() = if (this) 1 else 0
+
+internal actual typealias AtomicLong = kotlin.concurrent.AtomicLong
+
+@Suppress("NOTHING_TO_INLINE")
+internal actual inline fun AtomicLong.get(): Long {
+	return value
+}
+
+@Suppress("NOTHING_TO_INLINE", "EXTENSION_SHADOWED_BY_MEMBER")
+internal actual inline fun AtomicLong.incrementAndGet(): Long {
+	return incrementAndGet()
+}
+
+@Suppress("NOTHING_TO_INLINE")
+internal actual inline fun atomicLongOf(initialValue: Long): AtomicLong {
+	return kotlin.concurrent.AtomicLong(initialValue)
+}
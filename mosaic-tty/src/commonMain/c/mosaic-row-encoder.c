@@ -0,0 +1,423 @@
+#include "mosaic-row-encoder.h"
+
+#include "cutils.h"
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#define ROW_ENCODER_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#include <stdatomic.h>
+#elif defined(__aarch64__)
+#define ROW_ENCODER_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define COLOR_KIND_MASK 0xff000000
+
+typedef struct RowEncoderImpl {
+	/**
+	 * @return the index of the first cell after @p index whose attributes differ from those of the
+	 * cell at @p index, or @p count if none do.
+	 */
+	int (*runEnd)(const uint32_t *attributes, int index, int count);
+	/** @return the number of bytes written to @p output. */
+	int (*encodeText)(const uint32_t *codePoints, int count, uint8_t *output);
+} RowEncoderImpl;
+
+static inline int encodeCodePoint(uint32_t codePoint, uint8_t *output) {
+	if (likely(codePoint < 0x80)) {
+		output[0] = (uint8_t) codePoint;
+		return 1;
+	}
+	if (codePoint < 0x800) {
+		output[0] = (uint8_t) (0xc0 | (codePoint >> 6));
+		output[1] = (uint8_t) (0x80 | (codePoint & 0x3f));
+		return 2;
+	}
+	if (unlikely((codePoint >= 0xd800 && codePoint <= 0xdfff) || codePoint > 0x10ffff)) {
+		codePoint = 0xfffd;
+	}
+	if (codePoint < 0x10000) {
+		output[0] = (uint8_t) (0xe0 | (codePoint >> 12));
+		output[1] = (uint8_t) (0x80 | ((codePoint >> 6) & 0x3f));
+		output[2] = (uint8_t) (0x80 | (codePoint & 0x3f));
+		return 3;
+	}
+	output[0] = (uint8_t) (0xf0 | (codePoint >> 18));
+	output[1] = (uint8_t) (0x80 | ((codePoint >> 12) & 0x3f));
+	output[2] = (uint8_t) (0x80 | ((codePoint >> 6) & 0x3f));
+	output[3] = (uint8_t) (0x80 | (codePoint & 0x3f));
+	return 4;
+}
+
+static int runEnd_scalar(const uint32_t *attributes, int index, int count) {
+	const uint32_t *run = attributes + index * MOSAIC_ROW_ATTRIBUTE_COUNT;
+	for (int i = index + 1; i < count; i++) {
+		const uint32_t *cell = attributes + i * MOSAIC_ROW_ATTRIBUTE_COUNT;
+		if (cell[0] != run[0] || cell[1] != run[1] || cell[2] != run[2] || cell[3] != run[3]) {
+			return i;
+		}
+	}
+	return count;
+}
+
+static int encodeText_scalar(const uint32_t *codePoints, int count, uint8_t *output) {
+	int written = 0;
+	for (int i = 0; i < count; i++) {
+		written += encodeCodePoint(codePoints[i], output + written);
+	}
+	return written;
+}
+
+static const RowEncoderImpl scalarImpl = { runEnd_scalar, encodeText_scalar };
+
+#if defined(ROW_ENCODER_X86)
+
+static int runEnd_sse2(const uint32_t *attributes, int index, int count) {
+	// A cell's attributes are exactly one 128-bit vector.
+	const __m128i *cells = (const __m128i *) attributes;
+	__m128i run = _mm_loadu_si128(cells + index);
+	for (int i = index + 1; i < count; i++) {
+		__m128i equal = _mm_cmpeq_epi32(_mm_loadu_si128(cells + i), run);
+		if (_mm_movemask_epi8(equal) != 0xffff) {
+			return i;
+		}
+	}
+	return count;
+}
+
+static int encodeText_sse2(const uint32_t *codePoints, int count, uint8_t *output) {
+	const __m128i nonAscii = _mm_set1_epi32(~0x7f);
+	const __m128i zero = _mm_setzero_si128();
+	int written = 0;
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		const __m128i *block = (const __m128i *) (codePoints + i);
+		__m128i a = _mm_loadu_si128(block);
+		__m128i b = _mm_loadu_si128(block + 1);
+		__m128i c = _mm_loadu_si128(block + 2);
+		__m128i d = _mm_loadu_si128(block + 3);
+		__m128i high = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), nonAscii);
+		if (likely(_mm_movemask_epi8(_mm_cmpeq_epi32(high, zero)) == 0xffff)) {
+			// All values are below 0x80 so neither saturating pack changes them.
+			__m128i bytes = _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+			_mm_storeu_si128((__m128i *) (output + written), bytes);
+			written += 16;
+		} else {
+			written += encodeText_scalar(codePoints + i, 16, output + written);
+		}
+	}
+	return written + encodeText_scalar(codePoints + i, count - i, output + written);
+}
+
+static const RowEncoderImpl sse2Impl = { runEnd_sse2, encodeText_sse2 };
+
+__attribute__((target("avx2")))
+static int runEnd_avx2(const uint32_t *attributes, int index, int count) {
+	const __m128i *cells = (const __m128i *) attributes;
+	__m128i run = _mm_loadu_si128(cells + index);
+	// Two cells are compared at once against the run's attributes in each 128-bit lane.
+	__m256i runs = _mm256_broadcastsi128_si256(run);
+	int i = index + 1;
+	for (; i + 2 <= count; i += 2) {
+		__m256i equal = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *) (cells + i)), runs);
+		uint32_t mask = (uint32_t) _mm256_movemask_epi8(equal);
+		if (mask != 0xffffffff) {
+			return (mask & 0xffff) != 0xffff ? i : i + 1;
+		}
+	}
+	if (i < count) {
+		__m128i equal = _mm_cmpeq_epi32(_mm_loadu_si128(cells + i), run);
+		if (_mm_movemask_epi8(equal) != 0xffff) {
+			return i;
+		}
+	}
+	return count;
+}
+
+__attribute__((target("avx2")))
+static int encodeText_avx2(const uint32_t *codePoints, int count, uint8_t *output) {
+	const __m256i nonAscii = _mm256_set1_epi32(~0x7f);
+	int written = 0;
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		const __m256i *block = (const __m256i *) (codePoints + i);
+		__m256i a = _mm256_loadu_si256(block);
+		__m256i b = _mm256_loadu_si256(block + 1);
+		if (likely(_mm256_testz_si256(_mm256_or_si256(a, b), nonAscii))) {
+			// Packing works within 128-bit lanes, yielding a0-3 b0-3 a4-7 b4-7. Reorder the 64-bit
+			// quarters to put a's and b's values into separate lanes before the final pack.
+			__m256i shorts = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xd8);
+			__m128i bytes = _mm_packus_epi16(
+				_mm256_castsi256_si128(shorts),
+				_mm256_extracti128_si256(shorts, 1)
+			);
+			_mm_storeu_si128((__m128i *) (output + written), bytes);
+			written += 16;
+		} else {
+			written += encodeText_scalar(codePoints + i, 16, output + written);
+		}
+	}
+	return written + encodeText_scalar(codePoints + i, count - i, output + written);
+}
+
+static const RowEncoderImpl avx2Impl = { runEnd_avx2, encodeText_avx2 };
+
+static bool supportsAvx2(void) {
+	unsigned eax, ebx, ecx, edx;
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_OSXSAVE) || !(ecx & bit_AVX)) {
+		return false;
+	}
+	// The OS must also save the upper halves of the vector registers on context switches.
+	unsigned xcr0Low, xcr0High;
+	__asm__("xgetbv" : "=a" (xcr0Low), "=d" (xcr0High) : "c" (0));
+	(void) xcr0High;
+	if ((xcr0Low & 0x6) != 0x6) {
+		return false;
+	}
+	return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_AVX2);
+}
+
+// Querying the CPU is slow (especially when virtualized), so the choice is made once. Racing
+// threads compute the same value.
+static _Atomic(const RowEncoderImpl *) x86Impl;
+
+#elif defined(ROW_ENCODER_NEON)
+
+static int runEnd_neon(const uint32_t *attributes, int index, int count) {
+	uint32x4_t run = vld1q_u32(attributes + index * MOSAIC_ROW_ATTRIBUTE_COUNT);
+	for (int i = index + 1; i < count; i++) {
+		uint32x4_t equal = vceqq_u32(vld1q_u32(attributes + i * MOSAIC_ROW_ATTRIBUTE_COUNT), run);
+		if (vminvq_u32(equal) == 0) {
+			return i;
+		}
+	}
+	return count;
+}
+
+static int encodeText_neon(const uint32_t *codePoints, int count, uint8_t *output) {
+	int written = 0;
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		uint32x4_t a = vld1q_u32(codePoints + i);
+		uint32x4_t b = vld1q_u32(codePoints + i + 4);
+		uint32x4_t c = vld1q_u32(codePoints + i + 8);
+		uint32x4_t d = vld1q_u32(codePoints + i + 12);
+		uint32x4_t max = vmaxq_u32(vmaxq_u32(a, b), vmaxq_u32(c, d));
+		if (likely(vmaxvq_u32(max) < 0x80)) {
+			uint16x8_t ab = vcombine_u16(vmovn_u32(a), vmovn_u32(b));
+			uint16x8_t cd = vcombine_u16(vmovn_u32(c), vmovn_u32(d));
+			vst1q_u8(output + written, vcombine_u8(vmovn_u16(ab), vmovn_u16(cd)));
+			written += 16;
+		} else {
+			written += encodeText_scalar(codePoints + i, 16, output + written);
+		}
+	}
+	return written + encodeText_scalar(codePoints + i, count - i, output + written);
+}
+
+static const RowEncoderImpl neonImpl = { runEnd_neon, encodeText_neon };
+
+#endif
+
+static const RowEncoderImpl *selectImpl(uint32_t flags) {
+	if (unlikely(flags & MOSAIC_ROW_FLAG_SCALAR)) {
+		return &scalarImpl;
+	}
+#if defined(ROW_ENCODER_X86)
+	const RowEncoderImpl *impl = atomic_load_explicit(&x86Impl, memory_order_relaxed);
+	if (unlikely(impl == NULL)) {
+		// SSE2 is part of the x86-64 baseline.
+		impl = supportsAvx2() ? &avx2Impl : &sse2Impl;
+		atomic_store_explicit(&x86Impl, impl, memory_order_relaxed);
+	}
+	return impl;
+#elif defined(ROW_ENCODER_NEON)
+	// NEON is part of the ARM64 baseline.
+	return &neonImpl;
+#else
+	return &scalarImpl;
+#endif
+}
+
+static inline int writeUint(uint32_t value, uint8_t *output) {
+	uint8_t digits[10];
+	int length = 0;
+	do {
+		digits[length++] = (uint8_t) ('0' + value % 10);
+		value /= 10;
+	} while (value);
+	for (int i = 0; i < length; i++) {
+		output[i] = digits[length - 1 - i];
+	}
+	return length;
+}
+
+typedef struct SgrWriter {
+	uint8_t *output;
+	int written;
+	bool empty;
+} SgrWriter;
+
+static inline void sgrAdd(SgrWriter *writer, uint32_t value) {
+	if (!writer->empty) {
+		writer->output[writer->written++] = ';';
+	}
+	writer->empty = false;
+	writer->written += writeUint(value, writer->output + writer->written);
+}
+
+static inline void sgrAddString(SgrWriter *writer, const char *value) {
+	if (!writer->empty) {
+		writer->output[writer->written++] = ';';
+	}
+	writer->empty = false;
+	size_t length = strlen(value);
+	memcpy(writer->output + writer->written, value, length);
+	writer->written += (int) length;
+}
+
+static void sgrAddColor(SgrWriter *writer, uint32_t color, uint32_t select, uint32_t reset, uint32_t offset) {
+	switch (color & COLOR_KIND_MASK) {
+		case MOSAIC_ROW_COLOR_ANSI16:
+			sgrAdd(writer, (color & 0xff) + offset);
+			break;
+		case MOSAIC_ROW_COLOR_ANSI256:
+			sgrAdd(writer, select);
+			sgrAdd(writer, 5);
+			sgrAdd(writer, color & 0xff);
+			break;
+		case MOSAIC_ROW_COLOR_RGB:
+			sgrAdd(writer, select);
+			sgrAdd(writer, 2);
+			sgrAdd(writer, (color >> 16) & 0xff);
+			sgrAdd(writer, (color >> 8) & 0xff);
+			sgrAdd(writer, color & 0xff);
+			break;
+		default:
+			sgrAdd(writer, reset);
+			break;
+	}
+}
+
+static inline void sgrToggleStyle(SgrWriter *writer, uint32_t style, uint32_t last, uint32_t bit, uint32_t on, uint32_t off) {
+	if (style & bit) {
+		if (!(last & bit)) {
+			sgrAdd(writer, on);
+		}
+	} else if (last & bit) {
+		sgrAdd(writer, off);
+	}
+}
+
+/**
+ * Write a single SGR sequence which changes the @p last attributes to @p cell, or nothing if no
+ * values changed.
+ * @return the number of bytes written to @p output.
+ */
+static int encodeSgr(const uint32_t *last, const uint32_t *cell, uint32_t flags, uint8_t *output) {
+	// Values are appended after the control sequence introducer which is discarded if none are.
+	SgrWriter writer = { output, 2, true };
+	output[0] = '\x1b';
+	output[1] = '[';
+
+	if (cell[MOSAIC_ROW_ATTRIBUTE_FOREGROUND] != last[MOSAIC_ROW_ATTRIBUTE_FOREGROUND]) {
+		sgrAddColor(&writer, cell[MOSAIC_ROW_ATTRIBUTE_FOREGROUND], 38, 39, 0);
+	}
+	if (cell[MOSAIC_ROW_ATTRIBUTE_BACKGROUND] != last[MOSAIC_ROW_ATTRIBUTE_BACKGROUND]) {
+		sgrAddColor(&writer, cell[MOSAIC_ROW_ATTRIBUTE_BACKGROUND], 48, 49, 10);
+	}
+
+	uint32_t style = cell[MOSAIC_ROW_ATTRIBUTE_STYLE];
+	uint32_t lastStyle = last[MOSAIC_ROW_ATTRIBUTE_STYLE];
+	if ((style & 0xff) != (lastStyle & 0xff)) {
+		sgrToggleStyle(&writer, style, lastStyle, MOSAIC_ROW_STYLE_BOLD, 1, 22);
+		sgrToggleStyle(&writer, style, lastStyle, MOSAIC_ROW_STYLE_DIM, 2, 22);
+		sgrToggleStyle(&writer, style, lastStyle, MOSAIC_ROW_STYLE_ITALIC, 3, 23);
+		sgrToggleStyle(&writer, style, lastStyle, MOSAIC_ROW_STYLE_INVERT, 7, 27);
+		sgrToggleStyle(&writer, style, lastStyle, MOSAIC_ROW_STYLE_STRIKETHROUGH, 9, 29);
+	}
+	uint32_t underline = (style >> MOSAIC_ROW_UNDERLINE_SHIFT) & 0xff;
+	if (underline != ((lastStyle >> MOSAIC_ROW_UNDERLINE_SHIFT) & 0xff)) {
+		bool kitty = (flags & MOSAIC_ROW_FLAG_KITTY_UNDERLINES) != 0;
+		switch (underline) {
+			case MOSAIC_ROW_UNDERLINE_UNSPECIFIED:
+			case MOSAIC_ROW_UNDERLINE_NONE:
+				sgrAdd(&writer, 24);
+				break;
+			case MOSAIC_ROW_UNDERLINE_DOUBLE:
+				sgrAddString(&writer, kitty ? "4:2" : "4");
+				break;
+			case MOSAIC_ROW_UNDERLINE_CURLY:
+				sgrAddString(&writer, kitty ? "4:3" : "4");
+				break;
+			case MOSAIC_ROW_UNDERLINE_DOTTED:
+				sgrAddString(&writer, kitty ? "4:4" : "4");
+				break;
+			case MOSAIC_ROW_UNDERLINE_DASHED:
+				sgrAddString(&writer, kitty ? "4:5" : "4");
+				break;
+			default:
+				sgrAdd(&writer, 4);
+				break;
+		}
+	}
+
+	if (cell[MOSAIC_ROW_ATTRIBUTE_UNDERLINE_COLOR] != last[MOSAIC_ROW_ATTRIBUTE_UNDERLINE_COLOR]) {
+		sgrAddColor(&writer, cell[MOSAIC_ROW_ATTRIBUTE_UNDERLINE_COLOR], 58, 59, 0);
+	}
+
+	if (writer.empty) {
+		return 0;
+	}
+	output[writer.written++] = 'm';
+	return writer.written;
+}
+
+static inline bool isBlank(const uint32_t *codePoints, const uint32_t *attributes, int index) {
+	const uint32_t *cell = attributes + index * MOSAIC_ROW_ATTRIBUTE_COUNT;
+	return codePoints[index] == ' ' && (cell[0] | cell[1] | cell[2] | cell[3]) == 0;
+}
+
+int rowEncoder_encode(
+	const uint32_t *codePoints,
+	const uint32_t *attributes,
+	int count,
+	uint32_t flags,
+	uint8_t *output
+) {
+	while (count > 0 && isBlank(codePoints, attributes, count - 1)) {
+		count--;
+	}
+
+	const RowEncoderImpl *impl = selectImpl(flags);
+	if (flags & MOSAIC_ROW_FLAG_PLAIN) {
+		return impl->encodeText(codePoints, count, output);
+	}
+
+	static const uint32_t blank[MOSAIC_ROW_ATTRIBUTE_COUNT] = { 0 };
+	const uint32_t *last = blank;
+	int written = 0;
+	for (int index = 0; index < count;) {
+		const uint32_t *cell = attributes + index * MOSAIC_ROW_ATTRIBUTE_COUNT;
+		if (memcmp(cell, last, sizeof(blank)) != 0) {
+			written += encodeSgr(last, cell, flags, output + written);
+			last = cell;
+		}
+		int end = impl->runEnd(attributes, index, count);
+		written += impl->encodeText(codePoints + index, end - index, output + written);
+		index = end;
+	}
+
+	if (
+		last[MOSAIC_ROW_ATTRIBUTE_FOREGROUND] != MOSAIC_ROW_COLOR_UNSPECIFIED ||
+		last[MOSAIC_ROW_ATTRIBUTE_BACKGROUND] != MOSAIC_ROW_COLOR_UNSPECIFIED ||
+		(last[MOSAIC_ROW_ATTRIBUTE_STYLE] & 0xff) != 0
+	) {
+		memcpy(output + written, "\x1b[0m", 4);
+		written += 4;
+	}
+	return written;
+}
@@ -0,0 +1,71 @@
+#ifndef MOSAIC_ROW_ENCODER_H
+#define MOSAIC_ROW_ENCODER_H
+
+#include <stdint.h>
+
+// Each cell of the attribute plane is this many values: foreground color, background color,
+// underline color, and style. This makes a cell 16 bytes so that one SIMD compare covers it.
+#define MOSAIC_ROW_ATTRIBUTE_COUNT 4
+#define MOSAIC_ROW_ATTRIBUTE_FOREGROUND 0
+#define MOSAIC_ROW_ATTRIBUTE_BACKGROUND 1
+#define MOSAIC_ROW_ATTRIBUTE_UNDERLINE_COLOR 2
+#define MOSAIC_ROW_ATTRIBUTE_STYLE 3
+
+// Colors are resolved for the terminal's color support before encoding. The high byte is the kind.
+#define MOSAIC_ROW_COLOR_UNSPECIFIED 0
+// Low byte is a foreground code (30-37 or 90-97). Background colors add 10 when encoded.
+#define MOSAIC_ROW_COLOR_ANSI16 0x01000000
+// Low byte is an index into the 256-color palette.
+#define MOSAIC_ROW_COLOR_ANSI256 0x02000000
+// Low 24 bits are 0xRRGGBB.
+#define MOSAIC_ROW_COLOR_RGB 0x03000000
+
+// The style value's low byte holds text style bits and its second byte holds the underline style.
+#define MOSAIC_ROW_STYLE_BOLD 0x01
+#define MOSAIC_ROW_STYLE_DIM 0x02
+#define MOSAIC_ROW_STYLE_ITALIC 0x04
+#define MOSAIC_ROW_STYLE_INVERT 0x08
+#define MOSAIC_ROW_STYLE_STRIKETHROUGH 0x10
+#define MOSAIC_ROW_UNDERLINE_SHIFT 8
+#define MOSAIC_ROW_UNDERLINE_UNSPECIFIED 0
+#define MOSAIC_ROW_UNDERLINE_NONE 1
+#define MOSAIC_ROW_UNDERLINE_STRAIGHT 2
+#define MOSAIC_ROW_UNDERLINE_DOUBLE 3
+#define MOSAIC_ROW_UNDERLINE_CURLY 4
+#define MOSAIC_ROW_UNDERLINE_DOTTED 5
+#define MOSAIC_ROW_UNDERLINE_DASHED 6
+
+// Only encode text, ignoring the attribute plane except for trimming trailing blank cells.
+#define MOSAIC_ROW_FLAG_PLAIN 0x01
+// Encode double, curly, dotted, and dashed underlines rather than a straight underline.
+#define MOSAIC_ROW_FLAG_KITTY_UNDERLINES 0x02
+// Use the portable implementation regardless of CPU support. Intended for testing.
+#define MOSAIC_ROW_FLAG_SCALAR 0x04
+
+// The most bytes written for one cell: the longest SGR sequence plus a 4-byte UTF-8 code point.
+#define MOSAIC_ROW_MAX_CELL_BYTES 80
+// The most bytes written for a row of @p count cells, including the trailing reset.
+#define MOSAIC_ROW_MAX_BYTES(count) ((count) * MOSAIC_ROW_MAX_CELL_BYTES + 4)
+
+/**
+ * Encode a row of @p count cells as UTF-8 text interleaved with SGR sequences which change the
+ * attributes between cells. Trailing cells which are a space with all-zero attributes are not
+ * encoded. If the last encoded cell has colors or text styles, a reset sequence is appended.
+ *
+ * Runs of cells with equal attributes and runs of ASCII code points are found using SSE2 or AVX2
+ * on x86-64 (chosen at runtime) and NEON on ARM64.
+ *
+ * @param codePoints @p count code points. Invalid code points are encoded as U+FFFD.
+ * @param attributes @p count times MOSAIC_ROW_ATTRIBUTE_COUNT values.
+ * @param output At least MOSAIC_ROW_MAX_BYTES(@p count) bytes.
+ * @return the number of bytes written to @p output.
+ */
+int rowEncoder_encode(
+	const uint32_t *codePoints,
+	const uint32_t *attributes,
+	int count,
+	uint32_t flags,
+	uint8_t *output
+);
+
+#endif // MOSAIC_ROW_ENCODER_H
@@ -5,15 +5,91 @@
 
 #include "cutils.h"
 #include <errno.h>
-#include <fcntl.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 typedef struct MosaicTestTtyImpl {
+	// The tty is freed before this instance, so its ends of the pipes are also held here.
+	int stdin_read_fd;
 	int stdin_write_fd;
+	int stdout_read_fd;
+	int stdout_write_fd;
 	MosaicTty *tty;
+	// Reads everything written to the tty's stdout into output as it arrives so that writes of any
+	// size never wait for testTty_readOutput, whatever the pipe's capacity. Runs until the write end
+	// is closed by testTty_free.
+	pthread_t drain_thread;
+	pthread_mutex_t lock;
+	// Bytes drained from stdout which have yet to be returned by testTty_readOutput. Of capacity
+	// bytes, count starting at start are unread. Guarded by lock.
+	uint8_t *output;
+	size_t output_capacity;
+	size_t output_start;
+	size_t output_count;
+	// The error which stopped the drain thread, or 0. Guarded by lock.
+	uint32_t drain_error;
 } MosaicTestTtyImpl;
 
+#define DRAIN_CHUNK_SIZE 8192
+
+/** Append @p count bytes from @p buffer to the unread output. Must hold the lock. */
+static uint32_t testTty_appendOutput(MosaicTestTtyImpl *testTty, uint8_t *buffer, size_t count) {
+	size_t end = testTty->output_start + testTty->output_count;
+	if (end + count > testTty->output_capacity) {
+		// Reclaim the space of bytes already read before resorting to growing.
+		if (testTty->output_start != 0) {
+			memmove(testTty->output, testTty->output + testTty->output_start, testTty->output_count);
+			testTty->output_start = 0;
+		}
+		end = testTty->output_count;
+		if (end + count > testTty->output_capacity) {
+			size_t capacity = testTty->output_capacity ? testTty->output_capacity : DRAIN_CHUNK_SIZE;
+			while (capacity < end + count) {
+				capacity *= 2;
+			}
+			uint8_t *output = realloc(testTty->output, capacity);
+			if (unlikely(output == NULL)) {
+				return ENOMEM;
+			}
+			testTty->output = output;
+			testTty->output_capacity = capacity;
+		}
+	}
+	memcpy(testTty->output + end, buffer, count);
+	testTty->output_count += count;
+	return 0;
+}
+
+static void *testTty_drainOutput(void *arg) {
+	MosaicTestTtyImpl *testTty = (MosaicTestTtyImpl *) arg;
+	uint8_t buffer[DRAIN_CHUNK_SIZE];
+	while (true) {
+		ssize_t bytesRead = read(testTty->stdout_read_fd, buffer, sizeof(buffer));
+		uint32_t error = 0;
+		if (bytesRead == 0) {
+			break; // The write end was closed.
+		} else if (unlikely(bytesRead < 0)) {
+			if (errno == EINTR) {
+				continue;
+			}
+			error = errno;
+		}
+
+		pthread_mutex_lock(&testTty->lock);
+		if (likely(error == 0)) {
+			error = testTty_appendOutput(testTty, buffer, bytesRead);
+		}
+		testTty->drain_error = error;
+		pthread_mutex_unlock(&testTty->lock);
+		if (unlikely(error)) {
+			break;
+		}
+	}
+	return NULL;
+}
+
 MosaicTestTtyInitResult testTty_init() {
 	MosaicTestTtyInitResult result = {};
 
@@ -31,23 +107,51 @@ MosaicTestTtyInitResult testTty_init() {
 	int stdinReadFd = stdinPipe[0];
 	int stdinWriteFd = stdinPipe[1];
 
-	int stdoutWriteFd = STDOUT_FILENO;
+	int stdoutPipe[2];
+	if (unlikely(pipe(stdoutPipe)) != 0) {
+		result.error = errno;
+		goto err_stdin;
+	}
+	int stdoutReadFd = stdoutPipe[0];
+	int stdoutWriteFd = stdoutPipe[1];
+
 	int stderrWriteFd = STDERR_FILENO;
 
 	MosaicTtyInitResult ttyInitResult = tty_initWithFds(stdinReadFd, stdoutWriteFd, stderrWriteFd);
 	if (unlikely(ttyInitResult.error)) {
 		result.error = ttyInitResult.error;
-		goto err;
+		goto err_stdout;
+	}
+	if (unlikely(ttyInitResult.tty == NULL)) {
+		// result.testTty is set to 0 which will trigger OOM.
+		goto err_stdout;
 	}
 
+	testTty->stdin_read_fd = stdinReadFd;
 	testTty->stdin_write_fd = stdinWriteFd;
+	testTty->stdout_read_fd = stdoutReadFd;
+	testTty->stdout_write_fd = stdoutWriteFd;
 	testTty->tty = ttyInitResult.tty;
 
+	pthread_mutex_init(&testTty->lock, NULL);
+	result.error = pthread_create(&testTty->drain_thread, NULL, testTty_drainOutput, testTty);
+	if (unlikely(result.error)) {
+		pthread_mutex_destroy(&testTty->lock);
+		tty_free(ttyInitResult.tty);
+		goto err_stdout;
+	}
+
 	result.testTty = testTty;
 
 	ret:
 	return result;
 
+	err_stdout:
+	close(stdoutReadFd);
+	close(stdoutWriteFd);
+	err_stdin:
+	close(stdinReadFd);
+	close(stdinWriteFd);
 	err:
 	free(testTty);
 	goto ret;
@@ -70,6 +174,27 @@ MosaicTtyIoResult testTty_writeInput(MosaicTestTty *testTty, uint8_t *buffer, in
 	return result;
 }
 
+MosaicTtyIoResult testTty_readOutput(MosaicTestTty *testTty, uint8_t *buffer, int count) {
+	MosaicTtyIoResult result = {};
+
+	pthread_mutex_lock(&testTty->lock);
+	size_t available = testTty->output_count;
+	if (available > 0) {
+		size_t copied = available < (size_t) count ? available : (size_t) count;
+		memcpy(buffer, testTty->output + testTty->output_start, copied);
+		testTty->output_start += copied;
+		testTty->output_count -= copied;
+		result.count = copied;
+	} else {
+		// Nothing has been written, so return a count of 0. A failed drain is reported once all of
+		// the output before it has been read.
+		result.error = testTty->drain_error;
+	}
+	pthread_mutex_unlock(&testTty->lock);
+
+	return result;
+}
+
 uint32_t testTty_focusEvent(MosaicTestTty *testTty UNUSED, bool focused UNUSED) {
 	// Focus events are delivered through VT sequences.
 	return 0;
@@ -88,7 +213,13 @@ uint32_t testTty_mouseEvent(MosaicTestTty *testTty UNUSED) {
 uint32_t testTty_resizeEvent(MosaicTestTty *testTty, int columns, int rows, int width, int height) {
 	MosaicTtyCallback *callback = testTty->tty->callback;
 	if (callback) {
-		callback->onResize(callback->opaque, columns, rows, width, height);
+		MosaicTtyEvent event = {
+			.type = MOSAIC_TTY_EVENT_RESIZE,
+			.values = { columns, rows, width, height },
+		};
+		if (eventQueue_push(&testTty->tty->events, &event)) {
+			callback->onEvents(callback->opaque);
+		}
 	}
 	return 0;
 }
@@ -99,10 +230,20 @@ uint32_t testTty_free(MosaicTestTty *testTty) {
 	if (unlikely(close(testTty->stdin_write_fd) != 0)) {
 		result = errno;
 	}
-	if (unlikely(close(testTty->tty->stdin_read_fd) != 0 && result != 0)) {
+	if (unlikely(close(testTty->stdin_read_fd) != 0 && result == 0)) {
+		result = errno;
+	}
+	// Closing the write end stops the drain thread once it has read everything before it.
+	if (unlikely(close(testTty->stdout_write_fd) != 0 && result == 0)) {
+		result = errno;
+	}
+	pthread_join(testTty->drain_thread, NULL);
+	if (unlikely(close(testTty->stdout_read_fd) != 0 && result == 0)) {
 		result = errno;
 	}
 
+	pthread_mutex_destroy(&testTty->lock);
+	free(testTty->output);
 	free(testTty);
 
 	return result;
@@ -8,8 +8,14 @@
 
 typedef struct MosaicTestTtyImpl {
 	MosaicTty *tty;
+	// Receives everything written to the tty's stdout.
+	HANDLE stdout_read;
+	HANDLE stdout_write;
 } MosaicTestTtyImpl;
 
+// Large enough for many frames to be written before the output must be read.
+#define STDOUT_PIPE_SIZE (1024 * 1024)
+
 // A single global input writer into which fake data can be sent. Creating and closing this over
 // and over eventually produces a failure, so we only do it once per process (since it's test only).
 static HANDLE writerConin = NULL;
@@ -42,7 +48,12 @@ MosaicTestTtyInitResult testTty_init() {
 	// Ensure we don't start with existing records in the buffer.
 	FlushConsoleInputBuffer(stdin);
 
-	HANDLE stdout = GetStdHandle(STD_OUTPUT_HANDLE);
+	HANDLE stdoutRead;
+	HANDLE stdout;
+	if (unlikely(!CreatePipe(&stdoutRead, &stdout, NULL, STDOUT_PIPE_SIZE))) {
+		result.error = GetLastError();
+		goto err;
+	}
 	HANDLE stderr = GetStdHandle(STD_ERROR_HANDLE);
 
 	MosaicTtyInitResult ttyInitResult = tty_initWithHandles(stdin, stdout, stderr);
@@ -51,6 +62,8 @@ MosaicTestTtyInitResult testTty_init() {
 		goto err;
 	}
 	testTty->tty = ttyInitResult.tty;
+	testTty->stdout_read = stdoutRead;
+	testTty->stdout_write = stdout;
 
 	result.testTty = testTty;
 
@@ -92,6 +105,31 @@ MosaicTtyIoResult testTty_writeInput(MosaicTestTty *testTty, uint8_t *buffer, in
 	return result;
 }
 
+MosaicTtyIoResult testTty_readOutput(MosaicTestTty *testTty, uint8_t *buffer, int count) {
+	MosaicTtyIoResult result = {};
+
+	// Anonymous pipes do not support non-blocking reads, so only read what is already available.
+	DWORD available;
+	if (unlikely(!PeekNamedPipe(testTty->stdout_read, NULL, 0, NULL, &available, NULL))) {
+		result.error = GetLastError();
+		goto ret;
+	}
+	if (available == 0) {
+		goto ret;
+	}
+
+	DWORD read;
+	DWORD request = available < (DWORD) count ? available : (DWORD) count;
+	if (likely(ReadFile(testTty->stdout_read, buffer, request, &read, NULL))) {
+		result.count = read;
+	} else {
+		result.error = GetLastError();
+	}
+
+	ret:
+	return result;
+}
+
 static uint32_t writeRecord(HANDLE h, INPUT_RECORD *record) {
 	DWORD written;
 	if (likely(WriteConsoleInputW(h, record, 1, &written))) {
@@ -129,8 +167,17 @@ uint32_t testTty_resizeEvent(MosaicTestTty *testTty, int columns, int rows, int
 }
 
 uint32_t testTty_free(MosaicTestTty *testTty) {
+	uint32_t result = 0;
+
+	if (unlikely(!CloseHandle(testTty->stdout_read))) {
+		result = GetLastError();
+	}
+	if (unlikely(!CloseHandle(testTty->stdout_write) && result == 0)) {
+		result = GetLastError();
+	}
+
 	free(testTty);
-	return 0;
+	return result;
 }
 
 #endif
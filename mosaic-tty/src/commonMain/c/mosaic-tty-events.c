@@ -0,0 +1,96 @@
+#include "mosaic-tty-events.h"
+
+#include "cutils.h"
+#include <stdint.h>
+
+#define EVENT_QUEUE_MASK (EVENT_QUEUE_CAPACITY - 1)
+
+void eventQueue_init(MosaicTtyEventQueue *queue) {
+	for (size_t i = 0; i < EVENT_QUEUE_CAPACITY; i++) {
+		atomic_store_explicit(&queue->slots[i].sequence, i, memory_order_relaxed);
+	}
+	atomic_store_explicit(&queue->push_position, 0, memory_order_relaxed);
+	atomic_store_explicit(&queue->pop_position, 0, memory_order_relaxed);
+}
+
+static bool eventQueue_tryPush(MosaicTtyEventQueue *queue, MosaicTtyEvent *event) {
+	size_t position = atomic_load_explicit(&queue->push_position, memory_order_relaxed);
+	MosaicTtyEventSlot *slot;
+	while (true) {
+		slot = &queue->slots[position & EVENT_QUEUE_MASK];
+		size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+		if (likely(difference == 0)) {
+			// The slot is free for this position. Claim it unless another producer did first.
+			if (atomic_compare_exchange_weak_explicit(
+				&queue->push_position,
+				&position,
+				position + 1,
+				memory_order_relaxed,
+				memory_order_relaxed
+			)) {
+				break;
+			}
+		} else if (difference < 0) {
+			return false; // Full.
+		} else {
+			position = atomic_load_explicit(&queue->push_position, memory_order_relaxed);
+		}
+	}
+
+	slot->event = *event;
+	atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+	return true;
+}
+
+static bool eventQueue_popOne(MosaicTtyEventQueue *queue, MosaicTtyEvent *event) {
+	size_t position = atomic_load_explicit(&queue->pop_position, memory_order_relaxed);
+	MosaicTtyEventSlot *slot;
+	while (true) {
+		slot = &queue->slots[position & EVENT_QUEUE_MASK];
+		size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		intptr_t difference = (intptr_t) sequence - (intptr_t) (position + 1);
+		if (likely(difference == 0)) {
+			// The slot has been written for this position. Claim it unless another consumer did first.
+			if (atomic_compare_exchange_weak_explicit(
+				&queue->pop_position,
+				&position,
+				position + 1,
+				memory_order_relaxed,
+				memory_order_relaxed
+			)) {
+				break;
+			}
+		} else if (difference < 0) {
+			return false; // Empty.
+		} else {
+			position = atomic_load_explicit(&queue->pop_position, memory_order_relaxed);
+		}
+	}
+
+	*event = slot->event;
+	// Mark the slot free for the push which is one lap ahead.
+	atomic_store_explicit(&slot->sequence, position + EVENT_QUEUE_CAPACITY, memory_order_release);
+	return true;
+}
+
+bool eventQueue_push(MosaicTtyEventQueue *queue, MosaicTtyEvent *event) {
+	while (unlikely(!eventQueue_tryPush(queue, event))) {
+		if (event->type != MOSAIC_TTY_EVENT_FOCUS && event->type != MOSAIC_TTY_EVENT_RESIZE) {
+			return false;
+		}
+		// Make room by discarding the oldest event. If a consumer emptied the queue first, there is
+		// already room.
+		MosaicTtyEvent oldest;
+		eventQueue_popOne(queue, &oldest);
+	}
+	return true;
+}
+
+int eventQueue_pop(MosaicTtyEventQueue *queue, MosaicTtyEvent *events, int count) {
+	int popped = 0;
+	while (popped < count && eventQueue_popOne(queue, &events[popped])) {
+		popped++;
+	}
+	return popped;
+}
@@ -0,0 +1,41 @@
+#ifndef MOSAIC_TTY_EVENTS_H
+#define MOSAIC_TTY_EVENTS_H
+
+#include "mosaic-tty.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Must be a power of two.
+#define EVENT_QUEUE_CAPACITY 64
+
+typedef struct MosaicTtyEventSlot {
+	_Atomic size_t sequence;
+	MosaicTtyEvent event;
+} MosaicTtyEventSlot;
+
+/**
+ * A bounded, lock-free queue of events. Any number of threads may push and pop concurrently.
+ * See https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue.
+ */
+typedef struct MosaicTtyEventQueue {
+	MosaicTtyEventSlot slots[EVENT_QUEUE_CAPACITY];
+	_Atomic size_t push_position;
+	_Atomic size_t pop_position;
+} MosaicTtyEventQueue;
+
+void eventQueue_init(MosaicTtyEventQueue *queue);
+
+/**
+ * Focus and resize events describe the latest state, so when the queue is full the oldest events
+ * are dropped to make room for them. Other events are dropped instead, as any earlier input
+ * notification which remains queued already reports that input can be read.
+ *
+ * @return false if the queue was full and @p event was dropped.
+ */
+bool eventQueue_push(MosaicTtyEventQueue *queue, MosaicTtyEvent *event);
+
+/** Remove up to @p count events into @p events. @return the number removed. */
+int eventQueue_pop(MosaicTtyEventQueue *queue, MosaicTtyEvent *events, int count);
+
+#endif // MOSAIC_TTY_EVENTS_H
@@ -1,19 +1,94 @@
 #if defined(__APPLE__) || defined(__linux__)
 
+#if defined(__linux__)
+#define _GNU_SOURCE // For ppoll.
+#endif
+
 #include "mosaic-tty-posix.h"
 
 #include "cutils.h"
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <signal.h>
 #include <stdatomic.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/ioctl.h>
-#include <sys/select.h>
+#include <sys/uio.h>
 #include <termios.h>
 #include <time.h>
 #include <unistd.h>
 
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+/** @return errno for a call which failed, but never 0 so the failure cannot be mistaken for success. */
+static inline int failureErrno(void) {
+	int error = errno;
+	return likely(error != 0) ? error : EIO;
+}
+
+static int nonBlockingPipe(int *readFd, int *writeFd) {
+	int fds[2];
+	if (unlikely(pipe(fds) != 0)) {
+		return failureErrno();
+	}
+	// Neither end may block: the read end is drained until empty, and writers do not need to wait
+	// when many notifications are already pending.
+	for (int i = 0; i < 2; i++) {
+		fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+		fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+	}
+	*readFd = fds[0];
+	*writeFd = fds[1];
+	return 0;
+}
+
+/** Consume all pending notifications from a non-blocking pipe or an eventfd. */
+static int drainNotifications(int fd) {
+	// An eventfd is reset by a single 8-byte read, whereas a pipe is read until it is empty.
+	uint8_t drain[64];
+	int c;
+	do {
+		c = read(fd, drain, sizeof(drain));
+	} while (c == sizeof(drain));
+	if (unlikely(c < 0 && errno != EAGAIN)) {
+		return errno;
+	}
+	return 0;
+}
+
+static int interruptInit(int *readFd, int *writeFd) {
+#if defined(__linux__)
+	int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (unlikely(fd == -1)) {
+		return failureErrno();
+	}
+	*readFd = fd;
+	*writeFd = fd;
+	return 0;
+#else
+	return nonBlockingPipe(readFd, writeFd);
+#endif
+}
+
+static uint32_t interruptFree(int readFd, int writeFd) {
+	uint32_t result = 0;
+	if (unlikely(close(readFd) != 0)) {
+		result = errno;
+	}
+	if (writeFd != readFd && unlikely(close(writeFd) != 0) && result == 0) {
+		result = errno;
+	}
+	return result;
+}
+
 MosaicTtyInitResult tty_initWithFds(
 	int stdinReadFd,
 	int stdoutWriteFd,
@@ -27,28 +102,44 @@ MosaicTtyInitResult tty_initWithFds(
 		goto ret;
 	}
 
-	int interrupt_pipe[2];
-	if (unlikely(pipe(interrupt_pipe)) != 0) {
-		result.error = errno;
+	result.error = pthread_mutex_init(&tty->reactor_lock, NULL);
+	if (unlikely(result.error)) {
 		goto err;
 	}
 
+	int interruptReadFd = -1;
+	int interruptWriteFd = -1;
+	result.error = interruptInit(&interruptReadFd, &interruptWriteFd);
+	if (unlikely(result.error)) {
+		goto err_lock;
+	}
+
 	tty->stdin_read_fd = stdinReadFd;
 	tty->stdout_write_fd = stdoutWriteFd;
 	tty->stderr_write_fd = stderrWriteFd;
-	tty->interrupt_read_fd = interrupt_pipe[0];
-	tty->interrupt_write_fd = interrupt_pipe[1];
+	tty->interrupt_read_fd = interruptReadFd;
+	tty->interrupt_write_fd = interruptWriteFd;
+	tty->sigwinch_read_fd = -1;
+	tty->sigwinch_write_fd = -1;
+	eventQueue_init(&tty->events);
+	atomic_init(&tty->sigwinch_next, NULL);
+	atomic_init(&tty->reactor, NULL);
+	atomic_init(&tty->input_armed, false);
 
 	result.tty = tty;
 
 	ret:
 	return result;
 
+	err_lock:
+	pthread_mutex_destroy(&tty->reactor_lock);
 	err:
 	free(tty);
 	goto ret;
 }
 
+// The instance bound to the standard streams by tty_init. Instances bound to other fds with
+// tty_initWithFds are unrestricted.
 static _Atomic(MosaicTty *) globalTty;
 
 MosaicTtyInitResult tty_init() {
@@ -70,46 +161,299 @@ void tty_setCallback(MosaicTty *tty, MosaicTtyCallback *callback) {
 	tty->callback = callback;
 }
 
+int tty_readEvents(MosaicTty *tty, MosaicTtyEvent *events, int count) {
+	return eventQueue_pop(&tty->events, events, count);
+}
+
+int64_t tty_monotonicNanos() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Like poll, but waits until [deadlineNanos] on the [tty_monotonicNanos] clock rather than for a
+ * duration. A negative [deadlineNanos] waits indefinitely.
+ */
+static int pollUntil(struct pollfd *fds, nfds_t count, int64_t deadlineNanos) {
+	if (deadlineNanos < 0) {
+		return poll(fds, count, -1);
+	}
+	int64_t remaining = deadlineNanos - tty_monotonicNanos();
+	if (remaining < 0) {
+		remaining = 0;
+	}
+#if defined(__linux__)
+	struct timespec timeout = {
+		.tv_sec = remaining / 1000000000,
+		.tv_nsec = remaining % 1000000000,
+	};
+	return ppoll(fds, count, &timeout, NULL);
+#else
+	// There is no ppoll, so round up to whole milliseconds to never return before the deadline.
+	int64_t millis = (remaining + 999999) / 1000000;
+	return poll(fds, count, millis > INT_MAX ? INT_MAX : (int) millis);
+#endif
+}
+
+static void tty_dispatchResize(MosaicTty *tty) {
+	// Any number of signals since the last dispatch result in a single size query.
+	if (unlikely(drainNotifications(tty->sigwinch_read_fd) != 0)) {
+		// TODO Send errno somewhere? Maybe once we get debug logs working.
+	}
+
+	struct winsize size;
+	if (ioctl(tty->stdin_read_fd, TIOCGWINSZ, &size) != -1) {
+		MosaicTtyCallback *callback = tty->callback;
+		if (likely(callback)) {
+			MosaicTtyEvent event = {
+				.type = MOSAIC_TTY_EVENT_RESIZE,
+				.values = { size.ws_col, size.ws_row, size.ws_xpixel, size.ws_ypixel },
+			};
+			if (unlikely(!eventQueue_push(&tty->events, &event))) {
+				// TODO Send warning somewhere? Maybe once we get debug logs working.
+			}
+			callback->onEvents(callback->opaque);
+		} else {
+			// TODO Send warning somewhere? Maybe once we get debug logs working.
+		}
+	} else {
+		// TODO Send errno somewhere? Maybe once we get debug logs working.
+	}
+}
+
+static void ttyReactor_rearmInput(MosaicTty *tty);
+
+#if defined(MOSAIC_TTY_IO_URING)
+
+// Sizes the fixed buffer which receives reads. Reads may return fewer bytes than requested, so a
+// larger count is simply truncated.
+#define URING_INPUT_SIZE 8192
+
+// The user_data of each kind of operation.
+#define URING_READ 1
+#define URING_INTERRUPT 2
+#define URING_RESIZE 3
+#define URING_CANCEL 4
+#define URING_WRITE 5
+
+// Prepared entries are submitted by the next wait, and at most four operations are in flight for
+// a read. A full submission queue therefore indicates a bug, and is reported rather than waited on.
+#define URING_FULL EBUSY
+
+static uint32_t uring_preparePoll(MosaicTtyUring *ring, int fd, uint64_t userData) {
+	struct io_uring_sqe *sqe = uring_prepare(ring);
+	if (unlikely(sqe == NULL)) {
+		return URING_FULL;
+	}
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll32_events = POLLIN;
+	sqe->user_data = userData;
+	return 0;
+}
+
+/**
+ * Behaves like the poll-based implementation of tty_readInputInternal, but submits the read of
+ * stdin along with any polls of the interrupt and resize notification fds and waits for the
+ * first completion in a single system call.
+ */
+static MosaicTtyIoResult tty_readInputUring(
+	MosaicTty *tty,
+	uint8_t *buffer,
+	int count,
+	int64_t deadlineNanos,
+	bool resizes,
+	bool consumeInterrupt
+) {
+	MosaicTtyIoResult result = {};
+	MosaicTtyUring *ring = tty->input_ring;
+
+	if (!tty->interrupt_polled) {
+		result.error = uring_preparePoll(ring, tty->interrupt_read_fd, URING_INTERRUPT);
+		if (unlikely(result.error)) {
+			return result;
+		}
+		tty->interrupt_polled = true;
+	}
+	if (resizes && !tty->sigwinch_polled) {
+		result.error = uring_preparePoll(ring, tty->sigwinch_read_fd, URING_RESIZE);
+		if (unlikely(result.error)) {
+			return result;
+		}
+		tty->sigwinch_polled = true;
+	}
+
+	if (count > URING_INPUT_SIZE) {
+		count = URING_INPUT_SIZE;
+	}
+	struct io_uring_sqe *sqe = uring_prepare(ring);
+	if (unlikely(sqe == NULL)) {
+		result.error = URING_FULL;
+		return result;
+	}
+	sqe->opcode = IORING_OP_READ_FIXED;
+	sqe->fd = tty->stdin_read_fd;
+	// Read from the current position rather than offset 0 in case stdin is a file.
+	sqe->off = (uint64_t) -1;
+	sqe->addr = (uintptr_t) ring->buffer;
+	sqe->len = count;
+	sqe->buf_index = 0;
+	sqe->user_data = URING_READ;
+
+	// Once the read is canceled, wait for its completion which may still carry bytes.
+	bool canceled = false;
+	bool interrupted = false;
+	while (true) {
+		int64_t timeoutNanos = -1;
+		if (deadlineNanos >= 0 && !canceled) {
+			timeoutNanos = deadlineNanos - tty_monotonicNanos();
+			if (timeoutNanos < 0) {
+				timeoutNanos = 0;
+			}
+		}
+		uint32_t error = uring_enter(ring, timeoutNanos);
+		if (unlikely(error != 0 && error != EINTR)) {
+			result.error = error;
+			break;
+		}
+
+		bool done = false;
+		struct io_uring_cqe *cqe;
+		while ((cqe = uring_peek(ring)) != NULL) {
+			uint64_t userData = cqe->user_data;
+			int res = cqe->res;
+			uring_advance(ring);
+
+			if (userData == URING_READ) {
+				done = true;
+				if (likely(res > 0)) {
+					memcpy(buffer, ring->buffer, res);
+					result.count = res;
+				} else if (res == 0) {
+					result.count = -1; // EOF
+				} else if (res != -ECANCELED) {
+					result.error = -res;
+				}
+			} else if (userData == URING_INTERRUPT) {
+				tty->interrupt_polled = false;
+				interrupted = true;
+			} else if (userData == URING_RESIZE) {
+				tty->sigwinch_polled = false;
+				tty_dispatchResize(tty);
+				// Submitted by the next wait, or by the next read if this one is done.
+				if (resizes && likely(uring_preparePoll(ring, tty->sigwinch_read_fd, URING_RESIZE) == 0)) {
+					tty->sigwinch_polled = true;
+				}
+			}
+		}
+		if (done) {
+			break;
+		}
+
+		bool timedOut = deadlineNanos >= 0 && tty_monotonicNanos() >= deadlineNanos;
+		if (!canceled && (interrupted || timedOut)) {
+			struct io_uring_sqe *cancel = uring_prepare(ring);
+			if (unlikely(cancel == NULL)) {
+				result.error = URING_FULL;
+				break;
+			}
+			cancel->opcode = IORING_OP_ASYNC_CANCEL;
+			cancel->addr = URING_READ;
+			cancel->user_data = URING_CANCEL;
+			canceled = true;
+		}
+	}
+
+	if (interrupted && consumeInterrupt && result.count == 0 && result.error == 0) {
+		// Like the poll-based implementation, an interrupt is only consumed when it ends a read.
+		// Otherwise the fd remains readable and the next read returns 0 immediately.
+		result.error = drainNotifications(tty->interrupt_read_fd);
+	} else if (interrupted && likely(uring_preparePoll(ring, tty->interrupt_read_fd, URING_INTERRUPT) == 0)) {
+		tty->interrupt_polled = true;
+	}
+
+	return result;
+}
+
+#endif
+
+/**
+ * Wait for stdin or the interrupt fd to become readable, or for the deadline to pass. A negative
+ * [deadlineNanos] waits indefinitely. Unlike select, poll has no limit on the value of an fd.
+ *
+ * Window resizes which arrive while waiting are queued and the callback is notified on this
+ * thread. They do not end the wait.
+ *
+ * When [consumeInterrupt] is false an interrupt still ends the wait, but it remains pending so
+ * that the next read also returns 0 immediately.
+ */
 static MosaicTtyIoResult tty_readInputInternal(
 	MosaicTty *tty,
 	uint8_t *buffer,
 	int count,
-	struct timeval *timeout
+	int64_t deadlineNanos,
+	bool consumeInterrupt
 ) {
 	MosaicTtyIoResult result = {};
 
 	int stdinReadFd = tty->stdin_read_fd;
 	int interruptReadFd = tty->interrupt_read_fd;
 
-	fd_set fds;
-	FD_ZERO(&fds);
-	FD_SET(stdinReadFd, &fds);
-	FD_SET(interruptReadFd, &fds);
-
-	int nfds = 1 + ((stdinReadFd > interruptReadFd) ? stdinReadFd : interruptReadFd);
-	if (likely(select(nfds, &fds, NULL, NULL, timeout) >= 0)) {
-		if (likely(FD_ISSET(stdinReadFd, &fds) != 0)) {
-			int c = read(stdinReadFd, buffer, count);
-			if (likely(c > 0)) {
-				result.count = c;
-			} else if (c == 0) {
-				result.count = -1; // EOF
-			} else {
-				goto err;
+	// A negative fd is ignored by poll, so this entry is inert until resize events are enabled. A
+	// reactor dispatches resizes on its own thread, so they are not also dispatched here. It may be
+	// removed while blocked, so this pointer is only used to decide what to wait for.
+	MosaicTtyReactor *reactor = atomic_load(&tty->reactor);
+#if defined(MOSAIC_TTY_IO_URING)
+	if (tty->input_ring) {
+		bool resizes = reactor == NULL && tty->sigwinch_read_fd != -1;
+		result = tty_readInputUring(tty, buffer, count, deadlineNanos, resizes, consumeInterrupt);
+		goto ret;
+	}
+#endif
+	struct pollfd fds[3] = {
+		{ .fd = stdinReadFd, .events = POLLIN },
+		{ .fd = interruptReadFd, .events = POLLIN },
+		{ .fd = reactor ? -1 : tty->sigwinch_read_fd, .events = POLLIN },
+	};
+
+	// Signals and resizes interrupt the wait. Waiting against a fixed deadline means repeated
+	// occurrences do not extend the total time spent waiting.
+	while (true) {
+		int ready = pollUntil(fds, 3, deadlineNanos);
+		if (likely(ready > 0)) {
+			if (unlikely(fds[2].revents != 0)) {
+				tty_dispatchResize(tty);
 			}
-		} else if (unlikely(FD_ISSET(interruptReadFd, &fds) != 0)) {
-			// Consume the single notification byte to clear the ready state for the next call.
-			int c = read(interruptReadFd, buffer, 1);
-			if (unlikely(c < 0)) {
-				goto err;
+			if (likely(fds[0].revents != 0 || fds[1].revents != 0)) {
+				break;
 			}
+		} else if (ready == 0) {
+			break; // Timed out.
+		} else if (errno != EINTR) {
+			goto err;
 		}
-		// Otherwise if the interrupt pipe was selected or we timed out, return a count of 0.
-	} else {
-		goto err;
 	}
 
+	if (likely(fds[0].revents != 0)) {
+		// Includes POLLHUP and POLLERR so that the read can report EOF or the error.
+		int c = read(stdinReadFd, buffer, count);
+		if (likely(c > 0)) {
+			result.count = c;
+		} else if (c == 0) {
+			result.count = -1; // EOF
+		} else {
+			goto err;
+		}
+	} else if (unlikely(fds[1].revents != 0) && consumeInterrupt) {
+		// Consume all pending interrupts to clear the ready state for the next call.
+		result.error = drainNotifications(interruptReadFd);
+	}
+	// Otherwise if the interrupt fd was ready or we timed out, return a count of 0.
+
 	ret:
+	// Report the next time input is available, whether or not this read consumed all of it.
+	ttyReactor_rearmInput(tty);
 	return result;
 
 	err:
@@ -118,7 +462,7 @@ static MosaicTtyIoResult tty_readInputInternal(
 }
 
 MosaicTtyIoResult tty_readInput(MosaicTty *tty, uint8_t *buffer, int count) {
-	return tty_readInputInternal(tty, buffer, count, NULL);
+	return tty_readInputInternal(tty, buffer, count, -1, true);
 }
 
 MosaicTtyIoResult tty_readInputWithTimeout(
@@ -127,11 +471,48 @@ MosaicTtyIoResult tty_readInputWithTimeout(
 	int count,
 	int timeoutMillis
 ) {
-	struct timeval timeout;
-	timeout.tv_sec = 0;
-	timeout.tv_usec = timeoutMillis * 1000;
+	int64_t deadlineNanos = timeoutMillis >= 0
+		? tty_monotonicNanos() + (int64_t) timeoutMillis * 1000000
+		: -1;
+	return tty_readInputInternal(tty, buffer, count, deadlineNanos, true);
+}
+
+MosaicTtyIoResult tty_readInputUntil(
+	MosaicTty *tty,
+	uint8_t *buffer,
+	int count,
+	int minCount,
+	int64_t deadlineNanos
+) {
+	MosaicTtyIoResult result = {};
+	if (minCount > count) {
+		minCount = count;
+	}
+
+	// Each read returns whatever is available, so keep reading into the remainder of the buffer
+	// until enough has accumulated. Bursts of input are then returned together.
+	do {
+		// Once bytes have been read an interrupt is left pending rather than consumed. Those bytes are
+		// returned instead of 0, and the next call will then report the interrupt.
+		MosaicTtyIoResult read = tty_readInputInternal(
+			tty,
+			buffer + result.count,
+			count - result.count,
+			deadlineNanos,
+			result.count == 0
+		);
+		if (unlikely(read.error != 0 || read.count <= 0)) {
+			// An interrupt or the deadline ends the wait early. Return any bytes already read rather
+			// than an error, EOF, or interrupt, each of which will recur on the next call.
+			if (result.count == 0) {
+				result = read;
+			}
+			break;
+		}
+		result.count += read.count;
+	} while (result.count < minCount);
 
-	return tty_readInputInternal(tty, buffer, count, &timeout);
+	return result;
 }
 
 MosaicTtyIoResult tty_writeInternal(int writeFd, uint8_t *buffer, int count) {
@@ -148,34 +529,469 @@ MosaicTtyIoResult tty_writeInternal(int writeFd, uint8_t *buffer, int count) {
 }
 
 uint32_t tty_interruptRead(MosaicTty *tty) {
+#if defined(__linux__)
+	uint64_t value = 1;
+	MosaicTtyIoResult result = tty_writeInternal(tty->interrupt_write_fd, (uint8_t *) &value, sizeof(value));
+#else
 	uint8_t space[1] = { ' ' };
 	MosaicTtyIoResult result = tty_writeInternal(tty->interrupt_write_fd, space, 1);
-	return result.error;
+#endif
+	// A full pipe or a saturated eventfd already has an interrupt pending.
+	return result.error == EAGAIN ? 0 : result.error;
+}
+
+/**
+ * Copy the bytes of the segments, in order, into the queue. Once the queue is full, wait for the
+ * writer thread to make room until at least @p minCount bytes have been queued. A @p minCount of
+ * 0 never waits. A write error from the writer thread which has not yet been reported is returned
+ * instead.
+ */
+static MosaicTtyIoResult asyncOutput_enqueue(
+	MosaicTtyAsyncOutput *output,
+	uint8_t **buffers,
+	int *counts,
+	int segmentCount,
+	int minCount
+) {
+	MosaicTtyIoResult result = {};
+
+	pthread_mutex_lock(&output->lock);
+	int capacity = output->capacity;
+	int segment = 0;
+	int segmentOffset = 0; // Bytes of the current segment already queued.
+	while (true) {
+		if (unlikely(output->error)) {
+			result.error = output->error;
+			output->error = 0;
+			break;
+		}
+
+		int queued = 0;
+		while (segment < segmentCount) {
+			int remaining = counts[segment] - segmentOffset;
+			int available = capacity - output->count;
+			int count = remaining < available ? remaining : available;
+			int end = (output->start + output->count) % capacity;
+			int first = count < capacity - end ? count : capacity - end;
+			memcpy(output->buffer + end, buffers[segment] + segmentOffset, first);
+			memcpy(output->buffer, buffers[segment] + segmentOffset + first, count - first);
+			output->count += count;
+			queued += count;
+			if (count < remaining) {
+				segmentOffset += count;
+				break; // Full.
+			}
+			segment++;
+			segmentOffset = 0;
+		}
+		if (likely(queued)) {
+			pthread_cond_signal(&output->queued);
+			result.count += queued;
+		}
+
+		if (segment == segmentCount || result.count >= minCount) {
+			break;
+		}
+		pthread_cond_wait(&output->written, &output->lock);
+	}
+	pthread_mutex_unlock(&output->lock);
+
+	return result;
 }
 
 MosaicTtyIoResult tty_writeOutput(MosaicTty *tty, uint8_t *buffer, int count) {
+	MosaicTtyAsyncOutput *asyncOutput = tty->async_output;
+	if (asyncOutput) {
+		// Like a blocking write, wait until at least one byte fits rather than returning 0.
+		return asyncOutput_enqueue(asyncOutput, &buffer, &count, 1, count > 0 ? 1 : 0);
+	}
 	return tty_writeInternal(tty->stdout_write_fd, buffer, count);
 }
 
-MosaicTtyIoResult tty_writeError(MosaicTty *tty, uint8_t *buffer, int count) {
-	return tty_writeInternal(tty->stderr_write_fd, buffer, count);
+/** The number of segments passed to each writev call. Larger counts are split across calls. */
+#define WRITEV_BATCH 64
+
+MosaicTtyIoResult tty_writeOutputv(MosaicTty *tty, uint8_t **buffers, int *counts, int segmentCount) {
+	MosaicTtyIoResult result = {};
+
+	MosaicTtyAsyncOutput *asyncOutput = tty->async_output;
+	if (asyncOutput) {
+		return asyncOutput_enqueue(asyncOutput, buffers, counts, segmentCount, INT_MAX);
+	}
+
+	int writeFd = tty->stdout_write_fd;
+	struct iovec iov[WRITEV_BATCH];
+	int segment = 0;
+	int segmentOffset = 0; // Bytes of the current segment already written.
+	while (segment < segmentCount) {
+		int iovCount = 0;
+		for (int i = segment; i < segmentCount && iovCount < WRITEV_BATCH; i++) {
+			int skip = i == segment ? segmentOffset : 0;
+			iov[iovCount].iov_base = buffers[i] + skip;
+			iov[iovCount].iov_len = counts[i] - skip;
+			iovCount++;
+		}
+
+		ssize_t written = writev(writeFd, iov, iovCount);
+		if (unlikely(written < 0)) {
+			if (errno == EINTR) {
+				continue;
+			}
+			result.error = errno;
+			break;
+		}
+		result.count += written;
+
+		// Skip past every segment which was fully written and into one which was partially written.
+		while (segment < segmentCount) {
+			int remaining = counts[segment] - segmentOffset;
+			if (written < remaining) {
+				segmentOffset += written;
+				break;
+			}
+			written -= remaining;
+			segment++;
+			segmentOffset = 0;
+		}
+	}
+
+	return result;
 }
 
-void sigwinchHandler(int value UNUSED) {
-	MosaicTty *tty = atomic_load(&globalTty);
-	if (likely(tty)) {
-		struct winsize size;
-		if (ioctl(tty->stdin_read_fd, TIOCGWINSZ, &size) != -1) {
-			MosaicTtyCallback *callback = tty->callback;
-			if (likely(callback)) {
-				callback->onResize(callback->opaque, size.ws_col, size.ws_row, size.ws_xpixel, size.ws_ypixel);
-			} else {
-				// TODO Send warning somewhere? Maybe once we get debug logs working.
+/** The size of the output buffer when first used. It doubles as needed to fit a whole frame. */
+#define OUTPUT_BUFFER_INITIAL_CAPACITY 8192
+
+MosaicTtyIoResult tty_bufferOutput(MosaicTty *tty, uint8_t *buffer, int count) {
+	MosaicTtyIoResult result = {};
+
+	int required = tty->output_count + count;
+	if (unlikely(required > tty->output_capacity)) {
+		int capacity = tty->output_capacity ? tty->output_capacity : OUTPUT_BUFFER_INITIAL_CAPACITY;
+		while (capacity < required) {
+			capacity *= 2;
+		}
+		uint8_t *grown = realloc(tty->output_buffer, capacity);
+		if (unlikely(grown == NULL)) {
+			result.error = ENOMEM;
+			goto ret;
+		}
+		tty->output_buffer = grown;
+		tty->output_capacity = capacity;
+	}
+
+	memcpy(tty->output_buffer + tty->output_count, buffer, count);
+	tty->output_count = required;
+	result.count = count;
+
+	ret:
+	return result;
+}
+
+#if defined(MOSAIC_TTY_IO_URING)
+
+static MosaicTtyIoResult tty_flushOutputUring(MosaicTty *tty, uint8_t *buffer, int count) {
+	MosaicTtyIoResult result = {};
+	MosaicTtyUring *ring = tty->output_ring;
+
+	// The output buffer moves when it grows, after which it must be registered again. If it cannot
+	// be registered (such as when exceeding RLIMIT_MEMLOCK on older kernels), write without it.
+	bool fixed = ring->buffer == buffer && ring->buffer_size == (size_t) tty->output_capacity;
+	if (!fixed) {
+		fixed = uring_registerBuffer(ring, buffer, tty->output_capacity) == 0;
+	}
+
+	while (result.count < count) {
+		struct io_uring_sqe *sqe = uring_prepare(ring);
+		if (unlikely(sqe == NULL)) {
+			result.error = URING_FULL;
+			break;
+		}
+		sqe->opcode = fixed ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+		sqe->fd = tty->stdout_write_fd;
+		// Write at the current position rather than offset 0 in case stdout is a file.
+		sqe->off = (uint64_t) -1;
+		sqe->addr = (uintptr_t) (buffer + result.count);
+		sqe->len = count - result.count;
+		sqe->buf_index = 0;
+		sqe->user_data = URING_WRITE;
+
+		struct io_uring_cqe *cqe;
+		while ((cqe = uring_peek(ring)) == NULL) {
+			uint32_t error = uring_enter(ring, -1);
+			if (unlikely(error != 0 && error != EINTR)) {
+				result.error = error;
+				return result;
 			}
-		} else {
-			// TODO Send errno somewhere? Maybe once we get debug logs working.
 		}
+		int res = cqe->res;
+		uring_advance(ring);
+		if (unlikely(res < 0)) {
+			if (res == -EINTR) {
+				continue;
+			}
+			result.error = -res;
+			break;
+		}
+		result.count += res;
+	}
+
+	return result;
+}
+
+#endif
+
+MosaicTtyIoResult tty_flushOutput(MosaicTty *tty) {
+	MosaicTtyIoResult result = {};
+
+	int writeFd = tty->stdout_write_fd;
+	uint8_t *buffer = tty->output_buffer;
+	int count = tty->output_count;
+	MosaicTtyAsyncOutput *asyncOutput = tty->async_output;
+	if (asyncOutput) {
+		result = asyncOutput_enqueue(asyncOutput, &buffer, &count, 1, 0);
+#if defined(MOSAIC_TTY_IO_URING)
+	} else if (tty->output_ring && count != 0) {
+		result = tty_flushOutputUring(tty, buffer, count);
+#endif
+	} else {
+		while (result.count < count) {
+			int written = write(writeFd, buffer + result.count, count - result.count);
+			if (unlikely(written < 0)) {
+				if (errno == EINTR) {
+					continue;
+				}
+				result.error = errno;
+				break;
+			}
+			result.count += written;
+		}
+	}
+
+	// On error or when the async queue is full, retain whatever was not written so that a
+	// subsequent flush can retry.
+	tty->output_count = count - result.count;
+	if (unlikely(tty->output_count != 0)) {
+		memmove(buffer, buffer + result.count, tty->output_count);
+	}
+
+	return result;
+}
+
+static void *asyncOutput_run(void *arg) {
+	MosaicTtyAsyncOutput *output = arg;
+
+	pthread_mutex_lock(&output->lock);
+	while (true) {
+		while (output->count == 0 && !output->stopping) {
+			pthread_cond_wait(&output->queued, &output->lock);
+		}
+		if (output->count == 0) {
+			break; // Stopping, and all queued bytes were written.
+		}
+
+		// Only this thread advances start, and bytes are only queued after start + count, so the
+		// queued bytes can be written without holding the lock.
+		int start = output->start;
+		int contiguous = output->capacity - start;
+		int count = output->count < contiguous ? output->count : contiguous;
+		pthread_mutex_unlock(&output->lock);
+
+		ssize_t written = write(output->write_fd, output->buffer + start, count);
+		int writeErrno = errno;
+
+		pthread_mutex_lock(&output->lock);
+		if (likely(written >= 0)) {
+			output->start = (start + written) % output->capacity;
+			output->count -= written;
+		} else if (writeErrno != EINTR) {
+			// Drop everything which was queued. The error is reported by the next call.
+			output->error = writeErrno;
+			output->start = 0;
+			output->count = 0;
+		}
+		pthread_cond_broadcast(&output->written);
+	}
+	pthread_mutex_unlock(&output->lock);
+
+	return NULL;
+}
+
+uint32_t tty_enableAsyncOutput(MosaicTty *tty, int capacity) {
+	uint32_t result = 0;
+
+	if (unlikely(tty->async_output || capacity <= 0)) {
+		result = EINVAL;
+		goto ret;
+	}
+
+	MosaicTtyAsyncOutput *output = calloc(1, sizeof(MosaicTtyAsyncOutput));
+	if (unlikely(output == NULL)) {
+		result = ENOMEM;
+		goto ret;
+	}
+	output->buffer = malloc(capacity);
+	if (unlikely(output->buffer == NULL)) {
+		result = ENOMEM;
+		goto err_output;
 	}
+	output->capacity = capacity;
+	output->write_fd = tty->stdout_write_fd;
+
+	if (unlikely((result = pthread_mutex_init(&output->lock, NULL)))) {
+		goto err_buffer;
+	}
+	if (unlikely((result = pthread_cond_init(&output->queued, NULL)))) {
+		goto err_lock;
+	}
+	pthread_condattr_t writtenAttr;
+	if (unlikely((result = pthread_condattr_init(&writtenAttr)))) {
+		goto err_queued;
+	}
+#if defined(__linux__)
+	// Wait for writes against the monotonic clock so that wall clock changes do not affect timeouts.
+	if (unlikely((result = pthread_condattr_setclock(&writtenAttr, CLOCK_MONOTONIC)))) {
+		pthread_condattr_destroy(&writtenAttr);
+		goto err_queued;
+	}
+#endif
+	result = pthread_cond_init(&output->written, &writtenAttr);
+	pthread_condattr_destroy(&writtenAttr);
+	if (unlikely(result)) {
+		goto err_queued;
+	}
+	if (unlikely((result = pthread_create(&output->thread, NULL, asyncOutput_run, output)))) {
+		goto err_written;
+	}
+
+	tty->async_output = output;
+
+	ret:
+	return result;
+
+	err_written:
+	pthread_cond_destroy(&output->written);
+	err_queued:
+	pthread_cond_destroy(&output->queued);
+	err_lock:
+	pthread_mutex_destroy(&output->lock);
+	err_buffer:
+	free(output->buffer);
+	err_output:
+	free(output);
+	goto ret;
+}
+
+MosaicTtyIoResult tty_awaitOutput(MosaicTty *tty, int timeoutMillis) {
+	MosaicTtyIoResult result = {};
+
+	MosaicTtyAsyncOutput *output = tty->async_output;
+	if (!output) {
+		goto ret; // Writes are synchronous.
+	}
+
+	struct timespec deadline;
+	if (timeoutMillis >= 0) {
+		// The written condition uses the monotonic clock where it can be configured (not on macOS).
+#if defined(__linux__)
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+#else
+		clock_gettime(CLOCK_REALTIME, &deadline);
+#endif
+		deadline.tv_sec += timeoutMillis / 1000;
+		deadline.tv_nsec += (long) (timeoutMillis % 1000) * 1000000;
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+	}
+
+	pthread_mutex_lock(&output->lock);
+	while (output->count != 0 && !output->error) {
+		if (timeoutMillis < 0) {
+			pthread_cond_wait(&output->written, &output->lock);
+		} else if (pthread_cond_timedwait(&output->written, &output->lock, &deadline) == ETIMEDOUT) {
+			break;
+		}
+	}
+	if (unlikely(output->error)) {
+		result.error = output->error;
+		output->error = 0;
+	} else {
+		result.count = output->count;
+	}
+	pthread_mutex_unlock(&output->lock);
+
+	ret:
+	return result;
+}
+
+static uint32_t asyncOutput_free(MosaicTtyAsyncOutput *output) {
+	pthread_mutex_lock(&output->lock);
+	output->stopping = true;
+	pthread_cond_signal(&output->queued);
+	pthread_mutex_unlock(&output->lock);
+
+	// The writer thread exits once all queued bytes are written.
+	uint32_t result = pthread_join(output->thread, NULL);
+	if (result == 0) {
+		result = output->error;
+	}
+
+	pthread_cond_destroy(&output->written);
+	pthread_cond_destroy(&output->queued);
+	pthread_mutex_destroy(&output->lock);
+	free(output->buffer);
+	free(output);
+	return result;
+}
+
+MosaicTtyIoResult tty_writeError(MosaicTty *tty, uint8_t *buffer, int count) {
+	return tty_writeInternal(tty->stderr_write_fd, buffer, count);
+}
+
+// Instances with window resize events enabled, linked through sigwinch_next. Only modified while
+// holding sigwinchLock, but traversed by sigwinchHandler without it.
+static pthread_mutex_t sigwinchLock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic(MosaicTty *) sigwinchTtys;
+// The number of sigwinchHandler invocations currently traversing sigwinchTtys.
+static atomic_int sigwinchHandlers;
+
+static void sigwinchHandler(int value UNUSED) {
+	// Only async-signal-safe functions may be called here, so notify each read loop or reactor
+	// which queries the size and queues an event on its own thread. The signal does not say which
+	// terminal changed size, so every instance is notified.
+	int savedErrno = errno;
+	atomic_fetch_add(&sigwinchHandlers, 1);
+	for (MosaicTty *tty = atomic_load(&sigwinchTtys); tty; tty = atomic_load(&tty->sigwinch_next)) {
+		uint8_t notification = 1;
+		// A full pipe already has a notification pending.
+		if (write(tty->sigwinch_write_fd, &notification, 1)) {}
+	}
+	atomic_fetch_sub(&sigwinchHandlers, 1);
+	errno = savedErrno;
+}
+
+static uint32_t sigwinchRemove(MosaicTty *tty) {
+	uint32_t result = 0;
+
+	pthread_mutex_lock(&sigwinchLock);
+	_Atomic(MosaicTty *) *link = &sigwinchTtys;
+	MosaicTty *current;
+	while ((current = atomic_load(link)) != tty) {
+		link = &current->sigwinch_next;
+	}
+	atomic_store(link, atomic_load(&tty->sigwinch_next));
+	if (atomic_load(&sigwinchTtys) == NULL && unlikely(signal(SIGWINCH, SIG_DFL) == SIG_ERR)) {
+		result = errno;
+	}
+	pthread_mutex_unlock(&sigwinchLock);
+
+	// A handler which began before the removal may still be writing to this instance's pipe.
+	while (atomic_load(&sigwinchHandlers) != 0) {
+		sched_yield();
+	}
+
+	return result;
 }
 
 uint32_t tty_enableRawMode(MosaicTty *tty) {
@@ -231,16 +1047,101 @@ uint32_t tty_enableWindowResizeEvents(MosaicTty *tty) {
 		return 0; // Already installed.
 	}
 
-	struct sigaction action;
-	action.sa_handler = sigwinchHandler;
-	sigemptyset(&action.sa_mask);
-	action.sa_flags = 0;
+	if (tty->sigwinch_read_fd == -1) {
+		uint32_t error = nonBlockingPipe(&tty->sigwinch_read_fd, &tty->sigwinch_write_fd);
+		if (unlikely(error)) {
+			return error;
+		}
+	}
+
+	uint32_t result = 0;
+
+	pthread_mutex_lock(&sigwinchLock);
+	if (atomic_load(&sigwinchTtys) == NULL) {
+		// The handler is shared by all instances, so it is only installed for the first.
+		struct sigaction action;
+		action.sa_handler = sigwinchHandler;
+		sigemptyset(&action.sa_mask);
+		action.sa_flags = 0;
+
+		if (unlikely(sigaction(SIGWINCH, &action, NULL) != 0)) {
+			result = errno;
+			goto unlock;
+		}
+	}
+	atomic_store(&tty->sigwinch_next, atomic_load(&sigwinchTtys));
+	atomic_store(&sigwinchTtys, tty);
+	tty->sigwinch = true;
+
+	unlock:
+	pthread_mutex_unlock(&sigwinchLock);
+	return result;
+}
 
-	if (likely(sigaction(SIGWINCH, &action, NULL) == 0)) {
-		tty->sigwinch = true;
-		return 0;
+#if defined(MOSAIC_TTY_IO_URING)
+
+static void tty_freeUring(MosaicTty *tty) {
+	if (tty->input_ring) {
+		uring_free(tty->input_ring);
+		free(tty->input_ring->buffer);
+		free(tty->input_ring);
+		tty->input_ring = NULL;
+	}
+	if (tty->output_ring) {
+		uring_free(tty->output_ring);
+		free(tty->output_ring);
+		tty->output_ring = NULL;
 	}
-	return errno;
+}
+
+#endif
+
+uint32_t tty_enableIoUring(MosaicTty *tty) {
+#if defined(MOSAIC_TTY_IO_URING)
+	if (tty->input_ring) {
+		return 0; // Already enabled!
+	}
+
+	uint32_t result = 0;
+
+	// Reads and flushes happen on different threads, so each has its own ring. Rings are not shared
+	// with other instances or a reactor, so submissions are never batched across instances.
+	MosaicTtyUring *inputRing = calloc(1, sizeof(MosaicTtyUring));
+	MosaicTtyUring *outputRing = calloc(1, sizeof(MosaicTtyUring));
+	uint8_t *inputBuffer = malloc(URING_INPUT_SIZE);
+	if (unlikely(inputRing == NULL || outputRing == NULL || inputBuffer == NULL)) {
+		result = ENOMEM;
+		goto err;
+	}
+
+	result = uring_init(inputRing, 8);
+	if (unlikely(result)) {
+		goto err;
+	}
+	result = uring_registerBuffer(inputRing, inputBuffer, URING_INPUT_SIZE);
+	if (unlikely(result)) {
+		uring_free(inputRing);
+		goto err;
+	}
+	result = uring_init(outputRing, 2);
+	if (unlikely(result)) {
+		uring_free(inputRing);
+		goto err;
+	}
+
+	tty->input_ring = inputRing;
+	tty->output_ring = outputRing;
+	return 0;
+
+	err:
+	free(inputBuffer);
+	free(outputRing);
+	free(inputRing);
+	return result;
+#else
+	(void) tty;
+	return ENOSYS;
+#endif
 }
 
 MosaicTtyTerminalSizeResult tty_currentTerminalSize(MosaicTty *tty) {
@@ -262,27 +1163,437 @@ MosaicTtyTerminalSizeResult tty_currentTerminalSize(MosaicTty *tty) {
 uint32_t tty_free(MosaicTty *tty) {
 	uint32_t result = 0;
 
-	if (unlikely(close(tty->interrupt_read_fd) != 0)) {
-		result = errno;
+	// Stop watching the fds before any of them are closed.
+	MosaicTtyReactor *reactor = atomic_load(&tty->reactor);
+	if (reactor) {
+		result = ttyReactor_remove(reactor, tty);
 	}
-	if (unlikely(close(tty->interrupt_write_fd) != 0 && result != 0)) {
-		result = errno;
+
+	// Write any queued output before the terminal settings it relies on are restored.
+	if (tty->async_output) {
+		uint32_t error = asyncOutput_free(tty->async_output);
+		if (result == 0) {
+			result = error;
+		}
 	}
 
-	if (tty->sigwinch && signal(SIGWINCH, SIG_DFL) == SIG_ERR && result != 0) {
-		result = errno;
+#if defined(MOSAIC_TTY_IO_URING)
+	// Cancel any reads or polls in flight before their fds are closed.
+	tty_freeUring(tty);
+#endif
+
+	uint32_t interruptError = interruptFree(tty->interrupt_read_fd, tty->interrupt_write_fd);
+	if (result == 0) {
+		result = interruptError;
+	}
+
+	if (tty->sigwinch) {
+		uint32_t error = sigwinchRemove(tty);
+		if (result == 0) {
+			result = error;
+		}
+	}
+	// Only close the notification pipe once the handler can no longer write to it.
+	if (tty->sigwinch_read_fd != -1) {
+		uint32_t error = interruptFree(tty->sigwinch_read_fd, tty->sigwinch_write_fd);
+		if (result == 0) {
+			result = error;
+		}
 	}
 
 	if (tty->saved) {
-		if (tcsetattr(tty->stdin_read_fd, TCSAFLUSH, tty->saved) && result != 0) {
+		if (tcsetattr(tty->stdin_read_fd, TCSAFLUSH, tty->saved) && result == 0) {
 			result = errno;
 		}
 		free(tty->saved);
 	}
 
-	atomic_store(&globalTty, NULL);
+	// Only unbind the global instance if this is it, and not one bound to other fds.
+	MosaicTty *expected = tty;
+	atomic_compare_exchange_strong(&globalTty, &expected, NULL);
+	free(tty->output_buffer);
+	pthread_mutex_destroy(&tty->reactor_lock);
 	free(tty);
 	return result;
 }
 
+static void ttyReactor_dispatchInput(MosaicTty *tty) {
+	MosaicTtyCallback *callback = tty->callback;
+	if (likely(callback)) {
+		MosaicTtyEvent event = { .type = MOSAIC_TTY_EVENT_INPUT };
+		if (unlikely(!eventQueue_push(&tty->events, &event))) {
+			// TODO Send warning somewhere? Maybe once we get debug logs working.
+		}
+		callback->onEvents(callback->opaque);
+	}
+}
+
+/** Wake the reactor thread from its wait, ignoring a full pipe which already has a wake pending. */
+static void ttyReactor_wake(MosaicTtyReactor *reactor) {
+	uint64_t notification = 1;
+	if (write(reactor->wake_write_fd, &notification, sizeof(notification))) {}
+}
+
+#if defined(__linux__)
+
+// Tags the epoll data of an instance's resize notification fd, as opposed to its stdin. Data
+// without an instance is the wake fd.
+#define REACTOR_RESIZE ((uintptr_t) 1)
+#define REACTOR_EVENTS 64
+
+static void ttyReactor_rearm(MosaicTtyReactor *reactor, MosaicTty *tty) {
+	// Stdin is watched with EPOLLONESHOT so that a level-triggered fd which the consumer has yet to
+	// read does not repeatedly wake the reactor. Modifying the registration re-enables it.
+	struct epoll_event event = {
+		.events = EPOLLIN | EPOLLONESHOT,
+		.data.u64 = (uintptr_t) tty,
+	};
+	if (unlikely(epoll_ctl(reactor->epoll_fd, EPOLL_CTL_MOD, tty->stdin_read_fd, &event) != 0)) {
+		// TODO Send errno somewhere? Maybe once we get debug logs working.
+	}
+}
+
+static int ttyReactor_wait(MosaicTtyReactor *reactor) {
+	struct epoll_event events[REACTOR_EVENTS];
+	int count = epoll_wait(reactor->epoll_fd, events, REACTOR_EVENTS, -1);
+	if (unlikely(count == -1)) {
+		return errno == EINTR ? 0 : errno;
+	}
+
+	pthread_mutex_lock(&reactor->lock);
+	for (int i = 0; i < count; i++) {
+		uintptr_t data = events[i].data.u64;
+		MosaicTty *tty = (MosaicTty *) (data & ~REACTOR_RESIZE);
+		if (tty == NULL) {
+			drainNotifications(reactor->wake_read_fd);
+		} else if (data & REACTOR_RESIZE) {
+			tty_dispatchResize(tty);
+		} else {
+			ttyReactor_dispatchInput(tty);
+		}
+	}
+	reactor->iteration++;
+	pthread_cond_broadcast(&reactor->dispatched);
+	pthread_mutex_unlock(&reactor->lock);
+	return 0;
+}
+
+static uint32_t ttyReactor_watch(MosaicTtyReactor *reactor, MosaicTty *tty) {
+	struct epoll_event input = {
+		.events = EPOLLIN | EPOLLONESHOT,
+		.data.u64 = (uintptr_t) tty,
+	};
+	if (unlikely(epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, tty->stdin_read_fd, &input) != 0)) {
+		return errno;
+	}
+	struct epoll_event resize = {
+		.events = EPOLLIN,
+		.data.u64 = (uintptr_t) tty | REACTOR_RESIZE,
+	};
+	if (unlikely(epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, tty->sigwinch_read_fd, &resize) != 0)) {
+		uint32_t result = errno;
+		epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, tty->stdin_read_fd, NULL);
+		return result;
+	}
+	return 0;
+}
+
+static uint32_t ttyReactor_unwatch(MosaicTtyReactor *reactor, MosaicTty *tty) {
+	uint32_t result = 0;
+	if (unlikely(epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, tty->stdin_read_fd, NULL) != 0)) {
+		result = errno;
+	}
+	if (unlikely(epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, tty->sigwinch_read_fd, NULL) != 0) && result == 0) {
+		result = errno;
+	}
+	return result;
+}
+
+#else
+
+static void ttyReactor_rearm(MosaicTtyReactor *reactor, MosaicTty *tty) {
+	atomic_store(&tty->input_armed, true);
+	ttyReactor_wake(reactor);
+}
+
+static int ttyReactor_wait(MosaicTtyReactor *reactor) {
+	// The set of descriptors is rebuilt for each wait since both the instances and which of them
+	// are armed can change while waiting. The instance for each entry is kept alongside.
+	pthread_mutex_lock(&reactor->lock);
+	int capacity = 1 + reactor->tty_count * 2;
+	struct pollfd *fds = malloc(capacity * sizeof(struct pollfd));
+	MosaicTty **ttys = malloc(capacity * sizeof(MosaicTty *));
+	if (unlikely(fds == NULL || ttys == NULL)) {
+		pthread_mutex_unlock(&reactor->lock);
+		free(fds);
+		free(ttys);
+		return ENOMEM;
+	}
+	fds[0] = (struct pollfd) { .fd = reactor->wake_read_fd, .events = POLLIN };
+	ttys[0] = NULL;
+	int count = 1;
+	for (int i = 0; i < reactor->tty_count; i++) {
+		MosaicTty *tty = reactor->ttys[i];
+		if (atomic_load(&tty->input_armed)) {
+			fds[count] = (struct pollfd) { .fd = tty->stdin_read_fd, .events = POLLIN };
+			ttys[count++] = tty;
+		}
+		fds[count] = (struct pollfd) { .fd = tty->sigwinch_read_fd, .events = POLLIN };
+		ttys[count++] = tty;
+	}
+	uint64_t generation = reactor->generation;
+	pthread_mutex_unlock(&reactor->lock);
+
+	int result = 0;
+	int ready = poll(fds, count, -1);
+	if (unlikely(ready == -1)) {
+		if (errno != EINTR) {
+			result = errno;
+		}
+		ready = 0;
+	}
+
+	pthread_mutex_lock(&reactor->lock);
+	// Instances may have been removed while waiting, in which case their results are discarded.
+	if (ready > 0 && generation == reactor->generation) {
+		for (int i = 0; i < count; i++) {
+			if (fds[i].revents == 0) {
+				continue;
+			}
+			MosaicTty *tty = ttys[i];
+			if (tty == NULL) {
+				drainNotifications(reactor->wake_read_fd);
+			} else if (fds[i].fd == tty->sigwinch_read_fd) {
+				tty_dispatchResize(tty);
+			} else {
+				atomic_store(&tty->input_armed, false);
+				ttyReactor_dispatchInput(tty);
+			}
+		}
+	}
+	reactor->iteration++;
+	pthread_cond_broadcast(&reactor->dispatched);
+	pthread_mutex_unlock(&reactor->lock);
+
+	free(fds);
+	free(ttys);
+	return result;
+}
+
+static uint32_t ttyReactor_watch(MosaicTtyReactor *reactor, MosaicTty *tty) {
+	if (reactor->tty_count == reactor->tty_capacity) {
+		int capacity = reactor->tty_capacity ? reactor->tty_capacity * 2 : 8;
+		MosaicTty **ttys = realloc(reactor->ttys, capacity * sizeof(MosaicTty *));
+		if (unlikely(ttys == NULL)) {
+			return ENOMEM;
+		}
+		reactor->ttys = ttys;
+		reactor->tty_capacity = capacity;
+	}
+	reactor->ttys[reactor->tty_count] = tty;
+	reactor->generation++;
+	ttyReactor_wake(reactor);
+	return 0;
+}
+
+static uint32_t ttyReactor_unwatch(MosaicTtyReactor *reactor, MosaicTty *tty) {
+	for (int i = 0; i < reactor->tty_count; i++) {
+		if (reactor->ttys[i] == tty) {
+			reactor->ttys[i] = reactor->ttys[reactor->tty_count - 1];
+			break;
+		}
+	}
+	reactor->generation++;
+	return 0;
+}
+
+#endif
+
+/**
+ * Rearm the reactor watching @p tty, if any. The reactor is loaded under the instance's lock which
+ * is also held to clear it, so one being removed or freed concurrently is never referenced.
+ */
+static void ttyReactor_rearmInput(MosaicTty *tty) {
+	pthread_mutex_lock(&tty->reactor_lock);
+	MosaicTtyReactor *reactor = atomic_load(&tty->reactor);
+	if (reactor) {
+		ttyReactor_rearm(reactor, tty);
+	}
+	pthread_mutex_unlock(&tty->reactor_lock);
+}
+
+static void ttyReactor_clear(MosaicTty *tty) {
+	pthread_mutex_lock(&tty->reactor_lock);
+	atomic_store(&tty->reactor, NULL);
+	pthread_mutex_unlock(&tty->reactor_lock);
+}
+
+static void *ttyReactor_run(void *arg) {
+	MosaicTtyReactor *reactor = (MosaicTtyReactor *) arg;
+
+	// Resizes are delivered through each instance's pipe, so the handler need not run here.
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGWINCH);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+	uint32_t error = 0;
+	while (!atomic_load(&reactor->stopping) && error == 0) {
+		error = ttyReactor_wait(reactor);
+	}
+
+	pthread_mutex_lock(&reactor->lock);
+	reactor->error = error;
+	reactor->stopped = true;
+	pthread_cond_broadcast(&reactor->dispatched);
+	pthread_mutex_unlock(&reactor->lock);
+	return NULL;
+}
+
+MosaicTtyReactorInitResult ttyReactor_init() {
+	MosaicTtyReactorInitResult result = {};
+
+	MosaicTtyReactorImpl *reactor = calloc(1, sizeof(MosaicTtyReactorImpl));
+	if (unlikely(reactor == NULL)) {
+		// result.reactor is set to 0 which will trigger OOM.
+		goto ret;
+	}
+
+	result.error = interruptInit(&reactor->wake_read_fd, &reactor->wake_write_fd);
+	if (unlikely(result.error)) {
+		goto err;
+	}
+
+#if defined(__linux__)
+	reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (unlikely(reactor->epoll_fd == -1)) {
+		result.error = errno;
+		goto err_wake;
+	}
+	struct epoll_event wake = { .events = EPOLLIN, .data.u64 = 0 };
+	if (unlikely(epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, reactor->wake_read_fd, &wake) != 0)) {
+		result.error = errno;
+		goto err_epoll;
+	}
+#endif
+
+	pthread_mutex_init(&reactor->lock, NULL);
+	pthread_cond_init(&reactor->dispatched, NULL);
+	atomic_init(&reactor->stopping, false);
+
+	result.error = pthread_create(&reactor->thread, NULL, ttyReactor_run, reactor);
+	if (unlikely(result.error)) {
+		pthread_cond_destroy(&reactor->dispatched);
+		pthread_mutex_destroy(&reactor->lock);
+		goto err_epoll;
+	}
+
+	result.reactor = reactor;
+
+	ret:
+	return result;
+
+	err_epoll:
+#if defined(__linux__)
+	close(reactor->epoll_fd);
+	err_wake:
+#endif
+	interruptFree(reactor->wake_read_fd, reactor->wake_write_fd);
+	err:
+	free(reactor);
+	goto ret;
+}
+
+uint32_t ttyReactor_add(MosaicTtyReactor *reactor, MosaicTty *tty) {
+	MosaicTtyReactor *expected = NULL;
+	if (unlikely(!atomic_compare_exchange_strong(&tty->reactor, &expected, reactor))) {
+		return EBUSY;
+	}
+
+	// The reactor reports resizes even if window resize events have yet to be enabled, at which
+	// point notifications start arriving on this pipe.
+	uint32_t result = 0;
+	if (tty->sigwinch_read_fd == -1) {
+		result = nonBlockingPipe(&tty->sigwinch_read_fd, &tty->sigwinch_write_fd);
+		if (unlikely(result)) {
+			goto err;
+		}
+	}
+
+	atomic_store(&tty->input_armed, true);
+
+	pthread_mutex_lock(&reactor->lock);
+	result = ttyReactor_watch(reactor, tty);
+	if (likely(result == 0)) {
+		reactor->tty_count++;
+	}
+	pthread_mutex_unlock(&reactor->lock);
+	if (unlikely(result)) {
+		goto err;
+	}
+
+	ret:
+	return result;
+
+	err:
+	ttyReactor_clear(tty);
+	goto ret;
+}
+
+uint32_t ttyReactor_remove(MosaicTtyReactor *reactor, MosaicTty *tty) {
+	if (unlikely(atomic_load(&tty->reactor) != reactor)) {
+		return EINVAL;
+	}
+	if (unlikely(pthread_equal(pthread_self(), reactor->thread))) {
+		// The lock is held while dispatching, so a callback cannot wait for its own dispatch.
+		return EDEADLK;
+	}
+
+	pthread_mutex_lock(&reactor->lock);
+	uint32_t result = ttyReactor_unwatch(reactor, tty);
+	reactor->tty_count--;
+	ttyReactor_clear(tty);
+
+	// The reactor thread may have already been woken for this instance and be waiting for the lock.
+	// Once it dispatches the next batch, this instance will never be referenced again.
+	uint64_t iteration = reactor->iteration;
+	ttyReactor_wake(reactor);
+	while (reactor->iteration == iteration && !reactor->stopped) {
+		pthread_cond_wait(&reactor->dispatched, &reactor->lock);
+	}
+	pthread_mutex_unlock(&reactor->lock);
+
+	return result;
+}
+
+uint32_t ttyReactor_free(MosaicTtyReactor *reactor) {
+	pthread_mutex_lock(&reactor->lock);
+	int ttyCount = reactor->tty_count;
+	pthread_mutex_unlock(&reactor->lock);
+	if (unlikely(ttyCount != 0)) {
+		return EBUSY;
+	}
+
+	atomic_store(&reactor->stopping, true);
+	ttyReactor_wake(reactor);
+	pthread_join(reactor->thread, NULL);
+
+	uint32_t result = reactor->error;
+#if defined(__linux__)
+	if (unlikely(close(reactor->epoll_fd) != 0) && result == 0) {
+		result = errno;
+	}
+#else
+	free(reactor->ttys);
+#endif
+	uint32_t error = interruptFree(reactor->wake_read_fd, reactor->wake_write_fd);
+	if (result == 0) {
+		result = error;
+	}
+	pthread_cond_destroy(&reactor->dispatched);
+	pthread_mutex_destroy(&reactor->lock);
+	free(reactor);
+	return result;
+}
+
 #endif
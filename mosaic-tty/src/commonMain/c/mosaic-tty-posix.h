@@ -2,23 +2,98 @@
 #define MOSAIC_TTY_POSIX_H
 
 #include "mosaic-tty.h"
-#include <sys/select.h>
+#include "mosaic-tty-events.h"
+#include "mosaic-tty-uring.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <termios.h>
+
+typedef struct MosaicTtyAsyncOutput {
+	pthread_t thread;
+	pthread_mutex_t lock;
+	// Signaled when bytes are queued or the writer should stop.
+	pthread_cond_t queued;
+	// Signaled when queued bytes are written or dropped due to an error.
+	pthread_cond_t written;
+	int write_fd;
+	// A ring of capacity bytes of which count, starting at start, are queued.
+	uint8_t *buffer;
+	int capacity;
+	int start;
+	int count;
+	// The error from a failed write which has yet to be reported, or 0.
+	uint32_t error;
+	bool stopping;
+} MosaicTtyAsyncOutput;
 
 typedef struct MosaicTtyImpl {
 	int stdin_read_fd;
 	int stdout_write_fd;
 	int stderr_write_fd;
+	// On Linux these are the same eventfd. Elsewhere they are the two ends of a pipe.
 	int interrupt_read_fd;
 	int interrupt_write_fd;
 	MosaicTtyCallback *callback;
+	MosaicTtyEventQueue events;
 	bool sigwinch;
+	// Written by the SIGWINCH handler and waited on alongside stdin, or -1 when not enabled.
+	int sigwinch_read_fd;
+	int sigwinch_write_fd;
 	struct termios *saved;
+	// Bytes appended by tty_bufferOutput which have yet to be written by tty_flushOutput.
+	uint8_t *output_buffer;
+	int output_count;
+	int output_capacity;
+	// Performs all writes to stdout when enabled by tty_enableAsyncOutput, otherwise NULL.
+	MosaicTtyAsyncOutput *async_output;
+	// Links the instances with window resize events enabled. See sigwinchHandler.
+	_Atomic(struct MosaicTtyImpl *) sigwinch_next;
+	// Watching this instance after a call to ttyReactor_add, otherwise NULL.
+	_Atomic(MosaicTtyReactor *) reactor;
+	// Held while clearing reactor and while rearming it after a read, so that a reactor which is
+	// being removed or freed is never rearmed.
+	pthread_mutex_t reactor_lock;
+	// Whether the reactor should report stdin becoming readable. Cleared when it is reported and
+	// set again by the next read.
+	atomic_bool input_armed;
+#if defined(MOSAIC_TTY_IO_URING)
+	// Performs reads when enabled by tty_enableIoUring, otherwise NULL. Its fixed buffer receives
+	// each read before it is copied out.
+	MosaicTtyUring *input_ring;
+	// Performs flushes of output_buffer, which is its fixed buffer, when input_ring is enabled.
+	MosaicTtyUring *output_ring;
+	// Whether a poll of the interrupt or resize notification fd is in flight on input_ring. These
+	// remain in flight across reads until they complete.
+	bool interrupt_polled;
+	bool sigwinch_polled;
+#endif
 } MosaicTtyImpl;
 
-MosaicTtyInitResult tty_initWithFds(
-	int stdinReadFd,
-	int stdoutWriteFd,
-	int stderrWriteFd
-);
+typedef struct MosaicTtyReactorImpl {
+	pthread_t thread;
+	// Held while dispatching a batch of events and while adding or removing an instance.
+	pthread_mutex_t lock;
+	// Signaled each time a batch of events has been dispatched.
+	pthread_cond_t dispatched;
+	// Incremented each time a batch of events has been dispatched.
+	uint64_t iteration;
+	// On Linux these are the same eventfd. Elsewhere they are the two ends of a pipe.
+	int wake_read_fd;
+	int wake_write_fd;
+	int tty_count;
+#if defined(__linux__)
+	int epoll_fd;
+#else
+	// The watched instances, polled in a set of descriptors rebuilt for each wait.
+	MosaicTtyImpl **ttys;
+	int tty_capacity;
+	// Incremented when an instance is added or removed, invalidating any poll results.
+	uint64_t generation;
+#endif
+	// The error which stopped the reactor thread, or 0 while it is running.
+	uint32_t error;
+	bool stopped;
+	atomic_bool stopping;
+} MosaicTtyReactorImpl;
 
 #endif // MOSAIC_TTY_POSIX_H
@@ -0,0 +1,170 @@
+#include "mosaic-tty-uring.h"
+
+#if defined(MOSAIC_TTY_IO_URING)
+
+#include "cutils.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+uint32_t uring_init(MosaicTtyUring *ring, unsigned entries) {
+	memset(ring, 0, sizeof(MosaicTtyUring));
+
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	int fd = syscall(__NR_io_uring_setup, entries, &params);
+	if (unlikely(fd < 0)) {
+		return errno;
+	}
+	uint32_t result = 0;
+	// Reads and writes must use the fd's current position (an offset of -1) since stdin and stdout
+	// may be redirected to seekable files.
+	uint32_t requiredFeatures = IORING_FEAT_EXT_ARG | IORING_FEAT_RW_CUR_POS;
+	if (unlikely((params.features & requiredFeatures) != requiredFeatures)) {
+		result = ENOSYS;
+		goto err;
+	}
+	ring->fd = fd;
+
+	ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+	ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (singleMmap && ring->cq_ring_size > ring->sq_ring_size) {
+		ring->sq_ring_size = ring->cq_ring_size;
+	}
+	ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (unlikely(ring->sq_ring == MAP_FAILED)) {
+		result = errno;
+		goto err;
+	}
+	if (singleMmap) {
+		ring->cq_ring = ring->sq_ring;
+		ring->cq_ring_size = 0;
+	} else {
+		ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+		if (unlikely(ring->cq_ring == MAP_FAILED)) {
+			result = errno;
+			goto err_sq;
+		}
+	}
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (unlikely(ring->sqes == MAP_FAILED)) {
+		result = errno;
+		goto err_cq;
+	}
+
+	ring->sq_head = (_Atomic uint32_t *) (ring->sq_ring + params.sq_off.head);
+	ring->sq_tail = (_Atomic uint32_t *) (ring->sq_ring + params.sq_off.tail);
+	ring->sq_array = (uint32_t *) (ring->sq_ring + params.sq_off.array);
+	ring->sq_entries = params.sq_entries;
+	ring->sq_mask = *(uint32_t *) (ring->sq_ring + params.sq_off.ring_mask);
+	ring->sq_tail_local = atomic_load_explicit(ring->sq_tail, memory_order_relaxed);
+	ring->cq_head = (_Atomic uint32_t *) (ring->cq_ring + params.cq_off.head);
+	ring->cq_tail = (_Atomic uint32_t *) (ring->cq_ring + params.cq_off.tail);
+	ring->cqes = (struct io_uring_cqe *) (ring->cq_ring + params.cq_off.cqes);
+	ring->cq_mask = *(uint32_t *) (ring->cq_ring + params.cq_off.ring_mask);
+
+	return 0;
+
+	err_cq:
+	if (ring->cq_ring_size) {
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	}
+	err_sq:
+	munmap(ring->sq_ring, ring->sq_ring_size);
+	err:
+	close(fd);
+	return result;
+}
+
+struct io_uring_sqe *uring_prepare(MosaicTtyUring *ring) {
+	uint32_t head = atomic_load_explicit(ring->sq_head, memory_order_acquire);
+	uint32_t tail = ring->sq_tail_local;
+	if (unlikely(tail - head >= ring->sq_entries)) {
+		return NULL;
+	}
+	uint32_t index = tail & ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[index];
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	ring->sq_array[index] = index;
+	ring->sq_tail_local = tail + 1;
+	return sqe;
+}
+
+uint32_t uring_enter(MosaicTtyUring *ring, int64_t timeoutNanos) {
+	// Publish the prepared entries. The kernel consumes them during the call below.
+	atomic_store_explicit(ring->sq_tail, ring->sq_tail_local, memory_order_release);
+	uint32_t toSubmit = ring->sq_tail_local - atomic_load_explicit(ring->sq_head, memory_order_acquire);
+
+	unsigned flags = IORING_ENTER_GETEVENTS;
+	struct __kernel_timespec timeout;
+	struct io_uring_getevents_arg arg;
+	void *argp = NULL;
+	size_t argSize = 0;
+	if (timeoutNanos >= 0) {
+		timeout.tv_sec = timeoutNanos / 1000000000;
+		timeout.tv_nsec = timeoutNanos % 1000000000;
+		memset(&arg, 0, sizeof(arg));
+		arg.ts = (uint64_t) (uintptr_t) &timeout;
+		argp = &arg;
+		argSize = sizeof(arg);
+		flags |= IORING_ENTER_EXT_ARG;
+	}
+
+	if (unlikely(syscall(__NR_io_uring_enter, ring->fd, toSubmit, 1, flags, argp, argSize) < 0)) {
+		// A timeout is reported as ETIME, but only when no entries were submitted by the call.
+		if (errno != ETIME) {
+			return errno;
+		}
+	}
+	return 0;
+}
+
+struct io_uring_cqe *uring_peek(MosaicTtyUring *ring) {
+	uint32_t head = atomic_load_explicit(ring->cq_head, memory_order_relaxed);
+	uint32_t tail = atomic_load_explicit(ring->cq_tail, memory_order_acquire);
+	if (head == tail) {
+		return NULL;
+	}
+	return &ring->cqes[head & ring->cq_mask];
+}
+
+void uring_advance(MosaicTtyUring *ring) {
+	uint32_t head = atomic_load_explicit(ring->cq_head, memory_order_relaxed);
+	atomic_store_explicit(ring->cq_head, head + 1, memory_order_release);
+}
+
+uint32_t uring_registerBuffer(MosaicTtyUring *ring, uint8_t *buffer, size_t size) {
+	if (ring->buffer) {
+		syscall(__NR_io_uring_register, ring->fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+		ring->buffer = NULL;
+		ring->buffer_size = 0;
+	}
+
+	struct iovec iov = { .iov_base = buffer, .iov_len = size };
+	if (unlikely(syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, &iov, 1) != 0)) {
+		return errno;
+	}
+	ring->buffer = buffer;
+	ring->buffer_size = size;
+	return 0;
+}
+
+uint32_t uring_free(MosaicTtyUring *ring) {
+	munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_ring_size) {
+		munmap(ring->cq_ring, ring->cq_ring_size);
+	}
+	munmap(ring->sq_ring, ring->sq_ring_size);
+	// Closing the ring also unregisters its buffer.
+	if (unlikely(close(ring->fd) != 0)) {
+		return errno;
+	}
+	return 0;
+}
+
+#endif
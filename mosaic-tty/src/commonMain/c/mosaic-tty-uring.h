@@ -0,0 +1,81 @@
+#ifndef MOSAIC_TTY_URING_H
+#define MOSAIC_TTY_URING_H
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+// Waiting for completions with a timeout requires IORING_ENTER_EXT_ARG from Linux 5.11. Older
+// kernel headers (such as those of the Kotlin/Native toolchain) leave this backend unavailable.
+#if defined(IORING_ENTER_EXT_ARG) && defined(__NR_io_uring_setup)
+#define MOSAIC_TTY_IO_URING 1
+#endif
+#endif
+
+#if defined(MOSAIC_TTY_IO_URING)
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A minimal io_uring which is only ever used by one thread at a time. See io_uring(7).
+ */
+typedef struct MosaicTtyUring {
+	int fd;
+	uint8_t *sq_ring;
+	size_t sq_ring_size;
+	uint8_t *cq_ring;
+	size_t cq_ring_size;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+	// Pointers into the rings which are shared with the kernel.
+	_Atomic uint32_t *sq_head;
+	_Atomic uint32_t *sq_tail;
+	uint32_t *sq_array;
+	_Atomic uint32_t *cq_head;
+	_Atomic uint32_t *cq_tail;
+	struct io_uring_cqe *cqes;
+	uint32_t sq_entries;
+	uint32_t sq_mask;
+	uint32_t cq_mask;
+	// Includes entries from uring_prepare which have yet to be submitted by uring_enter.
+	uint32_t sq_tail_local;
+	// Registered with the ring for IORING_OP_READ_FIXED and IORING_OP_WRITE_FIXED, or NULL.
+	uint8_t *buffer;
+	size_t buffer_size;
+} MosaicTtyUring;
+
+/**
+ * @return 0, or an errno if io_uring is unavailable such as ENOSYS or EPERM. ENOSYS is also returned
+ * if the kernel lacks a required feature.
+ */
+uint32_t uring_init(MosaicTtyUring *ring, unsigned entries);
+
+/**
+ * @return a zeroed submission entry which is submitted by the next uring_enter, or NULL if the
+ * submission queue is full.
+ */
+struct io_uring_sqe *uring_prepare(MosaicTtyUring *ring);
+
+/**
+ * Submit all prepared entries and wait for at least one completion, or until @p timeoutNanos has
+ * passed. A negative @p timeoutNanos waits indefinitely. Submitting and waiting is a single system
+ * call. A timeout is not an error, so check for completions with uring_peek.
+ * @return 0, or an errno such as EINTR.
+ */
+uint32_t uring_enter(MosaicTtyUring *ring, int64_t timeoutNanos);
+
+/** @return the oldest completion which must be released by uring_advance, or NULL if none. */
+struct io_uring_cqe *uring_peek(MosaicTtyUring *ring);
+
+void uring_advance(MosaicTtyUring *ring);
+
+/** Register @p buffer as the ring's only fixed buffer, replacing any previous one. */
+uint32_t uring_registerBuffer(MosaicTtyUring *ring, uint8_t *buffer, size_t size);
+
+/** Release the ring. Any operations still in flight are canceled by the kernel. */
+uint32_t uring_free(MosaicTtyUring *ring);
+
+#endif // MOSAIC_TTY_IO_URING
+
+#endif // MOSAIC_TTY_URING_H
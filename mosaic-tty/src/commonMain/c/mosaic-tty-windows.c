@@ -4,7 +4,10 @@
 
 #include "cutils.h"
 #include <assert.h>
+#include <io.h>
+#include <limits.h>
 #include <stdatomic.h>
+#include <string.h>
 #include <windows.h>
 
 MosaicTtyInitResult tty_initWithHandles(
@@ -43,6 +46,7 @@ MosaicTtyInitResult tty_initWithHandles(
 	tty->stdout = stdout;
 	tty->stderr = stderr;
 	tty->interrupt_event = interruptEvent;
+	eventQueue_init(&tty->events);
 
 	result.tty = tty;
 
@@ -54,6 +58,26 @@ MosaicTtyInitResult tty_initWithHandles(
 	goto ret;
 }
 
+MosaicTtyInitResult tty_initWithFds(
+	int stdinReadFd,
+	int stdoutWriteFd,
+	int stderrWriteFd
+) {
+	MosaicTtyInitResult result = {};
+
+	HANDLE stdin = (HANDLE) _get_osfhandle(stdinReadFd);
+	HANDLE stdout = (HANDLE) _get_osfhandle(stdoutWriteFd);
+	HANDLE stderr = (HANDLE) _get_osfhandle(stderrWriteFd);
+	if (unlikely(stdin == INVALID_HANDLE_VALUE || stdout == INVALID_HANDLE_VALUE || stderr == INVALID_HANDLE_VALUE)) {
+		result.error = ERROR_INVALID_HANDLE;
+		return result;
+	}
+
+	return tty_initWithHandles(stdin, stdout, stderr);
+}
+
+// The instance bound to the standard handles by tty_init. Instances bound to other handles with
+// tty_initWithHandles or tty_initWithFds are unrestricted.
 static _Atomic(MosaicTty *) globalTty;
 
 MosaicTtyInitResult tty_init() {
@@ -78,6 +102,10 @@ void tty_setCallback(MosaicTty *tty, MosaicTtyCallback *callback) {
 	tty->callback = callback;
 }
 
+int tty_readEvents(MosaicTty *tty, MosaicTtyEvent *events, int count) {
+	return eventQueue_pop(&tty->events, events, count);
+}
+
 MosaicTtyIoResult tty_readInput(
 	MosaicTty *tty,
 	uint8_t *buffer,
@@ -108,6 +136,7 @@ MosaicTtyIoResult tty_readInputWithTimeout(
 		}
 
 		MosaicTtyCallback *callback = tty->callback;
+		bool queuedEvents = false;
 		int nextBufferIndex = 0;
 		for (int i = 0; i < (int) recordsRead; i++) {
 			INPUT_RECORD record = records[i];
@@ -120,20 +149,32 @@ MosaicTtyIoResult tty_readInputWithTimeout(
 				// TODO mouse shit
 			} else if (record.EventType == FOCUS_EVENT) {
 				if (callback) {
-					callback->onFocus(callback->opaque, record.Event.FocusEvent.bSetFocus);
+					MosaicTtyEvent event = {
+						.type = MOSAIC_TTY_EVENT_FOCUS,
+						.values = { record.Event.FocusEvent.bSetFocus ? 1 : 0 },
+					};
+					queuedEvents |= eventQueue_push(&tty->events, &event);
 				}
 			} else if (record.EventType == WINDOW_BUFFER_SIZE_EVENT && tty->windowResizeEvents) {
 				if (callback) {
-					callback->onResize(
-						callback->opaque,
-						record.Event.WindowBufferSizeEvent.dwSize.X,
-						record.Event.WindowBufferSizeEvent.dwSize.Y,
-						0, 0
-					);
+					MosaicTtyEvent event = {
+						.type = MOSAIC_TTY_EVENT_RESIZE,
+						.values = {
+							record.Event.WindowBufferSizeEvent.dwSize.X,
+							record.Event.WindowBufferSizeEvent.dwSize.Y,
+							0, 0,
+						},
+					};
+					queuedEvents |= eventQueue_push(&tty->events, &event);
 				}
 			}
 		}
 
+		// Notify once for all the events in this batch of records.
+		if (queuedEvents) {
+			callback->onEvents(callback->opaque);
+		}
+
 		// Returning 0 would indicate an interrupt, so loop if we haven't read any raw bytes.
 		if (nextBufferIndex == 0) {
 			goto loop;
@@ -154,6 +195,66 @@ MosaicTtyIoResult tty_readInputWithTimeout(
 	goto ret;
 }
 
+int64_t tty_monotonicNanos() {
+	LARGE_INTEGER frequency;
+	LARGE_INTEGER counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	// Split the conversion to avoid overflowing for counters which have been running a long time.
+	int64_t seconds = counter.QuadPart / frequency.QuadPart;
+	int64_t remainder = counter.QuadPart % frequency.QuadPart;
+	return seconds * 1000000000 + remainder * 1000000000 / frequency.QuadPart;
+}
+
+MosaicTtyIoResult tty_readInputUntil(
+	MosaicTty *tty,
+	uint8_t *buffer,
+	int count,
+	int minCount,
+	int64_t deadlineNanos
+) {
+	MosaicTtyIoResult result = {};
+	if (minCount > count) {
+		minCount = count;
+	}
+
+	// Each read returns whatever is available, so keep reading into the remainder of the buffer
+	// until enough has accumulated. Bursts of input are then returned together.
+	do {
+		int timeoutMillis = INFINITE;
+		if (deadlineNanos >= 0) {
+			int64_t remaining = deadlineNanos - tty_monotonicNanos();
+			// Waits have millisecond granularity, so round up to never return before the deadline.
+			int64_t millis = remaining > 0 ? (remaining + 999999) / 1000000 : 0;
+			timeoutMillis = millis < INT_MAX ? (int) millis : INT_MAX;
+		}
+		MosaicTtyIoResult read = tty_readInputWithTimeout(
+			tty,
+			buffer + result.count,
+			count - result.count,
+			timeoutMillis
+		);
+		if (unlikely(read.error != 0 || read.count <= 0)) {
+			// An interrupt or the deadline ends the wait early. Return any bytes already read rather
+			// than an error, which will recur on the next call.
+			if (result.count == 0) {
+				result = read;
+			} else if (read.error == 0 &&
+				read.count == 0 &&
+				(deadlineNanos < 0 || tty_monotonicNanos() < deadlineNanos)
+			) {
+				// Waking up before the deadline means the auto-reset interrupt event was consumed.
+				// Signal it again so that the next call reports the interrupt.
+				SetEvent(tty->interrupt_event);
+			}
+			break;
+		}
+		result.count += read.count;
+	} while (result.count < minCount);
+
+	return result;
+}
+
 uint32_t tty_interruptRead(MosaicTty *tty) {
 	return likely(SetEvent(tty->interrupt_event) != 0)
 		? 0
@@ -173,10 +274,294 @@ static MosaicTtyIoResult tty_writeInternal(HANDLE h, uint8_t *buffer, int count)
 	return result;
 }
 
+/**
+ * Copy the bytes of the segments, in order, into the queue. Once the queue is full, wait for the
+ * writer thread to make room until at least @p minCount bytes have been queued. A @p minCount of
+ * 0 never waits. A write error from the writer thread which has not yet been reported is returned
+ * instead.
+ */
+static MosaicTtyIoResult asyncOutput_enqueue(
+	MosaicTtyAsyncOutput *output,
+	uint8_t **buffers,
+	int *counts,
+	int segmentCount,
+	int minCount
+) {
+	MosaicTtyIoResult result = {};
+
+	AcquireSRWLockExclusive(&output->lock);
+	int capacity = output->capacity;
+	int segment = 0;
+	int segmentOffset = 0; // Bytes of the current segment already queued.
+	while (true) {
+		if (unlikely(output->error)) {
+			result.error = output->error;
+			output->error = 0;
+			break;
+		}
+
+		int queued = 0;
+		while (segment < segmentCount) {
+			int remaining = counts[segment] - segmentOffset;
+			int available = capacity - output->count;
+			int count = remaining < available ? remaining : available;
+			int end = (output->start + output->count) % capacity;
+			int first = count < capacity - end ? count : capacity - end;
+			memcpy(output->buffer + end, buffers[segment] + segmentOffset, first);
+			memcpy(output->buffer, buffers[segment] + segmentOffset + first, count - first);
+			output->count += count;
+			queued += count;
+			if (count < remaining) {
+				segmentOffset += count;
+				break; // Full.
+			}
+			segment++;
+			segmentOffset = 0;
+		}
+		if (likely(queued)) {
+			WakeConditionVariable(&output->queued);
+			result.count += queued;
+		}
+
+		if (segment == segmentCount || result.count >= minCount) {
+			break;
+		}
+		SleepConditionVariableSRW(&output->written, &output->lock, INFINITE, 0);
+	}
+	ReleaseSRWLockExclusive(&output->lock);
+
+	return result;
+}
+
 MosaicTtyIoResult tty_writeOutput(MosaicTty *tty, uint8_t *buffer, int count) {
+	MosaicTtyAsyncOutput *asyncOutput = tty->async_output;
+	if (asyncOutput) {
+		// Like a blocking write, wait until at least one byte fits rather than returning 0.
+		return asyncOutput_enqueue(asyncOutput, &buffer, &count, 1, count > 0 ? 1 : 0);
+	}
 	return tty_writeInternal(tty->stdout, buffer, count);
 }
 
+MosaicTtyIoResult tty_writeOutputv(MosaicTty *tty, uint8_t **buffers, int *counts, int segmentCount) {
+	MosaicTtyIoResult result = {};
+
+	MosaicTtyAsyncOutput *asyncOutput = tty->async_output;
+	if (asyncOutput) {
+		return asyncOutput_enqueue(asyncOutput, buffers, counts, segmentCount, INT_MAX);
+	}
+
+	// There is no vectored write for console handles, so write each segment in full.
+	for (int segment = 0; segment < segmentCount; segment++) {
+		uint8_t *buffer = buffers[segment];
+		int remaining = counts[segment];
+		while (remaining > 0) {
+			MosaicTtyIoResult write = tty_writeInternal(tty->stdout, buffer, remaining);
+			if (unlikely(write.error)) {
+				result.error = write.error;
+				goto ret;
+			}
+			result.count += write.count;
+			buffer += write.count;
+			remaining -= write.count;
+		}
+	}
+
+	ret:
+	return result;
+}
+
+/** The size of the output buffer when first used. It doubles as needed to fit a whole frame. */
+#define OUTPUT_BUFFER_INITIAL_CAPACITY 8192
+
+MosaicTtyIoResult tty_bufferOutput(MosaicTty *tty, uint8_t *buffer, int count) {
+	MosaicTtyIoResult result = {};
+
+	int required = tty->output_count + count;
+	if (unlikely(required > tty->output_capacity)) {
+		int capacity = tty->output_capacity ? tty->output_capacity : OUTPUT_BUFFER_INITIAL_CAPACITY;
+		while (capacity < required) {
+			capacity *= 2;
+		}
+		uint8_t *grown = realloc(tty->output_buffer, capacity);
+		if (unlikely(grown == NULL)) {
+			result.error = ERROR_NOT_ENOUGH_MEMORY;
+			goto ret;
+		}
+		tty->output_buffer = grown;
+		tty->output_capacity = capacity;
+	}
+
+	memcpy(tty->output_buffer + tty->output_count, buffer, count);
+	tty->output_count = required;
+	result.count = count;
+
+	ret:
+	return result;
+}
+
+MosaicTtyIoResult tty_flushOutput(MosaicTty *tty) {
+	MosaicTtyIoResult result = {};
+
+	uint8_t *buffer = tty->output_buffer;
+	int count = tty->output_count;
+	MosaicTtyAsyncOutput *asyncOutput = tty->async_output;
+	if (asyncOutput) {
+		result = asyncOutput_enqueue(asyncOutput, &buffer, &count, 1, 0);
+	} else {
+		while (result.count < count) {
+			MosaicTtyIoResult write = tty_writeInternal(tty->stdout, buffer + result.count, count - result.count);
+			if (unlikely(write.error)) {
+				result.error = write.error;
+				break;
+			}
+			result.count += write.count;
+		}
+	}
+
+	// On error or when the async queue is full, retain whatever was not written so that a
+	// subsequent flush can retry.
+	tty->output_count = count - result.count;
+	if (unlikely(tty->output_count != 0)) {
+		memmove(buffer, buffer + result.count, tty->output_count);
+	}
+
+	return result;
+}
+
+static DWORD WINAPI asyncOutput_run(LPVOID arg) {
+	MosaicTtyAsyncOutput *output = arg;
+
+	AcquireSRWLockExclusive(&output->lock);
+	while (true) {
+		while (output->count == 0 && !output->stopping) {
+			SleepConditionVariableSRW(&output->queued, &output->lock, INFINITE, 0);
+		}
+		if (output->count == 0) {
+			break; // Stopping, and all queued bytes were written.
+		}
+
+		// Only this thread advances start, and bytes are only queued after start + count, so the
+		// queued bytes can be written without holding the lock.
+		int start = output->start;
+		int contiguous = output->capacity - start;
+		int count = output->count < contiguous ? output->count : contiguous;
+		ReleaseSRWLockExclusive(&output->lock);
+
+		MosaicTtyIoResult write = tty_writeInternal(output->write_handle, output->buffer + start, count);
+
+		AcquireSRWLockExclusive(&output->lock);
+		if (likely(!write.error)) {
+			output->start = (start + write.count) % output->capacity;
+			output->count -= write.count;
+		} else {
+			// Drop everything which was queued. The error is reported by the next call.
+			output->error = write.error;
+			output->start = 0;
+			output->count = 0;
+		}
+		WakeAllConditionVariable(&output->written);
+	}
+	ReleaseSRWLockExclusive(&output->lock);
+
+	return 0;
+}
+
+uint32_t tty_enableAsyncOutput(MosaicTty *tty, int capacity) {
+	uint32_t result = 0;
+
+	if (unlikely(tty->async_output || capacity <= 0)) {
+		result = ERROR_INVALID_PARAMETER;
+		goto ret;
+	}
+
+	MosaicTtyAsyncOutput *output = calloc(1, sizeof(MosaicTtyAsyncOutput));
+	if (unlikely(output == NULL)) {
+		result = ERROR_NOT_ENOUGH_MEMORY;
+		goto ret;
+	}
+	output->buffer = malloc(capacity);
+	if (unlikely(output->buffer == NULL)) {
+		result = ERROR_NOT_ENOUGH_MEMORY;
+		goto err_output;
+	}
+	output->capacity = capacity;
+	output->write_handle = tty->stdout;
+	InitializeSRWLock(&output->lock);
+	InitializeConditionVariable(&output->queued);
+	InitializeConditionVariable(&output->written);
+
+	output->thread = CreateThread(NULL, 0, asyncOutput_run, output, 0, NULL);
+	if (unlikely(output->thread == NULL)) {
+		result = GetLastError();
+		goto err_buffer;
+	}
+
+	tty->async_output = output;
+
+	ret:
+	return result;
+
+	err_buffer:
+	free(output->buffer);
+	err_output:
+	free(output);
+	goto ret;
+}
+
+MosaicTtyIoResult tty_awaitOutput(MosaicTty *tty, int timeoutMillis) {
+	MosaicTtyIoResult result = {};
+
+	MosaicTtyAsyncOutput *output = tty->async_output;
+	if (!output) {
+		goto ret; // Writes are synchronous.
+	}
+
+	ULONGLONG deadline = GetTickCount64() + (timeoutMillis >= 0 ? timeoutMillis : 0);
+
+	AcquireSRWLockExclusive(&output->lock);
+	while (output->count != 0 && !output->error) {
+		DWORD wait = INFINITE;
+		if (timeoutMillis >= 0) {
+			ULONGLONG now = GetTickCount64();
+			if (now >= deadline) {
+				break;
+			}
+			wait = (DWORD) (deadline - now);
+		}
+		SleepConditionVariableSRW(&output->written, &output->lock, wait, 0);
+	}
+	if (unlikely(output->error)) {
+		result.error = output->error;
+		output->error = 0;
+	} else {
+		result.count = output->count;
+	}
+	ReleaseSRWLockExclusive(&output->lock);
+
+	ret:
+	return result;
+}
+
+static uint32_t asyncOutput_free(MosaicTtyAsyncOutput *output) {
+	AcquireSRWLockExclusive(&output->lock);
+	output->stopping = true;
+	WakeConditionVariable(&output->queued);
+	ReleaseSRWLockExclusive(&output->lock);
+
+	// The writer thread exits once all queued bytes are written.
+	uint32_t result = 0;
+	if (unlikely(WaitForSingleObject(output->thread, INFINITE) == WAIT_FAILED)) {
+		result = GetLastError();
+	} else {
+		result = output->error;
+	}
+
+	CloseHandle(output->thread);
+	free(output->buffer);
+	free(output);
+	return result;
+}
+
 MosaicTtyIoResult tty_writeError(MosaicTty *tty, uint8_t *buffer, int count) {
 	return tty_writeInternal(tty->stderr, buffer, count);
 }
@@ -257,6 +642,10 @@ uint32_t tty_enableWindowResizeEvents(MosaicTty *tty) {
 	return 0;
 }
 
+uint32_t tty_enableIoUring(MosaicTty *tty UNUSED) {
+	return ERROR_NOT_SUPPORTED;
+}
+
 MosaicTtyTerminalSizeResult tty_currentTerminalSize(MosaicTty *tty) {
 	MosaicTtyTerminalSizeResult result = {};
 
@@ -274,7 +663,12 @@ MosaicTtyTerminalSizeResult tty_currentTerminalSize(MosaicTty *tty) {
 uint32_t tty_free(MosaicTty *tty) {
 	uint32_t result = 0;
 
-	if (unlikely(CloseHandle(tty->interrupt_event) == 0)) {
+	// Write any queued output before the console modes it relies on are restored.
+	if (tty->async_output) {
+		result = asyncOutput_free(tty->async_output);
+	}
+
+	if (unlikely(CloseHandle(tty->interrupt_event) == 0 && result == 0)) {
 		result = GetLastError();
 	}
 
@@ -290,9 +684,33 @@ uint32_t tty_free(MosaicTty *tty) {
 		}
 	}
 
-	atomic_store(&globalTty, NULL);
+	// Only unbind the global instance if this is it, and not one bound to other handles.
+	MosaicTty *expected = tty;
+	atomic_compare_exchange_strong(&globalTty, &expected, NULL);
+	free(tty->output_buffer);
 	free(tty);
 	return result;
 }
 
+// Console input handles cannot be waited on alongside sockets or pipes by a single thread in the
+// way epoll and poll allow, so reactors are not supported.
+
+MosaicTtyReactorInitResult ttyReactor_init() {
+	MosaicTtyReactorInitResult result = {};
+	result.error = ERROR_NOT_SUPPORTED;
+	return result;
+}
+
+uint32_t ttyReactor_add(MosaicTtyReactor *reactor UNUSED, MosaicTty *tty UNUSED) {
+	return ERROR_NOT_SUPPORTED;
+}
+
+uint32_t ttyReactor_remove(MosaicTtyReactor *reactor UNUSED, MosaicTty *tty UNUSED) {
+	return ERROR_NOT_SUPPORTED;
+}
+
+uint32_t ttyReactor_free(MosaicTtyReactor *reactor UNUSED) {
+	return ERROR_NOT_SUPPORTED;
+}
+
 #endif
@@ -2,10 +2,29 @@
 #define MOSAIC_TTY_WINDOWS_H
 
 #include "mosaic-tty.h"
+#include "mosaic-tty-events.h"
 #include <windows.h>
 
 enum { recordsCount = 64 };
 
+typedef struct MosaicTtyAsyncOutput {
+	HANDLE thread;
+	SRWLOCK lock;
+	// Signaled when bytes are queued or the writer should stop.
+	CONDITION_VARIABLE queued;
+	// Signaled when queued bytes are written or dropped due to an error.
+	CONDITION_VARIABLE written;
+	HANDLE write_handle;
+	// A ring of capacity bytes of which count, starting at start, are queued.
+	uint8_t *buffer;
+	int capacity;
+	int start;
+	int count;
+	// The error from a failed write which has yet to be reported, or 0.
+	DWORD error;
+	bool stopping;
+} MosaicTtyAsyncOutput;
+
 typedef struct MosaicTtyImpl {
 	HANDLE stdin;
 	HANDLE stdout;
@@ -13,10 +32,17 @@ typedef struct MosaicTtyImpl {
 	HANDLE interrupt_event;
 	INPUT_RECORD records[recordsCount];
 	MosaicTtyCallback *callback;
+	MosaicTtyEventQueue events;
 	bool windowResizeEvents;
 	DWORD saved_input_mode;
 	DWORD saved_output_mode;
 	UINT saved_output_code_page;
+	// Bytes appended by tty_bufferOutput which have yet to be written by tty_flushOutput.
+	uint8_t *output_buffer;
+	int output_count;
+	int output_capacity;
+	// Performs all writes to stdout when enabled by tty_enableAsyncOutput, otherwise NULL.
+	MosaicTtyAsyncOutput *async_output;
 } MosaicTtyImpl;
 
 MosaicTtyInitResult tty_initWithHandles(
@@ -5,18 +5,31 @@
 #include <stdint.h>
 
 typedef struct MosaicTtyImpl MosaicTty;
+typedef struct MosaicTtyReactorImpl MosaicTtyReactor;
 
-typedef void MosaicTtyCallbackOnFocus(void *opaque, bool focused);
-typedef void MosaicTtyCallbackOnKey(void *opaque); // TODO params
-typedef void MosaicTtyCallbackOnMouse(void *opaque); // TODO params
-typedef void MosaicTtyCallbackOnResize(void *opaque, int columns, int rows, int width, int height);
+#define MOSAIC_TTY_EVENT_FOCUS 1
+#define MOSAIC_TTY_EVENT_KEY 2
+#define MOSAIC_TTY_EVENT_MOUSE 3
+#define MOSAIC_TTY_EVENT_RESIZE 4
+#define MOSAIC_TTY_EVENT_INPUT 5
+
+typedef struct MosaicTtyEvent {
+	// One of the MOSAIC_TTY_EVENT_* values.
+	int type;
+	// MOSAIC_TTY_EVENT_FOCUS: 1 if focused, otherwise 0.
+	// MOSAIC_TTY_EVENT_RESIZE: columns, rows, width, height.
+	// MOSAIC_TTY_EVENT_KEY and MOSAIC_TTY_EVENT_MOUSE: TODO.
+	// MOSAIC_TTY_EVENT_INPUT: None. Input can be read without waiting. Only sent by a reactor.
+	int values[4];
+} MosaicTtyEvent;
+
+// Invoked once after one or more events are queued, on the thread which queued them. Retrieve the
+// events with tty_readEvents.
+typedef void MosaicTtyCallbackOnEvents(void *opaque);
 
 typedef struct MosaicTtyCallback {
 	void *opaque;
-	MosaicTtyCallbackOnFocus *onFocus;
-	MosaicTtyCallbackOnKey *onKey;
-	MosaicTtyCallbackOnMouse *onMouse;
-	MosaicTtyCallbackOnResize *onResize;
+	MosaicTtyCallbackOnEvents *onEvents;
 } MosaicTtyCallback;
 
 typedef struct MosaicTtyInitResult {
@@ -25,6 +38,11 @@ typedef struct MosaicTtyInitResult {
 	bool already_bound;
 } MosaicTtyInitResult;
 
+typedef struct MosaicTtyReactorInitResult {
+	MosaicTtyReactor *reactor;
+	uint32_t error;
+} MosaicTtyReactorInitResult;
+
 typedef struct MosaicTtyIoResult {
 	int count;
 	uint32_t error;
@@ -39,15 +57,34 @@ typedef struct MosaicTtyTerminalSizeResult {
 } MosaicTtyTerminalSizeResult;
 
 MosaicTtyInitResult tty_init();
+MosaicTtyInitResult tty_initWithFds(int stdinReadFd, int stdoutWriteFd, int stderrWriteFd);
 void tty_setCallback(MosaicTty *tty, MosaicTtyCallback *callback);
+int tty_readEvents(MosaicTty *tty, MosaicTtyEvent *events, int count);
 MosaicTtyIoResult tty_readInput(MosaicTty *tty, uint8_t *buffer, int count);
 MosaicTtyIoResult tty_readInputWithTimeout(MosaicTty *tty, uint8_t *buffer, int count, int timeoutMillis);
+MosaicTtyIoResult tty_readInputUntil(MosaicTty *tty, uint8_t *buffer, int count, int minCount, int64_t deadlineNanos);
+int64_t tty_monotonicNanos();
 uint32_t tty_interruptRead(MosaicTty *tty);
 MosaicTtyIoResult tty_writeOutput(MosaicTty *tty, uint8_t *buffer, int count);
+MosaicTtyIoResult tty_writeOutputv(MosaicTty *tty, uint8_t **buffers, int *counts, int segmentCount);
+MosaicTtyIoResult tty_bufferOutput(MosaicTty *tty, uint8_t *buffer, int count);
+MosaicTtyIoResult tty_flushOutput(MosaicTty *tty);
+uint32_t tty_enableAsyncOutput(MosaicTty *tty, int capacity);
+MosaicTtyIoResult tty_awaitOutput(MosaicTty *tty, int timeoutMillis);
 MosaicTtyIoResult tty_writeError(MosaicTty *tty, uint8_t *buffer, int count);
 uint32_t tty_enableRawMode(MosaicTty *tty);
 uint32_t tty_enableWindowResizeEvents(MosaicTty *tty);
+uint32_t tty_enableIoUring(MosaicTty *tty);
 MosaicTtyTerminalSizeResult tty_currentTerminalSize(MosaicTty *tty);
 uint32_t tty_free(MosaicTty *tty);
 
+// A reactor watches any number of instances on a single thread, queueing input and resize events
+// and invoking each instance's callback on that thread. After an input event, no more are sent
+// for that instance until it is next read from. An instance must be removed before the reactor is
+// freed, and cannot be removed or freed from within a callback. Not supported on Windows.
+MosaicTtyReactorInitResult ttyReactor_init();
+uint32_t ttyReactor_add(MosaicTtyReactor *reactor, MosaicTty *tty);
+uint32_t ttyReactor_remove(MosaicTtyReactor *reactor, MosaicTty *tty);
+uint32_t ttyReactor_free(MosaicTtyReactor *reactor);
+
 #endif // MOSAIC_TTY_H
@@ -1,6 +1,7 @@
 #ifndef MOSAIC_H
 #define MOSAIC_H
 
+#include "mosaic-row-encoder.h"
 #include "mosaic-tty.h"
 #include "mosaic-test-tty.h"
 
@@ -0,0 +1,99 @@
+package com.jakewharton.mosaic.tty
+
+/**
+ * Encodes rows of terminal cells as UTF-8 text interleaved with SGR sequences which change the
+ * colors and styles between cells. Runs of cells with equal attributes and runs of ASCII text are
+ * found using SIMD instructions (SSE2 or AVX2 on x86-64, chosen at runtime, and NEON on ARM64).
+ *
+ * A row is two planes: one code point per cell, and [AttributeCount] values per cell containing
+ * its foreground color, background color, underline color, and style. Colors must already be
+ * resolved for the terminal's color support using [ansi16Color], [ansi256Color], or [rgbColor].
+ */
+public object RowEncoder {
+	/** The number of values in the attribute plane for each cell. */
+	public const val AttributeCount: Int = 4
+	public const val ForegroundIndex: Int = 0
+	public const val BackgroundIndex: Int = 1
+	public const val UnderlineColorIndex: Int = 2
+	public const val StyleIndex: Int = 3
+
+	public const val UnspecifiedColor: Int = 0
+
+	public const val Bold: Int = 0x01
+	public const val Dim: Int = 0x02
+	public const val Italic: Int = 0x04
+	public const val Invert: Int = 0x08
+	public const val Strikethrough: Int = 0x10
+
+	public const val UnderlineUnspecified: Int = 0
+	public const val UnderlineNone: Int = 1
+	public const val UnderlineStraight: Int = 2
+	public const val UnderlineDouble: Int = 3
+	public const val UnderlineCurly: Int = 4
+	public const val UnderlineDotted: Int = 5
+	public const val UnderlineDashed: Int = 6
+
+	/** Only encode text, ignoring the attribute plane except for trimming trailing blank cells. */
+	public const val FlagPlain: Int = 0x01
+
+	/** Encode double, curly, dotted, and dashed underlines rather than a straight underline. */
+	public const val FlagKittyUnderlines: Int = 0x02
+
+	private const val MaxCellBytes = 80
+
+	/** @param code A foreground color code from 30 to 37 or 90 to 97. */
+	public fun ansi16Color(code: Int): Int = 0x01000000 or (code and 0xff)
+
+	public fun ansi256Color(index: Int): Int = 0x02000000 or (index and 0xff)
+
+	public fun rgbColor(red: Int, green: Int, blue: Int): Int {
+		return 0x03000000 or ((red and 0xff) shl 16) or ((green and 0xff) shl 8) or (blue and 0xff)
+	}
+
+	/**
+	 * @param textStyle A combination of [Bold], [Dim], [Italic], [Invert], and [Strikethrough].
+	 * @param underline One of the `Underline` constants such as [UnderlineStraight].
+	 */
+	public fun style(textStyle: Int, underline: Int): Int {
+		return (textStyle and 0xff) or ((underline and 0xff) shl 8)
+	}
+
+	/** The most bytes [encode] will write for a row of [count] cells. */
+	public fun maxSize(count: Int): Int = count * MaxCellBytes + 4
+
+	/**
+	 * Encode [count] cells starting at cell [offset] of [codePoints] and [attributes] into [output]
+	 * at [outputOffset]. Trailing cells which are a space with all-zero attributes are not encoded.
+	 * If the last encoded cell has colors or text styles, a reset sequence is appended.
+	 *
+	 * Invalid code points are encoded as U+FFFD.
+	 *
+	 * @param flags A combination of [FlagPlain] and [FlagKittyUnderlines].
+	 * @param output Must have at least [maxSize] bytes available after [outputOffset].
+	 * @return The number of bytes written to [output].
+	 */
+	public fun encode(
+		codePoints: IntArray,
+		attributes: IntArray,
+		offset: Int,
+		count: Int,
+		flags: Int,
+		output: ByteArray,
+		outputOffset: Int,
+	): Int {
+		require(offset >= 0 && count >= 0 && offset + count <= codePoints.size) { "codePoints out of bounds" }
+		require((offset + count) * AttributeCount <= attributes.size) { "attributes out of bounds" }
+		require(outputOffset >= 0 && outputOffset + maxSize(count) <= output.size) { "output too small" }
+		return rowEncoderEncode(codePoints, attributes, offset, count, flags, output, outputOffset)
+	}
+}
+
+internal expect fun rowEncoderEncode(
+	codePoints: IntArray,
+	attributes: IntArray,
+	offset: Int,
+	count: Int,
+	flags: Int,
+	output: ByteArray,
+	outputOffset: Int,
+): Int
@@ -9,6 +9,17 @@ public expect class TestTty : AutoCloseable {
 
 	public fun writeInput(buffer: ByteArray, offset: Int, count: Int): Int
 
+	/**
+	 * Read up to [count] bytes into [buffer] at [offset] which were written to [tty]'s standard
+	 * output stream. The number of bytes read will be returned, which is 0 if no output is
+	 * available. This never waits for output.
+	 *
+	 * On Linux and macOS, output is collected as it is written so writes to [tty] never wait for
+	 * it to be read. On Windows, output is held in a pipe with a capacity of 1 MiB. Writes to [tty]
+	 * will block once it fills, so larger amounts of output must be read as they are written.
+	 */
+	public fun readOutput(buffer: ByteArray, offset: Int, count: Int): Int
+
 	/**
 	 * Send a focus event to [tty]'s callback.
 	 *
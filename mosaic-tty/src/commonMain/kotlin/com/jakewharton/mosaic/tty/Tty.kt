@@ -8,13 +8,28 @@ public expect class Tty : AutoCloseable {
 		 * throw an exception until [Tty.close] is called.
 		 */
 		public fun bind(): Tty
+
+		/**
+		 * Initialize a [Tty] instance to the given file descriptors, such as the subsidiary side of
+		 * a pseudoterminal. Any number of instances can be bound this way, in addition to the one
+		 * returned from [bind]. The descriptors are not closed by [Tty.close].
+		 *
+		 * On Windows the descriptors are converted to their underlying handles.
+		 */
+		public fun bind(inputFd: Int, outputFd: Int, errorFd: Int): Tty
+
+		/**
+		 * The current value of the monotonic clock used by [readInputUntil], in nanoseconds.
+		 * Only differences between values are meaningful.
+		 */
+		public fun monotonicNanos(): Long
 	}
 
 	/**
 	 * Set or clear the callback used for reporting events about the terminal using platform-specific
-	 * integration. The callback may be invoked on any thread and must never throw an exception.
-	 * On Windows the callback will only be invoked during calls to [readInput] or
-	 * [readInputWithTimeout].
+	 * integration. The callback must never throw an exception. It will only be invoked on the
+	 * calling thread during calls to [readInput] or [readInputWithTimeout], unless this instance
+	 * has been added to a [TtyReactor] which invokes it on the reactor's thread.
 	 */
 	public fun setCallback(callback: Callback?)
 
@@ -33,14 +48,41 @@ public expect class Tty : AutoCloseable {
 	 * while waiting for input, or if at least [timeoutMillis] have passed without data.
 	 * -1 will be returned if the input stream is closed.
 	 *
-	 * @param timeoutMillis A value of 0 will perform a non-blocking read. Otherwise, valid values
-	 * are 1 to 999 which represent a maximum time (in milliseconds) to wait for data. Note: This
-	 * value is not validated.
+	 * @param timeoutMillis A value of 0 will perform a non-blocking read. Otherwise, the maximum time
+	 * (in milliseconds) to wait for data.
 	 * @see readInput
+	 * @see readInputUntil
 	 */
 	public fun readInputWithTimeout(buffer: ByteArray, offset: Int, count: Int, timeoutMillis: Int): Int
 
-	/** Signal blocking calls to [readInput] or [readInputWithTimeout] to wake up and return 0. */
+	/**
+	 * Read up to [count] bytes into [buffer] at [offset] from the standard input stream, waiting
+	 * until at least [minCount] bytes have been read or [deadlineNanos] passes. The number of bytes
+	 * read will be returned, which may be fewer than [minCount] if the deadline passed or
+	 * [interruptRead] was called. -1 will be returned if the input stream is closed before any
+	 * bytes were read.
+	 *
+	 * Waiting for more than one byte allows a burst of input, such as a paste or a flood of mouse
+	 * events, to be returned by a single call rather than one call per arriving chunk.
+	 *
+	 * @param deadlineNanos A value of [monotonicNanos] after which to stop waiting. A deadline in
+	 * the past will perform a non-blocking read, and a negative value will wait indefinitely.
+	 * Deadlines have nanosecond precision on Linux and millisecond precision elsewhere.
+	 * @see readInputWithTimeout
+	 */
+	public fun readInputUntil(
+		buffer: ByteArray,
+		offset: Int,
+		count: Int,
+		minCount: Int,
+		deadlineNanos: Long,
+	): Int
+
+	/**
+	 * Signal blocking calls to [readInput], [readInputWithTimeout], or [readInputUntil] to wake up.
+	 * They return 0. If [readInputUntil] has already read some bytes it returns those instead, and
+	 * the interrupt remains pending so that the next read returns 0 immediately.
+	 */
 	public fun interruptRead()
 
 	/**
@@ -49,6 +91,60 @@ public expect class Tty : AutoCloseable {
 	 */
 	public fun writeOutput(buffer: ByteArray, offset: Int, count: Int): Int
 
+	/**
+	 * Write [counts]`[i]` bytes from each of [buffers]`[i]` at [offsets]`[i]` to the standard output
+	 * stream, in order, using as few system calls as possible. Unlike the single-buffer overload,
+	 * all bytes are written before returning. The total number of bytes written will be returned.
+	 *
+	 * This allows separately-produced segments of output, such as each part of a frame, to be
+	 * written together without first copying them into a single buffer.
+	 *
+	 * @throws IllegalArgumentException if the sizes of [buffers], [offsets], and [counts] differ,
+	 * a range is not within its buffer, or the total exceeds [Int.MAX_VALUE] bytes.
+	 */
+	public fun writeOutput(buffers: Array<ByteArray>, offsets: IntArray, counts: IntArray): Int
+
+	/**
+	 * Append [count] bytes from [buffer] at [offset] to an output buffer owned by this instance.
+	 * Nothing is written to the standard output stream until [flushOutput] is called. All of the
+	 * bytes are always buffered, and [count] will be returned.
+	 *
+	 * Buffering many small pieces of output and flushing once (such as once per frame) requires
+	 * only a single system call and avoids a platform transition for every write.
+	 */
+	public fun bufferOutput(buffer: ByteArray, offset: Int, count: Int): Int
+
+	/**
+	 * Write all output appended by [bufferOutput] to the standard output stream.
+	 * The number of bytes written will be returned. If writing fails, any bytes which were not
+	 * written remain buffered for the next call.
+	 */
+	public fun flushOutput(): Int
+
+	/**
+	 * Start a dedicated thread which performs all subsequent writes to the standard output stream
+	 * from a queue of [capacity] bytes. Calls to [writeOutput] and [flushOutput] then only copy
+	 * into the queue and only wait for a slow terminal when the queue is full.
+	 *
+	 * When the queue is full, the single-buffer [writeOutput] waits until at least one byte fits
+	 * and returns the number queued, while the multi-buffer [writeOutput] waits until all of its
+	 * bytes are queued. [flushOutput] never waits: it accepts only the bytes which fit and returns
+	 * that count, which may be 0, and the rest remain buffered for the next call. Use
+	 * [awaitOutput] to wait for the queue to drain. A failed write by the thread discards the
+	 * queue and is thrown by the next call to any of these functions.
+	 *
+	 * Any queued bytes are written by [close] before it returns. This may only be called once.
+	 */
+	public fun enableAsyncOutput(capacity: Int)
+
+	/**
+	 * Wait until all output queued since [enableAsyncOutput] has been written, or until
+	 * [timeoutMillis] have passed. A negative [timeoutMillis] waits indefinitely.
+	 * The number of bytes still queued will be returned, so 0 indicates all output was written.
+	 * Returns 0 immediately if async output is not enabled.
+	 */
+	public fun awaitOutput(timeoutMillis: Int): Int
+
 	/**
 	 * Write up to [count] bytes from [buffer] at [offset] to the standard error stream.
 	 * The number of bytes written will be returned.
@@ -87,8 +183,10 @@ public expect class Tty : AutoCloseable {
 	 * records from the console. Only the row and column values of the [ResizeEvent] will be present.
 	 * The width and height will always be 0.
 	 *
-	 * On Linux and macOS this installs a `SIGWINCH` signal handler which then queries `TIOCGWINSZ`
-	 * using `ioctl`.
+	 * On Linux and macOS this installs a `SIGWINCH` signal handler shared by all instances, each of
+	 * which is notified of every signal. Signals are coalesced and the size is queried from
+	 * `TIOCGWINSZ` using `ioctl` during calls to [readInput] or [readInputWithTimeout], or on the
+	 * thread of the [TtyReactor] this instance was added to.
 	 *
 	 * Note: You can also respond to resize events which lack necessary data by sending `XTWINOPS`
 	 * to query row/col counts and/or window or cell size in pixels. More details
@@ -96,16 +194,59 @@ public expect class Tty : AutoCloseable {
 	 */
 	public fun enableWindowResizeEvents()
 
+	/**
+	 * Perform subsequent reads and [flushOutput] calls using `io_uring` on Linux 5.11 and newer.
+	 * Each read submits its work and waits for the result in a single system call, rather than
+	 * one to wait for input and another to read it, and both use buffers registered with the
+	 * kernel. Call this before any reads.
+	 *
+	 * The rings belong to this instance alone, so nothing is batched across instances: each read
+	 * and each flush of every instance is still its own system call. Reads of an instance watched
+	 * by a [TtyReactor] use the ring, but the reactor itself waits with `epoll`. [writeOutput] and
+	 * asynchronous output do not use the ring.
+	 *
+	 * Returns false, leaving the default implementation in place, if `io_uring` is unavailable
+	 * such as on older kernels, when disabled by a seccomp policy, or on other platforms.
+	 */
+	public fun enableIoUring(): Boolean
+
 	/** @return Array of `[columns, rows, width, height]` */
 	public fun currentSize(): IntArray
 
 	/** Reset TTY state and free the resources associated with this reader. */
 	override fun close()
 
+	/**
+	 * Receives events which are not delivered as input bytes. Events are queued natively and
+	 * delivered in batches on the thread which queued them, usually the one reading input.
+	 */
 	public interface Callback {
 		public fun onFocus(focused: Boolean)
 		public fun onKey()
 		public fun onMouse()
 		public fun onResize(columns: Int, rows: Int, width: Int, height: Int)
+
+		/**
+		 * Input can be read without waiting. Only called for an instance added to a [TtyReactor],
+		 * and not called again until after the next read. Does nothing by default.
+		 */
+		public fun onInput() {}
+	}
+}
+
+/** Validate the arguments of [Tty.writeOutput] for multiple segments. */
+internal fun checkSegments(buffers: Array<ByteArray>, offsets: IntArray, counts: IntArray) {
+	require(offsets.size == buffers.size && counts.size == buffers.size) {
+		"buffers, offsets, and counts sizes differ"
+	}
+	var total = 0L
+	for (i in buffers.indices) {
+		val offset = offsets[i]
+		val count = counts[i]
+		require(offset >= 0 && count >= 0 && offset <= buffers[i].size - count) {
+			"segment $i out of bounds"
+		}
+		total += count
 	}
+	require(total <= Int.MAX_VALUE) { "total count exceeds Int.MAX_VALUE" }
 }
@@ -0,0 +1,35 @@
+package com.jakewharton.mosaic.tty
+
+/**
+ * Watches any number of [Tty] instances for input and window resizes using a single thread,
+ * rather than one thread blocked in [Tty.readInput] per instance. Combined with
+ * [Tty.bind] on file descriptors, this allows one process to host many terminal sessions such as
+ * one pseudoterminal per client.
+ *
+ * Each instance's [Tty.Callback] is invoked on the reactor's thread. [Tty.Callback.onInput] is
+ * called when input is available, after which a read will not wait, and [Tty.Callback.onResize]
+ * is called after [Tty.enableWindowResizeEvents] when the window may have changed size.
+ *
+ * On Linux this uses `epoll`, and on macOS `poll`. Windows is not supported.
+ */
+public expect class TtyReactor : AutoCloseable {
+	public companion object {
+		/** Start a reactor and its thread. */
+		public fun create(): TtyReactor
+	}
+
+	/**
+	 * Start watching [tty]. An instance can only be added to one reactor at a time. It is removed
+	 * automatically by [Tty.close].
+	 */
+	public fun add(tty: Tty)
+
+	/**
+	 * Stop watching [tty]. Once this returns, its callback will not be invoked by the reactor.
+	 * Must not be called from a callback invoked by the reactor.
+	 */
+	public fun remove(tty: Tty)
+
+	/** Stop the reactor's thread. All instances must have been removed or closed. */
+	override fun close()
+}
@@ -0,0 +1,99 @@
+package com.jakewharton.mosaic.tty
+
+import assertk.assertFailure
+import assertk.assertThat
+import assertk.assertions.isEqualTo
+import assertk.assertions.isInstanceOf
+import com.jakewharton.mosaic.tty.RowEncoder.AttributeCount
+import com.jakewharton.mosaic.tty.RowEncoder.BackgroundIndex
+import com.jakewharton.mosaic.tty.RowEncoder.Bold
+import com.jakewharton.mosaic.tty.RowEncoder.FlagKittyUnderlines
+import com.jakewharton.mosaic.tty.RowEncoder.FlagPlain
+import com.jakewharton.mosaic.tty.RowEncoder.ForegroundIndex
+import com.jakewharton.mosaic.tty.RowEncoder.StyleIndex
+import com.jakewharton.mosaic.tty.RowEncoder.UnderlineColorIndex
+import com.jakewharton.mosaic.tty.RowEncoder.UnderlineCurly
+import kotlin.test.Test
+
+class RowEncoderTest {
+	private fun encode(text: String, attributes: IntArray = IntArray(text.length * AttributeCount), flags: Int = 0): String {
+		val codePoints = IntArray(text.length) { text[it].code }
+		val output = ByteArray(RowEncoder.maxSize(codePoints.size))
+		val written = RowEncoder.encode(codePoints, attributes, 0, codePoints.size, flags, output, 0)
+		return output.decodeToString(endIndex = written)
+	}
+
+	private fun attributes(count: Int, vararg cells: Pair<Int, IntArray>): IntArray {
+		val attributes = IntArray(count * AttributeCount)
+		for ((index, cell) in cells) {
+			cell.copyInto(attributes, index * AttributeCount)
+		}
+		return attributes
+	}
+
+	@Test fun plainAscii() {
+		// Long enough to use the SIMD path along with a scalar remainder.
+		val text = "The quick brown fox jumps over the lazy dog"
+		assertThat(encode(text)).isEqualTo(text)
+	}
+
+	@Test fun trailingBlanksTrimmed() {
+		assertThat(encode("hello     ")).isEqualTo("hello")
+		assertThat(encode("     ")).isEqualTo("")
+	}
+
+	@Test fun trailingStyledBlanksKept() {
+		val attributes = attributes(3, 2 to intArrayOf(0, RowEncoder.ansi16Color(31), 0, 0))
+		assertThat(encode("a  ", attributes)).isEqualTo("a \u001B[41m \u001B[0m")
+	}
+
+	@Test fun utf8() {
+		val codePoints = intArrayOf(0xE9, 0x1F600, 0xD800)
+		val output = ByteArray(RowEncoder.maxSize(3))
+		val written = RowEncoder.encode(codePoints, IntArray(3 * AttributeCount), 0, 3, 0, output, 0)
+		assertThat(output.decodeToString(endIndex = written)).isEqualTo("é😀�")
+	}
+
+	@Test fun attributeChanges() {
+		val cell = IntArray(AttributeCount)
+		val attributes = IntArray(4 * AttributeCount)
+		cell[ForegroundIndex] = RowEncoder.ansi16Color(31)
+		cell[StyleIndex] = RowEncoder.style(Bold, 0)
+		cell.copyInto(attributes, 0)
+		cell.copyInto(attributes, AttributeCount)
+		cell.fill(0)
+		cell[BackgroundIndex] = RowEncoder.rgbColor(16, 32, 48)
+		cell[StyleIndex] = RowEncoder.style(0, UnderlineCurly)
+		cell.copyInto(attributes, 2 * AttributeCount)
+		cell[BackgroundIndex] = 0
+		cell[UnderlineColorIndex] = RowEncoder.ansi256Color(200)
+		cell.copyInto(attributes, 3 * AttributeCount)
+
+		assertThat(encode("abcd", attributes)).isEqualTo(
+			"\u001B[31;1mab\u001B[39;48;2;16;32;48;22;4mc\u001B[49;58;5;200md",
+		)
+		assertThat(encode("abcd", attributes, FlagKittyUnderlines)).isEqualTo(
+			"\u001B[31;1mab\u001B[39;48;2;16;32;48;22;4:3mc\u001B[49;58;5;200md",
+		)
+		assertThat(encode("abcd", attributes, FlagPlain)).isEqualTo("abcd")
+	}
+
+	@Test fun resetAfterStyledLastCell() {
+		val attributes = attributes(2, 1 to intArrayOf(0, 0, 0, RowEncoder.style(Bold, 0)))
+		assertThat(encode("ab", attributes)).isEqualTo("a\u001B[1mb\u001B[0m")
+	}
+
+	@Test fun offsets() {
+		val codePoints = IntArray(4) { 'a'.code + it }
+		val output = ByteArray(2 + RowEncoder.maxSize(2)) { 'x'.code.toByte() }
+		val written = RowEncoder.encode(codePoints, IntArray(4 * AttributeCount), 1, 2, 0, output, 2)
+		assertThat(written).isEqualTo(2)
+		assertThat(output.decodeToString(endIndex = 5)).isEqualTo("xxbcx")
+	}
+
+	@Test fun outputTooSmallFails() {
+		assertFailure {
+			RowEncoder.encode(IntArray(4), IntArray(4 * AttributeCount), 0, 4, 0, ByteArray(4), 0)
+		}.isInstanceOf<IllegalArgumentException>()
+	}
+}
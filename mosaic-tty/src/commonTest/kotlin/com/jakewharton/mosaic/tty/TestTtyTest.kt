@@ -2,9 +2,24 @@ package com.jakewharton.mosaic.tty
 
 import assertk.assertThat
 import assertk.assertions.isEqualTo
+import assertk.assertions.isZero
 import kotlin.test.Test
 
 class TestTtyTest {
+	@Test fun readOutputWhatWasWritten() {
+		TestTty.create().use { testTty ->
+			val buffer = ByteArray(10) { 'x'.code.toByte() }
+			assertThat(testTty.readOutput(buffer, 0, 10), "empty").isZero()
+
+			val bytes = "hello".encodeToByteArray()
+			assertThat(testTty.tty.writeOutput(bytes, 0, bytes.size)).isEqualTo(5)
+			assertThat(testTty.readOutput(buffer, 5, 5)).isEqualTo(5)
+			assertThat(buffer.decodeToString()).isEqualTo("xxxxxhello")
+
+			assertThat(testTty.readOutput(buffer, 0, 10), "drained").isZero()
+		}
+	}
+
 	@Test fun canCreateMultiple() {
 		if (isWindows()) return // TODO Not currently supported.
 
@@ -0,0 +1,134 @@
+package com.jakewharton.mosaic.tty
+
+import assertk.assertFailure
+import assertk.assertThat
+import assertk.assertions.isEqualTo
+import assertk.assertions.isInstanceOf
+import assertk.assertions.isNull
+import kotlin.test.Test
+import kotlin.time.Duration
+import kotlin.time.Duration.Companion.milliseconds
+import kotlin.time.Duration.Companion.seconds
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.channels.Channel
+import kotlinx.coroutines.channels.Channel.Factory.UNLIMITED
+import kotlinx.coroutines.test.runTest
+import kotlinx.coroutines.withContext
+import kotlinx.coroutines.withTimeoutOrNull
+
+class TtyReactorTest {
+	private val events = Channel<String>(UNLIMITED)
+
+	@Test fun unsupportedOnWindows() {
+		if (!isWindows()) return
+
+		assertFailure {
+			TtyReactor.create()
+		}.isInstanceOf<IllegalStateException>()
+	}
+
+	@Test fun inputNotifiesOncePerRead() = runTest {
+		if (isWindows()) return@runTest
+
+		TestTty.create().use { testTty ->
+			val tty = testTty.tty
+			tty.setCallback(ChannelCallback())
+			TtyReactor.create().use { reactor ->
+				reactor.add(tty)
+
+				testTty.writeInput("hello")
+				assertThat(awaitEvent()).isEqualTo("onInput")
+
+				// Unread input does not notify again.
+				testTty.writeInput("world")
+				assertThat(awaitEvent(100.milliseconds)).isNull()
+
+				assertThat(tty.readInput(10)).isEqualTo("helloworld")
+				testTty.writeInput("hi")
+				assertThat(awaitEvent()).isEqualTo("onInput")
+
+				reactor.remove(tty)
+			}
+		}
+	}
+
+	@Test fun multipleInstances() = runTest {
+		if (isWindows()) return@runTest
+
+		TestTty.create().use { one ->
+			TestTty.create().use { two ->
+				one.tty.setCallback(ChannelCallback("one"))
+				two.tty.setCallback(ChannelCallback("two"))
+				TtyReactor.create().use { reactor ->
+					reactor.add(one.tty)
+					reactor.add(two.tty)
+
+					two.writeInput("bye")
+					assertThat(awaitEvent()).isEqualTo("two onInput")
+					one.writeInput("hey")
+					assertThat(awaitEvent()).isEqualTo("one onInput")
+
+					reactor.remove(one.tty)
+					reactor.remove(two.tty)
+				}
+			}
+		}
+	}
+
+	@Test fun addTwiceFails() {
+		if (isWindows()) return
+
+		TestTty.create().use { testTty ->
+			TtyReactor.create().use { reactor ->
+				reactor.add(testTty.tty)
+				assertFailure {
+					reactor.add(testTty.tty)
+				}.isInstanceOf<IllegalStateException>()
+				reactor.remove(testTty.tty)
+			}
+		}
+	}
+
+	@Test fun closeRemovesFromReactor() {
+		if (isWindows()) return
+
+		TtyReactor.create().use { reactor ->
+			TestTty.create().use { testTty ->
+				reactor.add(testTty.tty)
+			}
+			// Closing the reactor fails if any instance has yet to be removed.
+		}
+	}
+
+	/** Callbacks are invoked on the reactor's thread, so wait in real time rather than test time. */
+	private suspend fun awaitEvent(timeout: Duration = 5.seconds): String? {
+		return withContext(Dispatchers.Default) {
+			withTimeoutOrNull(timeout) {
+				events.receive()
+			}
+		}
+	}
+
+	inner class ChannelCallback(
+		private val prefix: String? = null,
+	) : Tty.Callback {
+		private fun send(event: String) {
+			events.trySend(if (prefix != null) "$prefix $event" else event)
+		}
+		override fun onFocus(focused: Boolean) {
+			send("onFocus $focused")
+		}
+		override fun onKey() {
+			send("onKey")
+		}
+		override fun onMouse() {
+			send("onMouse")
+		}
+		override fun onResize(columns: Int, rows: Int, width: Int, height: Int) {
+			send("onResize $columns $rows $width $height")
+		}
+		override fun onInput() {
+			send("onInput")
+		}
+	}
+}
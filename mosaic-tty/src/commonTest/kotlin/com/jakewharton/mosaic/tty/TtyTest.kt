@@ -14,6 +14,7 @@ import kotlin.test.Test
 import kotlin.time.Duration.Companion.milliseconds
 import kotlin.time.measureTime
 import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.async
 import kotlinx.coroutines.delay
 import kotlinx.coroutines.launch
 import kotlinx.coroutines.test.runTest
@@ -38,6 +39,19 @@ class TtyTest {
 		}
 	}
 
+	@Test fun bindWithFdsAllowsMultiple() {
+		Tty.bind().use {
+			Tty.bind(0, 1, 2).use {
+				Tty.bind(0, 1, 2).close()
+			}
+			// Closing an instance bound to fds does not release the standard streams.
+			assertFailure {
+				Tty.bind()
+			}.isInstanceOf<IllegalStateException>()
+				.hasMessage("Tty already bound")
+		}
+	}
+
 	@Test fun readWhatWasWritten() {
 		val buffer = ByteArray(10) { 'x'.code.toByte() }
 
@@ -114,6 +128,133 @@ class TtyTest {
 		assertThat(tookB).isGreaterThan(50.milliseconds)
 	}
 
+	@Test fun readUntilWaitsForMinCount() = runTest {
+		val buffer = ByteArray(10) { 'x'.code.toByte() }
+
+		testTty.writeInput("he")
+		backgroundScope.launch(Dispatchers.Default) {
+			delay(50.milliseconds)
+			testTty.writeInput("llo")
+		}
+		val read = tty.readInputUntil(buffer, 0, 10, 5, -1)
+		assertThat(read).isEqualTo(5)
+		assertThat(buffer.decodeToString()).isEqualTo("helloxxxxx")
+	}
+
+	@Test fun readUntilReturnsPartialAtDeadline() {
+		val buffer = ByteArray(10) { 'x'.code.toByte() }
+
+		testTty.writeInput("hi")
+		val read: Int
+		val took = measureTime {
+			read = tty.readInputUntil(buffer, 0, 10, 5, Tty.monotonicNanos() + 100.milliseconds.inWholeNanoseconds)
+		}
+		assertThat(read).isEqualTo(2)
+		assertThat(buffer.decodeToString()).isEqualTo("hixxxxxxxx")
+		// See readWithTimeoutReturnsZeroOnTimeout for why this is a conservative lower bound.
+		assertThat(took).isGreaterThan(50.milliseconds)
+	}
+
+	@Test fun readUntilInterruptAfterPartialReadRemainsPending() = runTest {
+		val buffer = ByteArray(10) { 'x'.code.toByte() }
+
+		testTty.writeInput("hi")
+		backgroundScope.launch(Dispatchers.Default) {
+			delay(150.milliseconds)
+			tty.interruptRead()
+		}
+		assertThat(tty.readInputUntil(buffer, 0, 10, 5, -1)).isEqualTo(2)
+		assertThat(buffer.decodeToString()).isEqualTo("hixxxxxxxx")
+
+		// The interrupt which ended the previous call is reported by this one without waiting.
+		assertThat(tty.readInput(buffer, 0, 10)).isZero()
+	}
+
+	@Test fun readUntilPastDeadlineDoesNotWait() {
+		val read = tty.readInputUntil(ByteArray(10), 0, 10, 1, Tty.monotonicNanos())
+		assertThat(read).isZero()
+	}
+
+	@Test fun writeSegmentsValidated() {
+		val hello = "hello".encodeToByteArray()
+		assertThat(tty.writeOutput(emptyArray(), IntArray(0), IntArray(0))).isZero()
+		assertFailure {
+			tty.writeOutput(arrayOf(hello), intArrayOf(0, 0), intArrayOf(5))
+		}.isInstanceOf<IllegalArgumentException>()
+		assertFailure {
+			tty.writeOutput(arrayOf(hello, hello), intArrayOf(0, 3), intArrayOf(5, 3))
+		}.isInstanceOf<IllegalArgumentException>()
+			.hasMessage("segment 1 out of bounds")
+	}
+
+	@Test fun awaitOutputWithoutAsyncOutputReturnsImmediately() {
+		assertThat(tty.awaitOutput(-1)).isZero()
+	}
+
+	@Test fun enableAsyncOutputTwiceFails() {
+		tty.enableAsyncOutput(1024)
+		assertThat(tty.awaitOutput(0)).isZero()
+
+		assertFailure {
+			tty.enableAsyncOutput(1024)
+		}.isInstanceOf<IllegalStateException>()
+	}
+
+	@Test fun asyncOutputWaitsForRoom() = runTest {
+		tty.enableAsyncOutput(4)
+
+		val received = ByteArray(15)
+		val reader = backgroundScope.async(Dispatchers.Default) {
+			var total = 0
+			while (total < received.size) {
+				total += testTty.readOutput(received, total, received.size - total)
+			}
+			total
+		}
+
+		val hello = "hello".encodeToByteArray()
+		// Vectored writes queue every byte even though they do not fit at once.
+		assertThat(tty.writeOutput(arrayOf(hello, hello), intArrayOf(0, 0), intArrayOf(5, 5))).isEqualTo(10)
+		// Single writes wait for room rather than returning 0.
+		var offset = 0
+		while (offset < hello.size) {
+			val written = tty.writeOutput(hello, offset, hello.size - offset)
+			assertThat(written).isGreaterThan(0)
+			offset += written
+		}
+		assertThat(tty.awaitOutput(-1)).isZero()
+
+		assertThat(reader.await()).isEqualTo(15)
+		assertThat(received.decodeToString()).isEqualTo("hellohellohello")
+	}
+
+	@Test fun ioUringReadsTimesOutAndFlushes() = runTest {
+		if (!tty.enableIoUring()) return@runTest
+
+		val buffer = ByteArray(10) { 'x'.code.toByte() }
+		testTty.writeInput("hello")
+		assertThat(tty.readInput(buffer, 0, 10)).isEqualTo(5)
+		assertThat(buffer.decodeToString()).isEqualTo("helloxxxxx")
+
+		val took = measureTime {
+			assertThat(tty.readInputWithTimeout(buffer, 0, 10, 100)).isZero()
+		}
+		assertThat(took).isGreaterThan(50.milliseconds)
+
+		backgroundScope.launch(Dispatchers.Default) {
+			delay(150.milliseconds)
+			tty.interruptRead()
+		}
+		assertThat(tty.readInput(buffer, 0, 10)).isZero()
+
+		val output = "world".encodeToByteArray()
+		tty.bufferOutput(output, 0, output.size)
+		assertThat(tty.flushOutput()).isEqualTo(5)
+		val written = ByteArray(10)
+		assertThat(testTty.readOutput(written, 0, 10)).isEqualTo(5)
+		assertThat(written.decodeToString(0, 5)).isEqualTo("world")
+	}
+
 	@Test fun focusEventNoCallback() {
 		testTty.focusEvent(true)
 	}
@@ -237,6 +378,23 @@ class TtyTest {
 		assertThat(events.removeFirst()).isEqualTo("hello! onResize 1 2 0 0")
 	}
 
+	@Test fun callbackEventsDeliveredInOrder() {
+		if (isWindows()) {
+			tty.enableWindowResizeEvents()
+		}
+
+		tty.setCallback(MyCallback())
+
+		testTty.resizeEvent(1, 2, 0, 0)
+		testTty.resizeEvent(3, 4, 0, 0)
+		testTty.resizeEvent(5, 6, 0, 0)
+		doWriteReadRoundtrip()
+
+		assertThat(events.removeFirst()).isEqualTo("hey! onResize 1 2 0 0")
+		assertThat(events.removeFirst()).isEqualTo("hey! onResize 3 4 0 0")
+		assertThat(events.removeFirst()).isEqualTo("hey! onResize 5 6 0 0")
+	}
+
 	@Keep // Ensure reference doesn't leak to a local.
 	private fun createAndSetCallback(): WeakReference<MyCallback> {
 		val callback = MyCallback()
@@ -287,5 +445,8 @@ class TtyTest {
 		override fun onResize(columns: Int, rows: Int, width: Int, height: Int) {
 			events += "$prefix onResize $columns $rows $width $height"
 		}
+		override fun onInput() {
+			events += "$prefix onInput"
+		}
 	}
 }
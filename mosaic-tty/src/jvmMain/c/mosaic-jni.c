@@ -1,98 +1,121 @@
 #include "cutils.h"
 #include "jni.h"
 #include "mosaic.h"
+#include <errno.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static void throwIse(JNIEnv *env, uint32_t error) {
-	jclass ise = (*env)->FindClass(env, "java/lang/IllegalStateException");
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+// Reads and writes block for an unbounded amount of time so they cannot hold a critical array
+// region. Instead, they copy through a stack buffer of this size. This avoids GetByteArrayElements
+// copying the entire array out and back (and its allocation) for the common case of small calls.
+#define BOUNCE_BUFFER_SIZE 8192
+
+// The most events returned from a single ttyReadEvents call.
+#define EVENT_BUFFER_COUNT 64
 
+// Looked up once in JNI_OnLoad. Classes are held as global references which keeps their IDs valid.
+static jclass illegalStateExceptionClass;
+static jclass outOfMemoryErrorClass;
+static jclass eventDispatcherClass;
+static jmethodID eventDispatcherOnEvents;
+
+static void throwIse(JNIEnv *env, uint32_t error) {
 	// 11 == max unsigned digit length (10) + null termination byte (1)
-	char *message = malloc(11 * sizeof(char));
-	if (message) {
-		sprintf(message, "%u", error);
+	char message[11];
+	snprintf(message, sizeof(message), "%u", error);
+	(*env)->ThrowNew(env, illegalStateExceptionClass, message);
+}
+
+static void throwOom(JNIEnv *env) {
+	(*env)->ThrowNew(env, outOfMemoryErrorClass, NULL);
+}
+
+/**
+ * Get the bytes to write from @p buffer. Writes must be complete, so a count which does not fit in
+ * @p stackBuffer falls back to the array elements which are returned in @p elements and must be
+ * passed to releaseWriteBuffer.
+ */
+static uint8_t *acquireWriteBuffer(
+	JNIEnv *env,
+	jbyteArray buffer,
+	jint offset,
+	jint count,
+	uint8_t *stackBuffer,
+	jbyte **elements
+) {
+	if (likely(count <= BOUNCE_BUFFER_SIZE)) {
+		*elements = NULL;
+		(*env)->GetByteArrayRegion(env, buffer, offset, count, (jbyte *) stackBuffer);
+		return stackBuffer;
+	}
+	*elements = (*env)->GetByteArrayElements(env, buffer, NULL);
+	// Reinterpret JVM signed bytes as unsigned.
+	return (uint8_t *) (*elements + offset);
+}
+
+static void releaseWriteBuffer(JNIEnv *env, jbyteArray buffer, jbyte *elements) {
+	if (unlikely(elements != NULL)) {
+		// The buffer was only read, so there are no changes to copy back.
+		(*env)->ReleaseByteArrayElements(env, buffer, elements, JNI_ABORT);
 	}
-	(*env)->ThrowNew(env, ise, message);
 }
 
 typedef struct MosaicJniTtyCallback {
-	JNIEnv *env;
+	// Callbacks are invoked on the thread which queued the events which may differ from the one
+	// which created this callback, so the environment must be looked up for each call.
+	JavaVM *vm;
 	jobject instance;
-	jmethodID onFocus;
-	jmethodID onKey;
-	jmethodID onMouse;
-	jmethodID onResize;
 } MosaicJniTtyCallback;
 
-static void invokeOnFocusCallback(void *opaque, bool focused) {
-	MosaicJniTtyCallback *callback = (MosaicJniTtyCallback *) opaque;
-	(*callback->env)->CallVoidMethod(
-		callback->env,
-		callback->instance,
-		callback->onFocus,
-		focused
-	);
-}
+#if !defined(_WIN32)
 
-static void invokeOnKeyCallback(void *opaque) {
-	MosaicJniTtyCallback *callback = (MosaicJniTtyCallback *) opaque;
-	(*callback->env)->CallVoidMethod(
-		callback->env,
-		callback->instance,
-		callback->onKey
-	);
-}
+// A reactor invokes callbacks on a native thread which the JVM does not know about. Such a thread
+// is attached on its first callback and stays attached until it exits, when this key's destructor
+// detaches it. The key's value is the JavaVM, and is only set on threads which were attached here.
+static pthread_key_t attachedThreadKey;
 
-static void invokeOnMouseCallback(void *opaque) {
-	MosaicJniTtyCallback *callback = (MosaicJniTtyCallback *) opaque;
-	(*callback->env)->CallVoidMethod(
-		callback->env,
-		callback->instance,
-		callback->onMouse
-	);
+static void detachAttachedThread(void *value) {
+	JavaVM *vm = (JavaVM *) value;
+	(*vm)->DetachCurrentThread(vm);
 }
 
-static void invokeOnResizeCallback(void *opaque, int columns, int rows, int width, int height) {
+#endif
+
+static void invokeOnEventsCallback(void *opaque) {
 	MosaicJniTtyCallback *callback = (MosaicJniTtyCallback *) opaque;
-	(*callback->env)->CallVoidMethod(
-		callback->env,
-		callback->instance,
-		callback->onResize,
-		columns,
-		rows,
-		width,
-		height
-	);
+	JavaVM *vm = callback->vm;
+	JNIEnv *env;
+	if (unlikely((*vm)->GetEnv(vm, (void **) &env, JNI_VERSION_1_6) == JNI_EDETACHED)) {
+		if (unlikely((*vm)->AttachCurrentThreadAsDaemon(vm, (void **) &env, NULL) != JNI_OK)) {
+			return;
+		}
+#if !defined(_WIN32)
+		pthread_setspecific(attachedThreadKey, vm);
+#endif
+	}
+	(*env)->CallVoidMethod(env, callback->instance, eventDispatcherOnEvents);
+#if !defined(_WIN32)
+	if (unlikely((*env)->ExceptionCheck(env)) && pthread_getspecific(attachedThreadKey) != NULL) {
+		// There is no Java caller on an attached thread to receive the exception, so report it.
+		(*env)->ExceptionDescribe(env);
+		(*env)->ExceptionClear(env);
+	}
+#endif
 }
 
-JNIEXPORT jlong JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_ttyCallbackInit(
+static jlong JNICALL
+ttyCallbackInit(
 	JNIEnv *env,
 	jclass type UNUSED,
 	jobject instance
 ) {
-	jobject globalInstance = (*env)->NewGlobalRef(env, instance);
-	if (unlikely(globalInstance == NULL)) {
-		return 0;
-	}
-	jclass clazz = (*env)->FindClass(env, "com/jakewharton/mosaic/tty/Tty$Callback");
-	if (unlikely(clazz == NULL)) {
-		return 0;
-	}
-	jmethodID onFocus = (*env)->GetMethodID(env, clazz, "onFocus", "(Z)V");
-	if (unlikely(onFocus == NULL)) {
-		return 0;
-	}
-	jmethodID onKey = (*env)->GetMethodID(env, clazz, "onKey", "()V");
-	if (unlikely(onKey == NULL)) {
-		return 0;
-	}
-	jmethodID onMouse = (*env)->GetMethodID(env, clazz, "onMouse", "()V");
-	if (unlikely(onMouse == NULL)) {
-		return 0;
-	}
-	jmethodID onResize = (*env)->GetMethodID(env, clazz, "onResize", "(IIII)V");
-	if (unlikely(onResize == NULL)) {
+	JavaVM *vm;
+	if (unlikely((*env)->GetJavaVM(env, &vm) != JNI_OK)) {
 		return 0;
 	}
 
@@ -100,28 +123,29 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyCallbackInit(
 	if (unlikely(!jniCallback)) {
 		return 0;
 	}
-	jniCallback->env = env;
-	jniCallback->instance = globalInstance;
-	jniCallback->onFocus = onFocus;
-	jniCallback->onKey = onKey;
-	jniCallback->onMouse = onMouse;
-	jniCallback->onResize = onResize;
-
 	MosaicTtyCallback *callback = malloc(sizeof(MosaicTtyCallback));
 	if (unlikely(!callback)) {
+		free(jniCallback);
 		return 0;
 	}
+	jobject globalInstance = (*env)->NewGlobalRef(env, instance);
+	if (unlikely(globalInstance == NULL)) {
+		free(callback);
+		free(jniCallback);
+		return 0;
+	}
+
+	jniCallback->vm = vm;
+	jniCallback->instance = globalInstance;
+
 	callback->opaque = jniCallback;
-	callback->onFocus = invokeOnFocusCallback;
-	callback->onKey = invokeOnKeyCallback;
-	callback->onMouse = invokeOnMouseCallback;
-	callback->onResize = invokeOnResizeCallback;
+	callback->onEvents = invokeOnEventsCallback;
 
 	return (jlong) callback;
 }
 
-JNIEXPORT void JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_ttyCallbackFree(
+static void JNICALL
+ttyCallbackFree(
 	JNIEnv *env,
 	jclass type UNUSED,
 	jlong callbackOpaque
@@ -134,8 +158,8 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyCallbackFree(
 	(*env)->DeleteGlobalRef(env, instance);
 }
 
-JNIEXPORT jlong JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_ttyInit(
+static jlong JNICALL
+ttyInit(
 	JNIEnv *env,
 	jclass type UNUSED
 ) {
@@ -145,16 +169,31 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyInit(
 	}
 
 	if (result.already_bound) {
-		jclass ise = (*env)->FindClass(env, "java/lang/IllegalStateException");
-		(*env)->ThrowNew(env, ise, "Tty already bound");
+		(*env)->ThrowNew(env, illegalStateExceptionClass, "Tty already bound");
 	} else {
 		throwIse(env, result.error);
 	}
 	return 0;
 }
 
-JNIEXPORT void JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_ttySetCallback(
+static jlong JNICALL
+ttyInitWithFds(
+	JNIEnv *env,
+	jclass type UNUSED,
+	jint stdinReadFd,
+	jint stdoutWriteFd,
+	jint stderrWriteFd
+) {
+	MosaicTtyInitResult result = tty_initWithFds(stdinReadFd, stdoutWriteFd, stderrWriteFd);
+	if (unlikely(result.error)) {
+		throwIse(env, result.error);
+	}
+	// A null tty without an error indicates OOM.
+	return (jlong) result.tty;
+}
+
+static void JNICALL
+ttySetCallback(
 	JNIEnv *env UNUSED,
 	jclass type UNUSED,
 	jlong ttyOpaque,
@@ -165,8 +204,29 @@ Java_com_jakewharton_mosaic_tty_Jni_ttySetCallback(
 	tty_setCallback(tty, callback);
 }
 
-JNIEXPORT jint JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_ttyReadInput(
+// Events are copied directly into the int array, five ints at a time.
+_Static_assert(sizeof(MosaicTtyEvent) == 5 * sizeof(jint), "MosaicTtyEvent must be five ints");
+
+static jint JNICALL
+ttyReadEvents(
+	JNIEnv *env,
+	jclass type UNUSED,
+	jlong ttyOpaque,
+	jintArray events
+) {
+	MosaicTty *tty = (MosaicTty *) ttyOpaque;
+	MosaicTtyEvent stackEvents[EVENT_BUFFER_COUNT];
+	jint max = (*env)->GetArrayLength(env, events) / 5;
+	if (max > EVENT_BUFFER_COUNT) {
+		max = EVENT_BUFFER_COUNT;
+	}
+	int count = tty_readEvents(tty, stackEvents, max);
+	(*env)->SetIntArrayRegion(env, events, 0, count * 5, (jint *) stackEvents);
+	return count;
+}
+
+static jint JNICALL
+ttyReadInput(
 	JNIEnv *env,
 	jclass type UNUSED,
 	jlong ttyOpaque,
@@ -174,17 +234,17 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyReadInput(
 	jint offset,
 	jint count
 ) {
-	jbyte *bufferElements = (*env)->GetByteArrayElements(env, buffer, NULL);
-	jbyte *bufferElementsAtOffset = bufferElements + offset;
-	// Reinterpret JVM signed bytes as unsigned.
-	uint8_t *nativeBufferAtOffset = (uint8_t *) bufferElementsAtOffset;
+	// Reads may return fewer bytes than requested, so a larger count is simply truncated.
+	uint8_t nativeBuffer[BOUNCE_BUFFER_SIZE];
+	if (count > BOUNCE_BUFFER_SIZE) {
+		count = BOUNCE_BUFFER_SIZE;
+	}
 
 	MosaicTty *tty = (MosaicTty *) ttyOpaque;
-	MosaicTtyIoResult result = tty_readInput(tty, nativeBufferAtOffset, count);
-
-	(*env)->ReleaseByteArrayElements(env, buffer, bufferElements, 0);
+	MosaicTtyIoResult result = tty_readInput(tty, nativeBuffer, count);
 
 	if (likely(!result.error)) {
+		(*env)->SetByteArrayRegion(env, buffer, offset, result.count, (jbyte *) nativeBuffer);
 		return result.count;
 	}
 
@@ -194,8 +254,8 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyReadInput(
 	return -1;
 }
 
-JNIEXPORT jint JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_ttyReadInputWithTimeout(
+static jint JNICALL
+ttyReadInputWithTimeout(
 	JNIEnv *env,
 	jclass type UNUSED,
 	jlong ttyOpaque,
@@ -204,20 +264,89 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyReadInputWithTimeout(
 	jint count,
 	jint timeoutMillis
 ) {
-	jbyte *bufferElements = (*env)->GetByteArrayElements(env, buffer, NULL);
-	jbyte *bufferElementsAtOffset = bufferElements + offset;
-	// Reinterpret JVM signed bytes as unsigned.
-	uint8_t *nativeBufferAtOffset = (uint8_t *) bufferElementsAtOffset;
+	// Reads may return fewer bytes than requested, so a larger count is simply truncated.
+	uint8_t nativeBuffer[BOUNCE_BUFFER_SIZE];
+	if (count > BOUNCE_BUFFER_SIZE) {
+		count = BOUNCE_BUFFER_SIZE;
+	}
 
 	MosaicTty *tty = (MosaicTty *) ttyOpaque;
 	MosaicTtyIoResult result = tty_readInputWithTimeout(
 		tty,
-		nativeBufferAtOffset,
+		nativeBuffer,
 		count,
 		timeoutMillis
 	);
 
-	(*env)->ReleaseByteArrayElements(env, buffer, bufferElements, 0);
+	if (likely(!result.error)) {
+		(*env)->SetByteArrayRegion(env, buffer, offset, result.count, (jbyte *) nativeBuffer);
+		return result.count;
+	}
+
+	// This throw can fail, but the only condition that should cause that is OOM. Return -1 (EOF)
+	// and should cause the program to try and exit cleanly. 0 is a valid return value.
+	throwIse(env, result.error);
+	return -1;
+}
+
+static jint JNICALL
+ttyReadInputUntil(
+	JNIEnv *env,
+	jclass type UNUSED,
+	jlong ttyOpaque,
+	jbyteArray buffer,
+	jint offset,
+	jint count,
+	jint minCount,
+	jlong deadlineNanos
+) {
+	// Reads may return fewer bytes than requested, so a larger count is simply truncated.
+	uint8_t nativeBuffer[BOUNCE_BUFFER_SIZE];
+	if (count > BOUNCE_BUFFER_SIZE) {
+		count = BOUNCE_BUFFER_SIZE;
+	}
+
+	MosaicTty *tty = (MosaicTty *) ttyOpaque;
+	MosaicTtyIoResult result = tty_readInputUntil(
+		tty,
+		nativeBuffer,
+		count,
+		minCount,
+		deadlineNanos
+	);
+
+	if (likely(!result.error)) {
+		if (likely(result.count > 0)) {
+			(*env)->SetByteArrayRegion(env, buffer, offset, result.count, (jbyte *) nativeBuffer);
+		}
+		return result.count;
+	}
+
+	throwIse(env, result.error);
+	return -1;
+}
+
+static jlong JNICALL
+ttyMonotonicNanos(
+	JNIEnv *env UNUSED,
+	jclass type UNUSED
+) {
+	return tty_monotonicNanos();
+}
+
+static jint JNICALL
+ttyReadInputDirect(
+	JNIEnv *env,
+	jclass type UNUSED,
+	jlong ttyOpaque,
+	jobject buffer,
+	jint offset,
+	jint count
+) {
+	uint8_t *nativeBuffer = (*env)->GetDirectBufferAddress(env, buffer);
+
+	MosaicTty *tty = (MosaicTty *) ttyOpaque;
+	MosaicTtyIoResult result = tty_readInput(tty, nativeBuffer + offset, count);
 
 	if (likely(!result.error)) {
 		return result.count;
@@ -229,8 +358,8 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyReadInputWithTimeout(
 	return -1;
 }
 
-JNIEXPORT void JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_ttyInterruptRead(
+static void JNICALL
+ttyInterruptRead(
 	JNIEnv *env,
 	jclass type UNUSED,
 	jlong ttyOpaque
@@ -242,8 +371,8 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyInterruptRead(
 	}
 }
 
-JNIEXPORT jint JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_ttyWriteOutput(
+static jint JNICALL
+ttyWriteOutput(
 	JNIEnv *env,
 	jclass type UNUSED,
 	jlong ttyOpaque,
@@ -251,15 +380,14 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyWriteOutput(
 	jint offset,
 	jint count
 ) {
-	jbyte *bufferElements = (*env)->GetByteArrayElements(env, buffer, NULL);
-	jbyte *bufferElementsAtOffset = bufferElements + offset;
-	// Reinterpret JVM signed bytes as unsigned.
-	uint8_t *nativeBufferAtOffset = (uint8_t *) bufferElementsAtOffset;
+	uint8_t stackBuffer[BOUNCE_BUFFER_SIZE];
+	jbyte *bufferElements;
+	uint8_t *nativeBuffer = acquireWriteBuffer(env, buffer, offset, count, stackBuffer, &bufferElements);
 
 	MosaicTty *tty = (MosaicTty *) ttyOpaque;
-	MosaicTtyIoResult result = tty_writeOutput(tty, nativeBufferAtOffset, count);
+	MosaicTtyIoResult result = tty_writeOutput(tty, nativeBuffer, count);
 
-	(*env)->ReleaseByteArrayElements(env, buffer, bufferElements, 0);
+	releaseWriteBuffer(env, buffer, bufferElements);
 
 	if (likely(!result.error)) {
 		return result.count;
@@ -271,8 +399,113 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyWriteOutput(
 	return -1;
 }
 
-JNIEXPORT jint JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_ttyWriteError(
+static jint JNICALL
+ttyWriteOutputDirect(
+	JNIEnv *env,
+	jclass type UNUSED,
+	jlong ttyOpaque,
+	jobject buffer,
+	jint offset,
+	jint count
+) {
+	uint8_t *nativeBuffer = (*env)->GetDirectBufferAddress(env, buffer);
+
+	MosaicTty *tty = (MosaicTty *) ttyOpaque;
+	MosaicTtyIoResult result = tty_writeOutput(tty, nativeBuffer + offset, count);
+
+	if (likely(!result.error)) {
+		return result.count;
+	}
+
+	// This throw can fail, but the only condition that should cause that is OOM. Return -1 (EOF)
+	// and should cause the program to try and exit cleanly. 0 is a valid return value.
+	throwIse(env, result.error);
+	return -1;
+}
+
+static jint JNICALL
+ttyWriteOutputv(
+	JNIEnv *env,
+	jclass type UNUSED,
+	jlong ttyOpaque,
+	jobjectArray buffers,
+	jintArray offsets,
+	jintArray counts
+) {
+	// The Kotlin wrapper has validated the sizes and ranges, and skips calls without segments.
+	jsize segmentCount = (*env)->GetArrayLength(env, buffers);
+	jint *countElements = (*env)->GetIntArrayElements(env, counts, NULL);
+	if (unlikely(countElements == NULL)) {
+		return -1; // OutOfMemoryError is pending.
+	}
+	jint *offsetElements = (*env)->GetIntArrayElements(env, offsets, NULL);
+	if (unlikely(offsetElements == NULL)) {
+		(*env)->ReleaseIntArrayElements(env, counts, countElements, JNI_ABORT);
+		return -1; // OutOfMemoryError is pending.
+	}
+
+	jint total = 0;
+	for (jsize i = 0; i < segmentCount; i++) {
+		total += countElements[i];
+	}
+
+	// The segments are gathered into one native buffer since the write may block and so cannot hold
+	// a critical array region. This copies each segment once, rather than GetByteArrayElements
+	// potentially copying each entire array out and back.
+	uint8_t stackBuffer[BOUNCE_BUFFER_SIZE];
+	uint8_t *nativeBuffer = stackBuffer;
+	if (total > BOUNCE_BUFFER_SIZE) {
+		nativeBuffer = malloc(total);
+		if (unlikely(!nativeBuffer)) {
+			throwOom(env);
+			goto err;
+		}
+	}
+
+	jint position = 0;
+	for (jsize i = 0; i < segmentCount; i++) {
+		jbyteArray array = (*env)->GetObjectArrayElement(env, buffers, i);
+		if (unlikely(array == NULL)) {
+			if (!(*env)->ExceptionCheck(env)) {
+				throwIse(env, EINVAL);
+			}
+			goto err;
+		}
+		(*env)->GetByteArrayRegion(env, array, offsetElements[i], countElements[i], (jbyte *) nativeBuffer + position);
+		(*env)->DeleteLocalRef(env, array);
+		if (unlikely((*env)->ExceptionCheck(env))) {
+			goto err; // ArrayIndexOutOfBoundsException is pending.
+		}
+		position += countElements[i];
+	}
+	(*env)->ReleaseIntArrayElements(env, offsets, offsetElements, JNI_ABORT);
+	(*env)->ReleaseIntArrayElements(env, counts, countElements, JNI_ABORT);
+
+	MosaicTty *tty = (MosaicTty *) ttyOpaque;
+	MosaicTtyIoResult result = tty_writeOutputv(tty, &nativeBuffer, &total, 1);
+
+	if (nativeBuffer != stackBuffer) {
+		free(nativeBuffer);
+	}
+
+	if (likely(!result.error)) {
+		return result.count;
+	}
+
+	throwIse(env, result.error);
+	return -1;
+
+	err:
+	if (nativeBuffer != stackBuffer) {
+		free(nativeBuffer);
+	}
+	(*env)->ReleaseIntArrayElements(env, offsets, offsetElements, JNI_ABORT);
+	(*env)->ReleaseIntArrayElements(env, counts, countElements, JNI_ABORT);
+	return -1;
+}
+
+static jint JNICALL
+ttyBufferOutput(
 	JNIEnv *env,
 	jclass type UNUSED,
 	jlong ttyOpaque,
@@ -280,15 +513,90 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyWriteError(
 	jint offset,
 	jint count
 ) {
-	jbyte *bufferElements = (*env)->GetByteArrayElements(env, buffer, NULL);
+	// Only a memcpy occurs while the array is held, so a critical section is allowed and avoids the
+	// intermediate copy which GetByteArrayElements may otherwise make.
+	jbyte *bufferElements = (*env)->GetPrimitiveArrayCritical(env, buffer, NULL);
 	jbyte *bufferElementsAtOffset = bufferElements + offset;
 	// Reinterpret JVM signed bytes as unsigned.
 	uint8_t *nativeBufferAtOffset = (uint8_t *) bufferElementsAtOffset;
 
 	MosaicTty *tty = (MosaicTty *) ttyOpaque;
-	MosaicTtyIoResult result = tty_writeError(tty, nativeBufferAtOffset, count);
+	MosaicTtyIoResult result = tty_bufferOutput(tty, nativeBufferAtOffset, count);
+
+	(*env)->ReleasePrimitiveArrayCritical(env, buffer, bufferElements, JNI_ABORT);
+
+	if (likely(!result.error)) {
+		return result.count;
+	}
+
+	throwIse(env, result.error);
+	return -1;
+}
+
+static jint JNICALL
+ttyFlushOutput(
+	JNIEnv *env,
+	jclass type UNUSED,
+	jlong ttyOpaque
+) {
+	MosaicTty *tty = (MosaicTty *) ttyOpaque;
+	MosaicTtyIoResult result = tty_flushOutput(tty);
+	if (likely(!result.error)) {
+		return result.count;
+	}
+
+	throwIse(env, result.error);
+	return -1;
+}
+
+static void JNICALL
+ttyEnableAsyncOutput(
+	JNIEnv *env,
+	jclass type UNUSED,
+	jlong ttyOpaque,
+	jint capacity
+) {
+	MosaicTty *tty = (MosaicTty *) ttyOpaque;
+	uint32_t error = tty_enableAsyncOutput(tty, capacity);
+	if (unlikely(error)) {
+		throwIse(env, error);
+	}
+}
+
+static jint JNICALL
+ttyAwaitOutput(
+	JNIEnv *env,
+	jclass type UNUSED,
+	jlong ttyOpaque,
+	jint timeoutMillis
+) {
+	MosaicTty *tty = (MosaicTty *) ttyOpaque;
+	MosaicTtyIoResult result = tty_awaitOutput(tty, timeoutMillis);
+	if (likely(!result.error)) {
+		return result.count;
+	}
 
-	(*env)->ReleaseByteArrayElements(env, buffer, bufferElements, 0);
+	throwIse(env, result.error);
+	return -1;
+}
+
+static jint JNICALL
+ttyWriteError(
+	JNIEnv *env,
+	jclass type UNUSED,
+	jlong ttyOpaque,
+	jbyteArray buffer,
+	jint offset,
+	jint count
+) {
+	uint8_t stackBuffer[BOUNCE_BUFFER_SIZE];
+	jbyte *bufferElements;
+	uint8_t *nativeBuffer = acquireWriteBuffer(env, buffer, offset, count, stackBuffer, &bufferElements);
+
+	MosaicTty *tty = (MosaicTty *) ttyOpaque;
+	MosaicTtyIoResult result = tty_writeError(tty, nativeBuffer, count);
+
+	releaseWriteBuffer(env, buffer, bufferElements);
 
 	if (likely(!result.error)) {
 		return result.count;
@@ -300,8 +608,8 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyWriteError(
 	return -1;
 }
 
-JNIEXPORT void JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_ttyEnableRawMode(
+static void JNICALL
+ttyEnableRawMode(
 	JNIEnv *env,
 	jclass type UNUSED,
 	jlong ttyOpaque
@@ -313,8 +621,8 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyEnableRawMode(
 	}
 }
 
-JNIEXPORT void JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_ttyEnableWindowResizeEvents(
+static void JNICALL
+ttyEnableWindowResizeEvents(
 	JNIEnv *env,
 	jclass type UNUSED,
 	jlong ttyOpaque
@@ -326,8 +634,19 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyEnableWindowResizeEvents(
 	}
 }
 
-JNIEXPORT jintArray JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_ttyCurrentSize(
+static jboolean JNICALL
+ttyEnableIoUring(
+	JNIEnv *env UNUSED,
+	jclass type UNUSED,
+	jlong ttyOpaque
+) {
+	MosaicTty *tty = (MosaicTty *) ttyOpaque;
+	// Any error leaves the default implementation in place.
+	return tty_enableIoUring(tty) == 0;
+}
+
+static jintArray JNICALL
+ttyCurrentSize(
 	JNIEnv *env,
 	jclass type UNUSED,
 	jlong ttyOpaque
@@ -336,12 +655,11 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyCurrentSize(
 	MosaicTtyTerminalSizeResult result = tty_currentTerminalSize(tty);
 	if (likely(!result.error)) {
 		jintArray ints = (*env)->NewIntArray(env, 4);
-		jint *intsPtr = (*env)->GetIntArrayElements(env, ints, NULL);
-		intsPtr[0] = result.columns;
-		intsPtr[1] = result.rows;
-		intsPtr[2] = result.width;
-		intsPtr[3] = result.height;
-		(*env)->ReleaseIntArrayElements(env, ints, intsPtr, 0);
+		if (unlikely(ints == NULL)) {
+			return NULL;
+		}
+		jint values[4] = { result.columns, result.rows, result.width, result.height };
+		(*env)->SetIntArrayRegion(env, ints, 0, 4, values);
 		return ints;
 	}
 
@@ -349,8 +667,8 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyCurrentSize(
 	return NULL;
 }
 
-JNIEXPORT void JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_ttyFree(
+static void JNICALL
+ttyFree(
 	JNIEnv *env,
 	jclass type UNUSED,
 	jlong ttyOpaque
@@ -362,8 +680,96 @@ Java_com_jakewharton_mosaic_tty_Jni_ttyFree(
 	}
 }
 
-JNIEXPORT jlong JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_testTtyInit(
+static jlong JNICALL
+ttyReactorInit(
+	JNIEnv *env,
+	jclass type UNUSED
+) {
+	MosaicTtyReactorInitResult result = ttyReactor_init();
+	if (unlikely(result.error)) {
+		throwIse(env, result.error);
+	}
+	// A null reactor without an error indicates OOM.
+	return (jlong) result.reactor;
+}
+
+static void JNICALL
+ttyReactorAdd(
+	JNIEnv *env,
+	jclass type UNUSED,
+	jlong reactorOpaque,
+	jlong ttyOpaque
+) {
+	MosaicTtyReactor *reactor = (MosaicTtyReactor *) reactorOpaque;
+	MosaicTty *tty = (MosaicTty *) ttyOpaque;
+	uint32_t error = ttyReactor_add(reactor, tty);
+	if (unlikely(error)) {
+		throwIse(env, error);
+	}
+}
+
+static void JNICALL
+ttyReactorRemove(
+	JNIEnv *env,
+	jclass type UNUSED,
+	jlong reactorOpaque,
+	jlong ttyOpaque
+) {
+	MosaicTtyReactor *reactor = (MosaicTtyReactor *) reactorOpaque;
+	MosaicTty *tty = (MosaicTty *) ttyOpaque;
+	uint32_t error = ttyReactor_remove(reactor, tty);
+	if (unlikely(error)) {
+		throwIse(env, error);
+	}
+}
+
+static void JNICALL
+ttyReactorFree(
+	JNIEnv *env,
+	jclass type UNUSED,
+	jlong reactorOpaque
+) {
+	MosaicTtyReactor *reactor = (MosaicTtyReactor *) reactorOpaque;
+	uint32_t error = ttyReactor_free(reactor);
+	if (unlikely(error)) {
+		throwIse(env, error);
+	}
+}
+
+static jint JNICALL
+rowEncoderEncode(
+	JNIEnv *env,
+	jclass type UNUSED,
+	jintArray codePoints,
+	jintArray attributes,
+	jint offset,
+	jint count,
+	jint flags,
+	jbyteArray output,
+	jint outputOffset
+) {
+	// Encoding only computes over the arrays, so critical sections are allowed and avoid copying
+	// all three arrays out and back.
+	jint *codePointElements = (*env)->GetPrimitiveArrayCritical(env, codePoints, NULL);
+	jint *attributeElements = (*env)->GetPrimitiveArrayCritical(env, attributes, NULL);
+	jbyte *outputElements = (*env)->GetPrimitiveArrayCritical(env, output, NULL);
+
+	int written = rowEncoder_encode(
+		(uint32_t *) codePointElements + offset,
+		(uint32_t *) attributeElements + offset * MOSAIC_ROW_ATTRIBUTE_COUNT,
+		count,
+		(uint32_t) flags,
+		(uint8_t *) outputElements + outputOffset
+	);
+
+	(*env)->ReleasePrimitiveArrayCritical(env, output, outputElements, 0);
+	(*env)->ReleasePrimitiveArrayCritical(env, attributes, attributeElements, JNI_ABORT);
+	(*env)->ReleasePrimitiveArrayCritical(env, codePoints, codePointElements, JNI_ABORT);
+	return written;
+}
+
+static jlong JNICALL
+testTtyInit(
 	JNIEnv *env,
 	jclass type UNUSED
 ) {
@@ -378,8 +784,8 @@ Java_com_jakewharton_mosaic_tty_Jni_testTtyInit(
 	return 0;
 }
 
-JNIEXPORT jint JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_testTtyWriteInput(
+static jint JNICALL
+testTtyWriteInput(
 	JNIEnv *env,
 	jclass type UNUSED,
 	jlong testTtyOpaque,
@@ -387,15 +793,14 @@ Java_com_jakewharton_mosaic_tty_Jni_testTtyWriteInput(
 	jint offset,
 	jint count
 ) {
-	jbyte *bufferElements = (*env)->GetByteArrayElements(env, buffer, NULL);
-	jbyte *bufferElementsAtOffset = bufferElements + offset;
-	// Reinterpret JVM signed bytes as unsigned.
-	uint8_t *nativeBufferAtOffset = (uint8_t *) bufferElementsAtOffset;
+	uint8_t stackBuffer[BOUNCE_BUFFER_SIZE];
+	jbyte *bufferElements;
+	uint8_t *nativeBuffer = acquireWriteBuffer(env, buffer, offset, count, stackBuffer, &bufferElements);
 
 	MosaicTestTty *testTty = (MosaicTestTty *) testTtyOpaque;
-	MosaicTtyIoResult result = testTty_writeInput(testTty, nativeBufferAtOffset, count);
+	MosaicTtyIoResult result = testTty_writeInput(testTty, nativeBuffer, count);
 
-	(*env)->ReleaseByteArrayElements(env, buffer, bufferElements, 0);
+	releaseWriteBuffer(env, buffer, bufferElements);
 
 	if (likely(!result.error)) {
 		return result.count;
@@ -407,19 +812,46 @@ Java_com_jakewharton_mosaic_tty_Jni_testTtyWriteInput(
 	return -1;
 }
 
-JNIEXPORT void JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_testTtyFocusEvent(
+static jint JNICALL
+testTtyReadOutput(
+	JNIEnv *env,
+	jclass type UNUSED,
+	jlong testTtyOpaque,
+	jbyteArray buffer,
+	jint offset,
+	jint count
+) {
+	// Reads may return fewer bytes than requested, so a larger count is simply truncated.
+	uint8_t nativeBuffer[BOUNCE_BUFFER_SIZE];
+	if (count > BOUNCE_BUFFER_SIZE) {
+		count = BOUNCE_BUFFER_SIZE;
+	}
+
+	MosaicTestTty *testTty = (MosaicTestTty *) testTtyOpaque;
+	MosaicTtyIoResult result = testTty_readOutput(testTty, nativeBuffer, count);
+
+	if (likely(!result.error)) {
+		(*env)->SetByteArrayRegion(env, buffer, offset, result.count, (jbyte *) nativeBuffer);
+		return result.count;
+	}
+
+	throwIse(env, result.error);
+	return -1;
+}
+
+static void JNICALL
+testTtyFocusEvent(
 	JNIEnv *env UNUSED,
 	jclass type UNUSED,
 	jlong testTtyOpaque,
-	bool focused
+	jboolean focused
 ) {
 	MosaicTestTty *testTty = (MosaicTestTty *) testTtyOpaque;
 	testTty_focusEvent(testTty, focused);
 }
 
-JNIEXPORT void JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_testTtyKeyEvent(
+static void JNICALL
+testTtyKeyEvent(
 	JNIEnv *env UNUSED,
 	jclass type UNUSED,
 	jlong testTtyOpaque
@@ -428,8 +860,8 @@ Java_com_jakewharton_mosaic_tty_Jni_testTtyKeyEvent(
 	testTty_keyEvent(testTty);
 }
 
-JNIEXPORT void JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_testTtyMouseEvent(
+static void JNICALL
+testTtyMouseEvent(
 	JNIEnv *env UNUSED,
 	jclass type UNUSED,
 	jlong testTtyOpaque
@@ -438,8 +870,8 @@ Java_com_jakewharton_mosaic_tty_Jni_testTtyMouseEvent(
 	testTty_mouseEvent(testTty);
 }
 
-JNIEXPORT void JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_testTtyResizeEvent(
+static void JNICALL
+testTtyResizeEvent(
 	JNIEnv *env UNUSED,
 	jclass type UNUSED,
 	jlong testTtyOpaque,
@@ -452,8 +884,8 @@ Java_com_jakewharton_mosaic_tty_Jni_testTtyResizeEvent(
 	testTty_resizeEvent(testTty, columns, rows, width, height);
 }
 
-JNIEXPORT jlong JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_testTtyGetTty(
+static jlong JNICALL
+testTtyGetTty(
 	JNIEnv *env UNUSED,
 	jclass type UNUSED,
 	jlong testTtyOpaque
@@ -462,8 +894,8 @@ Java_com_jakewharton_mosaic_tty_Jni_testTtyGetTty(
 	return (jlong) testTty_getTty(testTty);
 }
 
-JNIEXPORT void JNICALL
-Java_com_jakewharton_mosaic_tty_Jni_testTtyFree(
+static void JNICALL
+testTtyFree(
 	JNIEnv *env UNUSED,
 	jclass type UNUSED,
 	jlong testTtyOpaque
@@ -474,3 +906,97 @@ Java_com_jakewharton_mosaic_tty_Jni_testTtyFree(
 		throwIse(env, error);
 	}
 }
+
+// Signatures must match the declarations in Jni.java.
+static const JNINativeMethod jniMethods[] = {
+	{ "ttyCallbackInit", "(Lcom/jakewharton/mosaic/tty/EventDispatcher;)J", (void *) ttyCallbackInit },
+	{ "ttyCallbackFree", "(J)V", (void *) ttyCallbackFree },
+	{ "ttyInit", "()J", (void *) ttyInit },
+	{ "ttyInitWithFds", "(III)J", (void *) ttyInitWithFds },
+	{ "ttySetCallback", "(JJ)V", (void *) ttySetCallback },
+	{ "ttyReadEvents", "(J[I)I", (void *) ttyReadEvents },
+	{ "ttyReadInput", "(J[BII)I", (void *) ttyReadInput },
+	{ "ttyReadInputWithTimeout", "(J[BIII)I", (void *) ttyReadInputWithTimeout },
+	{ "ttyReadInputUntil", "(J[BIIIJ)I", (void *) ttyReadInputUntil },
+	{ "ttyMonotonicNanos", "()J", (void *) ttyMonotonicNanos },
+	{ "ttyReadInputDirect", "(JLjava/nio/ByteBuffer;II)I", (void *) ttyReadInputDirect },
+	{ "ttyInterruptRead", "(J)V", (void *) ttyInterruptRead },
+	{ "ttyWriteOutput", "(J[BII)I", (void *) ttyWriteOutput },
+	{ "ttyWriteOutputDirect", "(JLjava/nio/ByteBuffer;II)I", (void *) ttyWriteOutputDirect },
+	{ "ttyWriteOutputv", "(J[[B[I[I)I", (void *) ttyWriteOutputv },
+	{ "ttyBufferOutput", "(J[BII)I", (void *) ttyBufferOutput },
+	{ "ttyFlushOutput", "(J)I", (void *) ttyFlushOutput },
+	{ "ttyEnableAsyncOutput", "(JI)V", (void *) ttyEnableAsyncOutput },
+	{ "ttyAwaitOutput", "(JI)I", (void *) ttyAwaitOutput },
+	{ "ttyWriteError", "(J[BII)I", (void *) ttyWriteError },
+	{ "ttyEnableRawMode", "(J)V", (void *) ttyEnableRawMode },
+	{ "ttyEnableWindowResizeEvents", "(J)V", (void *) ttyEnableWindowResizeEvents },
+	{ "ttyEnableIoUring", "(J)Z", (void *) ttyEnableIoUring },
+	{ "ttyCurrentSize", "(J)[I", (void *) ttyCurrentSize },
+	{ "ttyFree", "(J)V", (void *) ttyFree },
+	{ "ttyReactorInit", "()J", (void *) ttyReactorInit },
+	{ "ttyReactorAdd", "(JJ)V", (void *) ttyReactorAdd },
+	{ "ttyReactorRemove", "(JJ)V", (void *) ttyReactorRemove },
+	{ "ttyReactorFree", "(J)V", (void *) ttyReactorFree },
+	{ "rowEncoderEncode", "([I[IIII[BI)I", (void *) rowEncoderEncode },
+	{ "testTtyInit", "()J", (void *) testTtyInit },
+	{ "testTtyGetTty", "(J)J", (void *) testTtyGetTty },
+	{ "testTtyWriteInput", "(J[BII)I", (void *) testTtyWriteInput },
+	{ "testTtyReadOutput", "(J[BII)I", (void *) testTtyReadOutput },
+	{ "testTtyFocusEvent", "(JZ)V", (void *) testTtyFocusEvent },
+	{ "testTtyKeyEvent", "(J)V", (void *) testTtyKeyEvent },
+	{ "testTtyMouseEvent", "(J)V", (void *) testTtyMouseEvent },
+	{ "testTtyResizeEvent", "(JIIII)V", (void *) testTtyResizeEvent },
+	{ "testTtyFree", "(J)V", (void *) testTtyFree },
+};
+
+static jclass findGlobalClass(JNIEnv *env, const char *name) {
+	jclass local = (*env)->FindClass(env, name);
+	if (unlikely(local == NULL)) {
+		return NULL;
+	}
+	jclass global = (*env)->NewGlobalRef(env, local);
+	(*env)->DeleteLocalRef(env, local);
+	return global;
+}
+
+JNIEXPORT jint JNICALL
+JNI_OnLoad(JavaVM *vm, void *reserved UNUSED) {
+	JNIEnv *env;
+	if (unlikely((*vm)->GetEnv(vm, (void **) &env, JNI_VERSION_1_6) != JNI_OK)) {
+		return JNI_ERR;
+	}
+
+#if !defined(_WIN32)
+	if (unlikely(pthread_key_create(&attachedThreadKey, detachAttachedThread) != 0)) {
+		return JNI_ERR;
+	}
+#endif
+
+	illegalStateExceptionClass = findGlobalClass(env, "java/lang/IllegalStateException");
+	outOfMemoryErrorClass = findGlobalClass(env, "java/lang/OutOfMemoryError");
+	eventDispatcherClass = findGlobalClass(env, "com/jakewharton/mosaic/tty/EventDispatcher");
+	if (unlikely(!illegalStateExceptionClass || !outOfMemoryErrorClass || !eventDispatcherClass)) {
+		return JNI_ERR;
+	}
+
+	eventDispatcherOnEvents = (*env)->GetMethodID(env, eventDispatcherClass, "onEvents", "()V");
+	if (unlikely(!eventDispatcherOnEvents)) {
+		return JNI_ERR;
+	}
+
+	// Bind explicitly rather than having the JVM resolve each function by its mangled symbol name on
+	// first call. This also lets the symbols remain private to the library.
+	jclass jniClass = (*env)->FindClass(env, "com/jakewharton/mosaic/tty/Jni");
+	if (unlikely(jniClass == NULL)) {
+		return JNI_ERR;
+	}
+	jint methodCount = sizeof(jniMethods) / sizeof(jniMethods[0]);
+	jint registered = (*env)->RegisterNatives(env, jniClass, jniMethods, methodCount);
+	(*env)->DeleteLocalRef(env, jniClass);
+	if (unlikely(registered != JNI_OK)) {
+		return JNI_ERR;
+	}
+
+	return JNI_VERSION_1_6;
+}
@@ -0,0 +1,67 @@
+package com.jakewharton.mosaic.tty;
+
+/**
+ * Drains the events queued by the native library and dispatches them to a {@link Tty.Callback}.
+ * <p>
+ * The native library notifies {@link #onEvents} once per batch of queued events on whichever
+ * thread queued them. Draining them in bulk means a single upcall and a single downcall regardless
+ * of how many events arrive together.
+ */
+final class EventDispatcher {
+	/** Each event is a type followed by four values. Matches MosaicTtyEvent in mosaic-tty.h. */
+	static final int EVENT_INTS = 5;
+	/** Matches the capacity of the native queue so it can always be drained in one call. */
+	private static final int EVENT_COUNT = 64;
+
+	private static final int TYPE_FOCUS = 1;
+	private static final int TYPE_KEY = 2;
+	private static final int TYPE_MOUSE = 3;
+	private static final int TYPE_RESIZE = 4;
+	private static final int TYPE_INPUT = 5;
+
+	private final NativeBackend backend;
+	private final long ttyPtr;
+	private final Tty.Callback callback;
+	private final int[] events = new int[EVENT_COUNT * EVENT_INTS];
+
+	EventDispatcher(NativeBackend backend, long ttyPtr, Tty.Callback callback) {
+		this.backend = backend;
+		this.ttyPtr = ttyPtr;
+		this.callback = callback;
+	}
+
+	/** Invoked by the native library. Synchronized as events may be queued by multiple threads. */
+	synchronized void onEvents() {
+		int count;
+		do {
+			count = backend.ttyReadEvents(ttyPtr, events);
+			for (int i = 0; i < count; i++) {
+				int offset = i * EVENT_INTS;
+				switch (events[offset]) {
+					case TYPE_FOCUS:
+						callback.onFocus(events[offset + 1] != 0);
+						break;
+					case TYPE_KEY:
+						callback.onKey();
+						break;
+					case TYPE_MOUSE:
+						callback.onMouse();
+						break;
+					case TYPE_RESIZE:
+						callback.onResize(
+							events[offset + 1],
+							events[offset + 2],
+							events[offset + 3],
+							events[offset + 4]
+						);
+						break;
+					case TYPE_INPUT:
+						callback.onInput();
+						break;
+					default:
+						throw new IllegalStateException("Unknown event type " + events[offset]);
+				}
+			}
+		} while (count == EVENT_COUNT);
+	}
+}
@@ -4,6 +4,7 @@ import java.io.IOException;
 import java.io.InputStream;
 import java.io.UncheckedIOException;
 import java.net.URL;
+import java.nio.ByteBuffer;
 import java.nio.file.Files;
 import java.nio.file.Path;
 import static java.nio.file.StandardCopyOption.REPLACE_EXISTING;
@@ -56,13 +57,25 @@ final class Jni {
 		System.load(nativeLibraryFile.toAbsolutePath().toString());
 	}
 
-	static native long ttyCallbackInit(Tty.Callback callback);
+	/** Load the native library, if it has not already been, by initializing this class. */
+	static void ensureLoaded() {
+	}
+
+	static native long ttyCallbackInit(EventDispatcher dispatcher);
 
 	static native void ttyCallbackFree(long callbackPtr);
 
 	static native long ttyInit();
 
-	static native long ttySetCallback(long ttyPtr, long callbackPtr);
+	static native long ttyInitWithFds(int stdinReadFd, int stdoutWriteFd, int stderrWriteFd);
+
+	static native void ttySetCallback(long ttyPtr, long callbackPtr);
+
+	/**
+	 * Remove queued events into {@code events}, {@link EventDispatcher#EVENT_INTS} ints per event.
+	 * @return the number of events removed.
+	 */
+	static native int ttyReadEvents(long ttyPtr, int[] events);
 
 	static native int ttyReadInput(
 		long ttyPtr,
@@ -79,6 +92,25 @@ final class Jni {
 		int timeoutMillis
 	);
 
+	static native int ttyReadInputUntil(
+		long ttyPtr,
+		byte[] buffer,
+		int offset,
+		int count,
+		int minCount,
+		long deadlineNanos
+	);
+
+	static native long ttyMonotonicNanos();
+
+	/** @param buffer A direct buffer. */
+	static native int ttyReadInputDirect(
+		long ttyPtr,
+		ByteBuffer buffer,
+		int offset,
+		int count
+	);
+
 	static native void ttyInterruptRead(long ttyPtr);
 
 	static native int ttyWriteOutput(
@@ -88,6 +120,34 @@ final class Jni {
 		int count
 	);
 
+	/** @param buffer A direct buffer. */
+	static native int ttyWriteOutputDirect(
+		long ttyPtr,
+		ByteBuffer buffer,
+		int offset,
+		int count
+	);
+
+	static native int ttyWriteOutputv(
+		long ttyPtr,
+		byte[][] buffers,
+		int[] offsets,
+		int[] counts
+	);
+
+	static native int ttyBufferOutput(
+		long ttyPtr,
+		byte[] buffer,
+		int offset,
+		int count
+	);
+
+	static native int ttyFlushOutput(long ttyPtr);
+
+	static native void ttyEnableAsyncOutput(long ttyPtr, int capacity);
+
+	static native int ttyAwaitOutput(long ttyPtr, int timeoutMillis);
+
 	static native int ttyWriteError(
 		long ttyPtr,
 		byte[] buffer,
@@ -99,6 +159,8 @@ final class Jni {
 
 	static native void ttyEnableWindowResizeEvents(long ttyPtr);
 
+	static native boolean ttyEnableIoUring(long ttyPtr);
+
 	/**
 	 * @return Array of `[columns, rows, width, height]`. Using an array saves us from having to
 	 * pass a complex object across the JNI boundary.
@@ -107,12 +169,37 @@ final class Jni {
 
 	static native void ttyFree(long ttyPtr);
 
+	static native long ttyReactorInit();
+
+	static native void ttyReactorAdd(long reactorPtr, long ttyPtr);
+
+	static native void ttyReactorRemove(long reactorPtr, long ttyPtr);
+
+	static native void ttyReactorFree(long reactorPtr);
+
+	static native int rowEncoderEncode(
+		int[] codePoints,
+		int[] attributes,
+		int offset,
+		int count,
+		int flags,
+		byte[] output,
+		int outputOffset
+	);
+
 	static native long testTtyInit();
 
 	static native long testTtyGetTty(long testTtyPtr);
 
 	static native int testTtyWriteInput(long testTtyPtr, byte[] buffer, int offset, int count);
 
+	static native int testTtyReadOutput(
+		long testTtyPtr,
+		byte[] buffer,
+		int offset,
+		int count
+	);
+
 	static native void testTtyFocusEvent(long testTtyPtr, boolean focused);
 
 	static native void testTtyKeyEvent(long testTtyPtr);
@@ -0,0 +1,182 @@
+package com.jakewharton.mosaic.tty;
+
+import java.nio.ByteBuffer;
+
+final class JniBackend extends NativeBackend {
+	@Override long ttyCallbackInit(EventDispatcher dispatcher) {
+		return Jni.ttyCallbackInit(dispatcher);
+	}
+
+	@Override void ttyCallbackFree(long callbackPtr) {
+		Jni.ttyCallbackFree(callbackPtr);
+	}
+
+	@Override long ttyInit() {
+		return Jni.ttyInit();
+	}
+
+	@Override long ttyInitWithFds(int stdinReadFd, int stdoutWriteFd, int stderrWriteFd) {
+		return Jni.ttyInitWithFds(stdinReadFd, stdoutWriteFd, stderrWriteFd);
+	}
+
+	@Override void ttySetCallback(long ttyPtr, long callbackPtr) {
+		Jni.ttySetCallback(ttyPtr, callbackPtr);
+	}
+
+	@Override int ttyReadEvents(long ttyPtr, int[] events) {
+		return Jni.ttyReadEvents(ttyPtr, events);
+	}
+
+	@Override int ttyReadInput(long ttyPtr, byte[] buffer, int offset, int count) {
+		return Jni.ttyReadInput(ttyPtr, buffer, offset, count);
+	}
+
+	@Override int ttyReadInputWithTimeout(
+		long ttyPtr,
+		byte[] buffer,
+		int offset,
+		int count,
+		int timeoutMillis
+	) {
+		return Jni.ttyReadInputWithTimeout(ttyPtr, buffer, offset, count, timeoutMillis);
+	}
+
+	@Override int ttyReadInputUntil(
+		long ttyPtr,
+		byte[] buffer,
+		int offset,
+		int count,
+		int minCount,
+		long deadlineNanos
+	) {
+		return Jni.ttyReadInputUntil(ttyPtr, buffer, offset, count, minCount, deadlineNanos);
+	}
+
+	@Override long ttyMonotonicNanos() {
+		return Jni.ttyMonotonicNanos();
+	}
+
+	@Override int ttyReadInputDirect(long ttyPtr, ByteBuffer buffer, int offset, int count) {
+		return Jni.ttyReadInputDirect(ttyPtr, buffer, offset, count);
+	}
+
+	@Override void ttyInterruptRead(long ttyPtr) {
+		Jni.ttyInterruptRead(ttyPtr);
+	}
+
+	@Override int ttyWriteOutput(long ttyPtr, byte[] buffer, int offset, int count) {
+		return Jni.ttyWriteOutput(ttyPtr, buffer, offset, count);
+	}
+
+	@Override int ttyWriteOutputDirect(long ttyPtr, ByteBuffer buffer, int offset, int count) {
+		return Jni.ttyWriteOutputDirect(ttyPtr, buffer, offset, count);
+	}
+
+	@Override int ttyWriteOutputv(long ttyPtr, byte[][] buffers, int[] offsets, int[] counts) {
+		return Jni.ttyWriteOutputv(ttyPtr, buffers, offsets, counts);
+	}
+
+	@Override int ttyBufferOutput(long ttyPtr, byte[] buffer, int offset, int count) {
+		return Jni.ttyBufferOutput(ttyPtr, buffer, offset, count);
+	}
+
+	@Override int ttyFlushOutput(long ttyPtr) {
+		return Jni.ttyFlushOutput(ttyPtr);
+	}
+
+	@Override void ttyEnableAsyncOutput(long ttyPtr, int capacity) {
+		Jni.ttyEnableAsyncOutput(ttyPtr, capacity);
+	}
+
+	@Override int ttyAwaitOutput(long ttyPtr, int timeoutMillis) {
+		return Jni.ttyAwaitOutput(ttyPtr, timeoutMillis);
+	}
+
+	@Override int ttyWriteError(long ttyPtr, byte[] buffer, int offset, int count) {
+		return Jni.ttyWriteError(ttyPtr, buffer, offset, count);
+	}
+
+	@Override void ttyEnableRawMode(long ttyPtr) {
+		Jni.ttyEnableRawMode(ttyPtr);
+	}
+
+	@Override void ttyEnableWindowResizeEvents(long ttyPtr) {
+		Jni.ttyEnableWindowResizeEvents(ttyPtr);
+	}
+
+	@Override boolean ttyEnableIoUring(long ttyPtr) {
+		return Jni.ttyEnableIoUring(ttyPtr);
+	}
+
+	@Override int[] ttyCurrentSize(long ttyPtr) {
+		return Jni.ttyCurrentSize(ttyPtr);
+	}
+
+	@Override void ttyFree(long ttyPtr) {
+		Jni.ttyFree(ttyPtr);
+	}
+
+	@Override long ttyReactorInit() {
+		return Jni.ttyReactorInit();
+	}
+
+	@Override void ttyReactorAdd(long reactorPtr, long ttyPtr) {
+		Jni.ttyReactorAdd(reactorPtr, ttyPtr);
+	}
+
+	@Override void ttyReactorRemove(long reactorPtr, long ttyPtr) {
+		Jni.ttyReactorRemove(reactorPtr, ttyPtr);
+	}
+
+	@Override void ttyReactorFree(long reactorPtr) {
+		Jni.ttyReactorFree(reactorPtr);
+	}
+
+	@Override int rowEncoderEncode(
+		int[] codePoints,
+		int[] attributes,
+		int offset,
+		int count,
+		int flags,
+		byte[] output,
+		int outputOffset
+	) {
+		return Jni.rowEncoderEncode(codePoints, attributes, offset, count, flags, output, outputOffset);
+	}
+
+	@Override long testTtyInit() {
+		return Jni.testTtyInit();
+	}
+
+	@Override long testTtyGetTty(long testTtyPtr) {
+		return Jni.testTtyGetTty(testTtyPtr);
+	}
+
+	@Override int testTtyWriteInput(long testTtyPtr, byte[] buffer, int offset, int count) {
+		return Jni.testTtyWriteInput(testTtyPtr, buffer, offset, count);
+	}
+
+	@Override int testTtyReadOutput(long testTtyPtr, byte[] buffer, int offset, int count) {
+		return Jni.testTtyReadOutput(testTtyPtr, buffer, offset, count);
+	}
+
+	@Override void testTtyFocusEvent(long testTtyPtr, boolean focused) {
+		Jni.testTtyFocusEvent(testTtyPtr, focused);
+	}
+
+	@Override void testTtyKeyEvent(long testTtyPtr) {
+		Jni.testTtyKeyEvent(testTtyPtr);
+	}
+
+	@Override void testTtyMouseEvent(long testTtyPtr) {
+		Jni.testTtyMouseEvent(testTtyPtr);
+	}
+
+	@Override void testTtyResizeEvent(long testTtyPtr, int columns, int rows, int width, int height) {
+		Jni.testTtyResizeEvent(testTtyPtr, columns, rows, width, height);
+	}
+
+	@Override void testTtyFree(long testTtyPtr) {
+		Jni.testTtyFree(testTtyPtr);
+	}
+}
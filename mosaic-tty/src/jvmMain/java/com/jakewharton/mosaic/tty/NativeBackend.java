@@ -0,0 +1,179 @@
+package com.jakewharton.mosaic.tty;
+
+import java.lang.reflect.InvocationTargetException;
+import java.lang.reflect.Method;
+import java.nio.ByteBuffer;
+
+/**
+ * The calls into the native library. Each method corresponds to the function of the same name on
+ * {@link Jni}, and pointers to native structures are passed as {@code long}s.
+ * <p>
+ * The implementation is chosen once when this class is initialized. On JDK 22 and newer when native
+ * access has been granted (such as with {@code --enable-native-access=ALL-UNNAMED}) the library is
+ * called through the Foreign Function and Memory API which avoids the overhead of JNI. Otherwise,
+ * JNI is used. Set the {@value #BACKEND_PROPERTY} system property to {@code jni} or {@code ffm} to
+ * override this choice.
+ */
+abstract class NativeBackend {
+	static final String BACKEND_PROPERTY = "com.jakewharton.mosaic.tty.backend";
+
+	static final NativeBackend INSTANCE = select();
+
+	private static NativeBackend select() {
+		String backend = System.getProperty(BACKEND_PROPERTY);
+		if ("jni".equals(backend)) {
+			return new JniBackend();
+		}
+		boolean ffmRequired = "ffm".equals(backend);
+		if (backend != null && !ffmRequired) {
+			throw new IllegalStateException(
+				"Unknown " + BACKEND_PROPERTY + " value '" + backend + "'. Expected 'jni' or 'ffm'.");
+		}
+
+		if (javaFeatureVersion() >= 22) {
+			NativeBackend ffmBackend = createFfmBackend(ffmRequired);
+			if (ffmBackend != null) {
+				return ffmBackend;
+			}
+		} else if (ffmRequired) {
+			throw new IllegalStateException("The 'ffm' backend requires JDK 22 or newer");
+		}
+		return new JniBackend();
+	}
+
+	private static int javaFeatureVersion() {
+		String version = System.getProperty("java.specification.version");
+		if (version.startsWith("1.")) {
+			return 8; // Versions before 9 used 1.x.
+		}
+		return Integer.parseInt(version);
+	}
+
+	/**
+	 * The FFM backend is compiled for Java 22 and must only be loaded on a JDK which supports it,
+	 * so it is created reflectively.
+	 */
+	private static NativeBackend createFfmBackend(boolean required) {
+		try {
+			Class<?> ffmBackend = Class.forName("com.jakewharton.mosaic.tty.FfmBackend");
+			Method create = ffmBackend.getDeclaredMethod("create", boolean.class);
+			return (NativeBackend) create.invoke(null, required);
+		} catch (InvocationTargetException e) {
+			Throwable cause = e.getCause();
+			if (cause instanceof RuntimeException) {
+				throw (RuntimeException) cause;
+			}
+			if (cause instanceof Error) {
+				throw (Error) cause;
+			}
+			throw new IllegalStateException(cause);
+		} catch (ReflectiveOperationException e) {
+			if (required) {
+				throw new IllegalStateException("The 'ffm' backend is unavailable", e);
+			}
+			return null;
+		}
+	}
+
+	abstract long ttyCallbackInit(EventDispatcher dispatcher);
+
+	abstract void ttyCallbackFree(long callbackPtr);
+
+	abstract long ttyInit();
+
+	abstract long ttyInitWithFds(int stdinReadFd, int stdoutWriteFd, int stderrWriteFd);
+
+	abstract void ttySetCallback(long ttyPtr, long callbackPtr);
+
+	abstract int ttyReadEvents(long ttyPtr, int[] events);
+
+	abstract int ttyReadInput(long ttyPtr, byte[] buffer, int offset, int count);
+
+	abstract int ttyReadInputWithTimeout(
+		long ttyPtr,
+		byte[] buffer,
+		int offset,
+		int count,
+		int timeoutMillis
+	);
+
+	abstract int ttyReadInputUntil(
+		long ttyPtr,
+		byte[] buffer,
+		int offset,
+		int count,
+		int minCount,
+		long deadlineNanos
+	);
+
+	abstract long ttyMonotonicNanos();
+
+	/** @param buffer A direct buffer. */
+	abstract int ttyReadInputDirect(long ttyPtr, ByteBuffer buffer, int offset, int count);
+
+	abstract void ttyInterruptRead(long ttyPtr);
+
+	abstract int ttyWriteOutput(long ttyPtr, byte[] buffer, int offset, int count);
+
+	/** @param buffer A direct buffer. */
+	abstract int ttyWriteOutputDirect(long ttyPtr, ByteBuffer buffer, int offset, int count);
+
+	abstract int ttyWriteOutputv(long ttyPtr, byte[][] buffers, int[] offsets, int[] counts);
+
+	abstract int ttyBufferOutput(long ttyPtr, byte[] buffer, int offset, int count);
+
+	abstract int ttyFlushOutput(long ttyPtr);
+
+	abstract void ttyEnableAsyncOutput(long ttyPtr, int capacity);
+
+	abstract int ttyAwaitOutput(long ttyPtr, int timeoutMillis);
+
+	abstract int ttyWriteError(long ttyPtr, byte[] buffer, int offset, int count);
+
+	abstract void ttyEnableRawMode(long ttyPtr);
+
+	abstract void ttyEnableWindowResizeEvents(long ttyPtr);
+
+	abstract boolean ttyEnableIoUring(long ttyPtr);
+
+	/** @return Array of `[columns, rows, width, height]`. */
+	abstract int[] ttyCurrentSize(long ttyPtr);
+
+	abstract void ttyFree(long ttyPtr);
+
+	abstract long ttyReactorInit();
+
+	abstract void ttyReactorAdd(long reactorPtr, long ttyPtr);
+
+	abstract void ttyReactorRemove(long reactorPtr, long ttyPtr);
+
+	abstract void ttyReactorFree(long reactorPtr);
+
+	abstract int rowEncoderEncode(
+		int[] codePoints,
+		int[] attributes,
+		int offset,
+		int count,
+		int flags,
+		byte[] output,
+		int outputOffset
+	);
+
+	abstract long testTtyInit();
+
+	abstract long testTtyGetTty(long testTtyPtr);
+
+	abstract int testTtyWriteInput(long testTtyPtr, byte[] buffer, int offset, int count);
+
+	abstract int testTtyReadOutput(long testTtyPtr, byte[] buffer, int offset, int count);
+
+	abstract void testTtyFocusEvent(long testTtyPtr, boolean focused);
+
+	abstract void testTtyKeyEvent(long testTtyPtr);
+
+	abstract void testTtyMouseEvent(long testTtyPtr);
+
+	abstract void testTtyResizeEvent(long testTtyPtr, int columns, int rows, int width, int height);
+
+	abstract void testTtyFree(long testTtyPtr);
+}
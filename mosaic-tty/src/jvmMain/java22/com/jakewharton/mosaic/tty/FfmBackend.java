@@ -0,0 +1,1010 @@
+package com.jakewharton.mosaic.tty;
+
+import java.lang.foreign.Arena;
+import java.lang.foreign.FunctionDescriptor;
+import java.lang.foreign.Linker;
+import java.lang.foreign.MemoryLayout;
+import java.lang.foreign.MemorySegment;
+import java.lang.foreign.SegmentAllocator;
+import java.lang.foreign.StructLayout;
+import java.lang.foreign.SymbolLookup;
+import java.lang.invoke.MethodHandle;
+import java.lang.invoke.MethodHandles;
+import java.lang.invoke.MethodType;
+import java.nio.ByteBuffer;
+import java.util.concurrent.ConcurrentHashMap;
+
+import static java.lang.foreign.MemoryLayout.PathElement.groupElement;
+import static java.lang.foreign.ValueLayout.ADDRESS;
+import static java.lang.foreign.ValueLayout.JAVA_BOOLEAN;
+import static java.lang.foreign.ValueLayout.JAVA_BYTE;
+import static java.lang.foreign.ValueLayout.JAVA_INT;
+import static java.lang.foreign.ValueLayout.JAVA_LONG;
+
+/**
+ * Calls the native library through the Foreign Function and Memory API (JDK 22+).
+ * <p>
+ * Pointers cross the boundary as plain addresses and direct buffers are passed without copying.
+ * Array contents which are only copied by native code are passed in place using critical calls.
+ * Reads and writes may block, so like the JNI bindings they copy through a per-thread native
+ * buffer instead of holding an array for their duration.
+ */
+final class FfmBackend extends NativeBackend {
+	/**
+	 * @param required When false, returns null if native access has not been granted to avoid the
+	 * warning that would otherwise be printed. Also returns null if the library does not export the
+	 * functions (as on Windows where only {@code JNI_OnLoad} is exported).
+	 */
+	static FfmBackend create(boolean required) {
+		if (!required && !FfmBackend.class.getModule().isNativeAccessEnabled()) {
+			return null;
+		}
+		Jni.ensureLoaded();
+		if (SymbolLookup.loaderLookup().find("tty_init").isEmpty()) {
+			if (required) {
+				throw new IllegalStateException("The 'ffm' backend is unsupported on this platform");
+			}
+			return null;
+		}
+		return new FfmBackend();
+	}
+
+	private FfmBackend() {
+	}
+
+	/** Matches BOUNCE_BUFFER_SIZE in mosaic-jni.c. */
+	private static final int BOUNCE_BUFFER_SIZE = 8192;
+
+	private static final StructLayout TTY_INIT_RESULT = MemoryLayout.structLayout(
+		ADDRESS.withName("tty"),
+		JAVA_INT.withName("error"),
+		JAVA_BOOLEAN.withName("already_bound"),
+		MemoryLayout.paddingLayout(ADDRESS.byteSize() - JAVA_INT.byteSize() - JAVA_BOOLEAN.byteSize())
+	);
+	private static final long TTY_INIT_RESULT_ERROR = TTY_INIT_RESULT.byteOffset(groupElement("error"));
+	private static final long TTY_INIT_RESULT_ALREADY_BOUND =
+		TTY_INIT_RESULT.byteOffset(groupElement("already_bound"));
+
+	private static final StructLayout TTY_REACTOR_INIT_RESULT = MemoryLayout.structLayout(
+		ADDRESS.withName("reactor"),
+		JAVA_INT.withName("error"),
+		MemoryLayout.paddingLayout(ADDRESS.byteSize() - JAVA_INT.byteSize())
+	);
+	private static final long TTY_REACTOR_INIT_RESULT_ERROR =
+		TTY_REACTOR_INIT_RESULT.byteOffset(groupElement("error"));
+
+	private static final StructLayout TEST_TTY_INIT_RESULT = MemoryLayout.structLayout(
+		ADDRESS.withName("testTty"),
+		JAVA_INT.withName("error"),
+		MemoryLayout.paddingLayout(ADDRESS.byteSize() - JAVA_INT.byteSize())
+	);
+	private static final long TEST_TTY_INIT_RESULT_ERROR =
+		TEST_TTY_INIT_RESULT.byteOffset(groupElement("error"));
+
+	private static final StructLayout IO_RESULT = MemoryLayout.structLayout(
+		JAVA_INT.withName("count"),
+		JAVA_INT.withName("error")
+	);
+	private static final long IO_RESULT_COUNT = IO_RESULT.byteOffset(groupElement("count"));
+	private static final long IO_RESULT_ERROR = IO_RESULT.byteOffset(groupElement("error"));
+
+	private static final StructLayout TERMINAL_SIZE_RESULT = MemoryLayout.structLayout(
+		JAVA_INT.withName("columns"),
+		JAVA_INT.withName("rows"),
+		JAVA_INT.withName("width"),
+		JAVA_INT.withName("height"),
+		JAVA_INT.withName("error")
+	);
+	private static final long TERMINAL_SIZE_RESULT_ERROR =
+		TERMINAL_SIZE_RESULT.byteOffset(groupElement("error"));
+
+	private static final StructLayout CALLBACK = MemoryLayout.structLayout(
+		ADDRESS.withName("opaque"),
+		ADDRESS.withName("onEvents")
+	);
+	private static final long CALLBACK_ON_EVENTS = CALLBACK.byteOffset(groupElement("onEvents"));
+
+	private static final Linker LINKER = Linker.nativeLinker();
+
+	/**
+	 * The handles are only looked up once {@link #create} has confirmed they are available. Method
+	 * handles must be held in static final fields for invocations to be fully inlined.
+	 */
+	private static final class Downcalls {
+		static final MethodHandle TTY_INIT = downcall(
+			"tty_init",
+			FunctionDescriptor.of(TTY_INIT_RESULT)
+		);
+		static final MethodHandle TTY_INIT_WITH_FDS = downcall(
+			"tty_initWithFds",
+			FunctionDescriptor.of(TTY_INIT_RESULT, JAVA_INT, JAVA_INT, JAVA_INT)
+		);
+		static final MethodHandle TTY_SET_CALLBACK = downcall(
+			"tty_setCallback",
+			FunctionDescriptor.ofVoid(ADDRESS, ADDRESS)
+		);
+		// Only a memcpy of queued events occurs, so a heap segment can be passed directly.
+		static final MethodHandle TTY_READ_EVENTS = downcall(
+			"tty_readEvents",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS, ADDRESS, JAVA_INT),
+			Linker.Option.critical(true)
+		);
+		static final MethodHandle TTY_READ_INPUT = downcall(
+			"tty_readInput",
+			FunctionDescriptor.of(IO_RESULT, ADDRESS, ADDRESS, JAVA_INT)
+		);
+		static final MethodHandle TTY_READ_INPUT_WITH_TIMEOUT = downcall(
+			"tty_readInputWithTimeout",
+			FunctionDescriptor.of(IO_RESULT, ADDRESS, ADDRESS, JAVA_INT, JAVA_INT)
+		);
+		static final MethodHandle TTY_READ_INPUT_UNTIL = downcall(
+			"tty_readInputUntil",
+			FunctionDescriptor.of(IO_RESULT, ADDRESS, ADDRESS, JAVA_INT, JAVA_INT, JAVA_LONG)
+		);
+		// Only reads a clock, so the thread does not need to transition out of Java.
+		static final MethodHandle TTY_MONOTONIC_NANOS = downcall(
+			"tty_monotonicNanos",
+			FunctionDescriptor.of(JAVA_LONG),
+			Linker.Option.critical(false)
+		);
+		static final MethodHandle TTY_INTERRUPT_READ = downcall(
+			"tty_interruptRead",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS)
+		);
+		static final MethodHandle TTY_WRITE_OUTPUT = downcall(
+			"tty_writeOutput",
+			FunctionDescriptor.of(IO_RESULT, ADDRESS, ADDRESS, JAVA_INT)
+		);
+		static final MethodHandle TTY_WRITE_OUTPUTV = downcall(
+			"tty_writeOutputv",
+			FunctionDescriptor.of(IO_RESULT, ADDRESS, ADDRESS, ADDRESS, JAVA_INT)
+		);
+		// Only a memcpy occurs, so a heap segment can be passed directly.
+		static final MethodHandle TTY_BUFFER_OUTPUT = downcall(
+			"tty_bufferOutput",
+			FunctionDescriptor.of(IO_RESULT, ADDRESS, ADDRESS, JAVA_INT),
+			Linker.Option.critical(true)
+		);
+		static final MethodHandle TTY_FLUSH_OUTPUT = downcall(
+			"tty_flushOutput",
+			FunctionDescriptor.of(IO_RESULT, ADDRESS)
+		);
+		static final MethodHandle TTY_ENABLE_ASYNC_OUTPUT = downcall(
+			"tty_enableAsyncOutput",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS, JAVA_INT)
+		);
+		static final MethodHandle TTY_AWAIT_OUTPUT = downcall(
+			"tty_awaitOutput",
+			FunctionDescriptor.of(IO_RESULT, ADDRESS, JAVA_INT)
+		);
+		static final MethodHandle TTY_WRITE_ERROR = downcall(
+			"tty_writeError",
+			FunctionDescriptor.of(IO_RESULT, ADDRESS, ADDRESS, JAVA_INT)
+		);
+		static final MethodHandle TTY_ENABLE_RAW_MODE = downcall(
+			"tty_enableRawMode",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS)
+		);
+		static final MethodHandle TTY_ENABLE_WINDOW_RESIZE_EVENTS = downcall(
+			"tty_enableWindowResizeEvents",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS)
+		);
+		static final MethodHandle TTY_ENABLE_IO_URING = downcall(
+			"tty_enableIoUring",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS)
+		);
+		static final MethodHandle TTY_CURRENT_TERMINAL_SIZE = downcall(
+			"tty_currentTerminalSize",
+			FunctionDescriptor.of(TERMINAL_SIZE_RESULT, ADDRESS),
+			Linker.Option.critical(false)
+		);
+		static final MethodHandle TTY_FREE = downcall(
+			"tty_free",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS)
+		);
+		static final MethodHandle TTY_REACTOR_INIT = downcall(
+			"ttyReactor_init",
+			FunctionDescriptor.of(TTY_REACTOR_INIT_RESULT)
+		);
+		static final MethodHandle TTY_REACTOR_ADD = downcall(
+			"ttyReactor_add",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS, ADDRESS)
+		);
+		static final MethodHandle TTY_REACTOR_REMOVE = downcall(
+			"ttyReactor_remove",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS, ADDRESS)
+		);
+		static final MethodHandle TTY_REACTOR_FREE = downcall(
+			"ttyReactor_free",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS)
+		);
+		// Only computes over the arrays, so heap segments can be passed directly.
+		static final MethodHandle ROW_ENCODER_ENCODE = downcall(
+			"rowEncoder_encode",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS, ADDRESS, JAVA_INT, JAVA_INT, ADDRESS),
+			Linker.Option.critical(true)
+		);
+		static final MethodHandle TEST_TTY_INIT = downcall(
+			"testTty_init",
+			FunctionDescriptor.of(TEST_TTY_INIT_RESULT)
+		);
+		static final MethodHandle TEST_TTY_GET_TTY = downcall(
+			"testTty_getTty",
+			FunctionDescriptor.of(ADDRESS, ADDRESS),
+			Linker.Option.critical(false)
+		);
+		static final MethodHandle TEST_TTY_WRITE_INPUT = downcall(
+			"testTty_writeInput",
+			FunctionDescriptor.of(IO_RESULT, ADDRESS, ADDRESS, JAVA_INT)
+		);
+		static final MethodHandle TEST_TTY_READ_OUTPUT = downcall(
+			"testTty_readOutput",
+			FunctionDescriptor.of(IO_RESULT, ADDRESS, ADDRESS, JAVA_INT)
+		);
+		static final MethodHandle TEST_TTY_FOCUS_EVENT = downcall(
+			"testTty_focusEvent",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS, JAVA_BOOLEAN)
+		);
+		static final MethodHandle TEST_TTY_KEY_EVENT = downcall(
+			"testTty_keyEvent",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS)
+		);
+		static final MethodHandle TEST_TTY_MOUSE_EVENT = downcall(
+			"testTty_mouseEvent",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS)
+		);
+		static final MethodHandle TEST_TTY_RESIZE_EVENT = downcall(
+			"testTty_resizeEvent",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS, JAVA_INT, JAVA_INT, JAVA_INT, JAVA_INT)
+		);
+		static final MethodHandle TEST_TTY_FREE = downcall(
+			"testTty_free",
+			FunctionDescriptor.of(JAVA_INT, ADDRESS)
+		);
+
+		private static MethodHandle downcall(
+			String name,
+			FunctionDescriptor descriptor,
+			Linker.Option... options
+		) {
+			MemorySegment symbol = SymbolLookup.loaderLookup()
+				.find(name)
+				.orElseThrow(() -> new IllegalStateException("Missing native symbol " + name));
+			return LINKER.downcallHandle(symbol, descriptor, options);
+		}
+	}
+
+	private static final class Upcalls {
+		static final FunctionDescriptor ON_EVENTS_DESCRIPTOR = FunctionDescriptor.ofVoid(ADDRESS);
+
+		static final MethodHandle ON_EVENTS;
+		static {
+			MethodType type = ON_EVENTS_DESCRIPTOR.toMethodType();
+			try {
+				ON_EVENTS = MethodHandles.lookup().findVirtual(Upcalls.class, "onEvents", type);
+			} catch (ReflectiveOperationException e) {
+				throw new AssertionError(e);
+			}
+		}
+
+		private final EventDispatcher dispatcher;
+
+		Upcalls(EventDispatcher dispatcher) {
+			this.dispatcher = dispatcher;
+		}
+
+		void onEvents(MemorySegment opaque) {
+			try {
+				dispatcher.onEvents();
+			} catch (Throwable t) {
+				// An exception escaping an upcall terminates the JVM. Instead, hold it to be thrown
+				// from the downcall which caused the upcall, like a pending JNI exception. Upcalls
+				// from a reactor thread have no such downcall, so report it as uncaught there.
+				CallbackState callbacks = CALLBACK_STATE.get();
+				if (callbacks.downcall) {
+					callbacks.failure = t;
+				} else {
+					reportUncaught(t);
+				}
+			}
+		}
+
+		private static void reportUncaught(Throwable t) {
+			Thread thread = Thread.currentThread();
+			try {
+				thread.getUncaughtExceptionHandler().uncaughtException(thread, t);
+			} catch (Throwable ignored) {
+				// A throwing handler must not escape the upcall either.
+			}
+		}
+	}
+
+	/** Per-thread state for upcalls which occur while a downcall is in progress on that thread. */
+	private static final class CallbackState {
+		/** Whether a downcall which may cause an upcall is in progress. */
+		boolean downcall;
+		/** The exception thrown by an upcall during the current downcall, or null. */
+		Throwable failure;
+
+		void throwFailure() {
+			Throwable failure = this.failure;
+			if (failure != null) {
+				this.failure = null;
+				throw sneakyThrow(failure);
+			}
+		}
+	}
+
+	private static final ThreadLocal<CallbackState> CALLBACK_STATE =
+		ThreadLocal.withInitial(CallbackState::new);
+
+	/** Native memory reused by calls on the same thread. */
+	private static final class Scratch {
+		final MemorySegment buffer;
+		/** Holds struct return values. Only one is live at a time so each is allocated at 0. */
+		final SegmentAllocator result;
+
+		Scratch() {
+			Arena arena = Arena.ofAuto();
+			buffer = arena.allocate(BOUNCE_BUFFER_SIZE);
+			long resultSize = Math.max(TTY_INIT_RESULT.byteSize(), TERMINAL_SIZE_RESULT.byteSize());
+			result = SegmentAllocator.prefixAllocator(arena.allocate(resultSize, ADDRESS.byteAlignment()));
+		}
+	}
+
+	private static final ThreadLocal<Scratch> SCRATCH = ThreadLocal.withInitial(Scratch::new);
+
+	/** Arenas owning the struct and upcall stubs of each callback, keyed by struct address. */
+	private final ConcurrentHashMap<Long, Arena> callbackArenas = new ConcurrentHashMap<>();
+
+	@Override long ttyCallbackInit(EventDispatcher dispatcher) {
+		// Callbacks are invoked on the thread which queued the events.
+		Arena arena = Arena.ofShared();
+		Upcalls upcalls = new Upcalls(dispatcher);
+
+		MemorySegment struct = arena.allocate(CALLBACK);
+		struct.set(ADDRESS, 0, MemorySegment.NULL);
+		struct.set(ADDRESS, CALLBACK_ON_EVENTS, LINKER.upcallStub(
+			Upcalls.ON_EVENTS.bindTo(upcalls), Upcalls.ON_EVENTS_DESCRIPTOR, arena));
+
+		long callbackPtr = struct.address();
+		callbackArenas.put(callbackPtr, arena);
+		return callbackPtr;
+	}
+
+	@Override void ttyCallbackFree(long callbackPtr) {
+		callbackArenas.remove(callbackPtr).close();
+	}
+
+	@Override long ttyInit() {
+		MemorySegment result;
+		try {
+			result = (MemorySegment) Downcalls.TTY_INIT.invokeExact(SCRATCH.get().result);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		long ttyPtr = result.get(ADDRESS, 0).address();
+		if (ttyPtr != 0L) {
+			return ttyPtr;
+		}
+		if (result.get(JAVA_BOOLEAN, TTY_INIT_RESULT_ALREADY_BOUND)) {
+			throw new IllegalStateException("Tty already bound");
+		}
+		throw ise(result.get(JAVA_INT, TTY_INIT_RESULT_ERROR));
+	}
+
+	@Override long ttyInitWithFds(int stdinReadFd, int stdoutWriteFd, int stderrWriteFd) {
+		MemorySegment result;
+		try {
+			result = (MemorySegment) Downcalls.TTY_INIT_WITH_FDS.invokeExact(
+				SCRATCH.get().result,
+				stdinReadFd,
+				stdoutWriteFd,
+				stderrWriteFd
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		int error = result.get(JAVA_INT, TTY_INIT_RESULT_ERROR);
+		if (error != 0) {
+			throw ise(error);
+		}
+		// A null tty without an error indicates OOM.
+		return result.get(ADDRESS, 0).address();
+	}
+
+	@Override void ttySetCallback(long ttyPtr, long callbackPtr) {
+		try {
+			Downcalls.TTY_SET_CALLBACK.invokeExact(
+				MemorySegment.ofAddress(ttyPtr),
+				MemorySegment.ofAddress(callbackPtr)
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+	}
+
+	@Override int ttyReadEvents(long ttyPtr, int[] events) {
+		try {
+			return (int) Downcalls.TTY_READ_EVENTS.invokeExact(
+				MemorySegment.ofAddress(ttyPtr),
+				MemorySegment.ofArray(events),
+				events.length / EventDispatcher.EVENT_INTS
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+	}
+
+	@Override int ttyReadInput(long ttyPtr, byte[] buffer, int offset, int count) {
+		Scratch scratch = SCRATCH.get();
+		MemorySegment result;
+		CallbackState callbacks = CALLBACK_STATE.get();
+		callbacks.downcall = true;
+		try {
+			// Reads may return fewer bytes than requested, so a larger count is simply truncated.
+			result = (MemorySegment) Downcalls.TTY_READ_INPUT.invokeExact(
+				scratch.result,
+				MemorySegment.ofAddress(ttyPtr),
+				scratch.buffer,
+				Math.min(count, BOUNCE_BUFFER_SIZE)
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		} finally {
+			callbacks.downcall = false;
+		}
+		callbacks.throwFailure();
+		return readResult(result, scratch.buffer, buffer, offset);
+	}
+
+	@Override int ttyReadInputWithTimeout(
+		long ttyPtr,
+		byte[] buffer,
+		int offset,
+		int count,
+		int timeoutMillis
+	) {
+		Scratch scratch = SCRATCH.get();
+		MemorySegment result;
+		CallbackState callbacks = CALLBACK_STATE.get();
+		callbacks.downcall = true;
+		try {
+			// Reads may return fewer bytes than requested, so a larger count is simply truncated.
+			result = (MemorySegment) Downcalls.TTY_READ_INPUT_WITH_TIMEOUT.invokeExact(
+				scratch.result,
+				MemorySegment.ofAddress(ttyPtr),
+				scratch.buffer,
+				Math.min(count, BOUNCE_BUFFER_SIZE),
+				timeoutMillis
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		} finally {
+			callbacks.downcall = false;
+		}
+		callbacks.throwFailure();
+		return readResult(result, scratch.buffer, buffer, offset);
+	}
+
+	@Override int ttyReadInputUntil(
+		long ttyPtr,
+		byte[] buffer,
+		int offset,
+		int count,
+		int minCount,
+		long deadlineNanos
+	) {
+		Scratch scratch = SCRATCH.get();
+		MemorySegment result;
+		CallbackState callbacks = CALLBACK_STATE.get();
+		callbacks.downcall = true;
+		try {
+			// Reads may return fewer bytes than requested, so a larger count is simply truncated.
+			result = (MemorySegment) Downcalls.TTY_READ_INPUT_UNTIL.invokeExact(
+				scratch.result,
+				MemorySegment.ofAddress(ttyPtr),
+				scratch.buffer,
+				Math.min(count, BOUNCE_BUFFER_SIZE),
+				minCount,
+				deadlineNanos
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		} finally {
+			callbacks.downcall = false;
+		}
+		callbacks.throwFailure();
+		return readResult(result, scratch.buffer, buffer, offset);
+	}
+
+	@Override long ttyMonotonicNanos() {
+		try {
+			return (long) Downcalls.TTY_MONOTONIC_NANOS.invokeExact();
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+	}
+
+	@Override int ttyReadInputDirect(long ttyPtr, ByteBuffer buffer, int offset, int count) {
+		MemorySegment result;
+		CallbackState callbacks = CALLBACK_STATE.get();
+		callbacks.downcall = true;
+		try {
+			result = (MemorySegment) Downcalls.TTY_READ_INPUT.invokeExact(
+				SCRATCH.get().result,
+				MemorySegment.ofAddress(ttyPtr),
+				directSegment(buffer, offset, count),
+				count
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		} finally {
+			callbacks.downcall = false;
+		}
+		callbacks.throwFailure();
+		return ioResult(result);
+	}
+
+	@Override void ttyInterruptRead(long ttyPtr) {
+		int error;
+		try {
+			error = (int) Downcalls.TTY_INTERRUPT_READ.invokeExact(MemorySegment.ofAddress(ttyPtr));
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		if (error != 0) {
+			throw ise(error);
+		}
+	}
+
+	@Override int ttyWriteOutput(long ttyPtr, byte[] buffer, int offset, int count) {
+		return write(Downcalls.TTY_WRITE_OUTPUT, ttyPtr, buffer, offset, count);
+	}
+
+	@Override int ttyWriteOutputDirect(long ttyPtr, ByteBuffer buffer, int offset, int count) {
+		MemorySegment result;
+		try {
+			result = (MemorySegment) Downcalls.TTY_WRITE_OUTPUT.invokeExact(
+				SCRATCH.get().result,
+				MemorySegment.ofAddress(ttyPtr),
+				directSegment(buffer, offset, count),
+				count
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		return ioResult(result);
+	}
+
+	@Override int ttyWriteOutputv(long ttyPtr, byte[][] buffers, int[] offsets, int[] counts) {
+		int segmentCount = buffers.length;
+		try (Arena arena = Arena.ofConfined()) {
+			MemorySegment nativeBuffers = arena.allocate(ADDRESS, segmentCount);
+			MemorySegment nativeCounts = arena.allocateFrom(JAVA_INT, counts);
+			for (int i = 0; i < segmentCount; i++) {
+				MemorySegment segment = arena.allocate(counts[i]);
+				MemorySegment.copy(buffers[i], offsets[i], segment, JAVA_BYTE, 0, counts[i]);
+				nativeBuffers.setAtIndex(ADDRESS, i, segment);
+			}
+
+			MemorySegment result;
+			try {
+				result = (MemorySegment) Downcalls.TTY_WRITE_OUTPUTV.invokeExact(
+					SCRATCH.get().result,
+					MemorySegment.ofAddress(ttyPtr),
+					nativeBuffers,
+					nativeCounts,
+					segmentCount
+				);
+			} catch (Throwable t) {
+				throw sneakyThrow(t);
+			}
+			return ioResult(result);
+		}
+	}
+
+	@Override int ttyBufferOutput(long ttyPtr, byte[] buffer, int offset, int count) {
+		MemorySegment result;
+		try {
+			result = (MemorySegment) Downcalls.TTY_BUFFER_OUTPUT.invokeExact(
+				SCRATCH.get().result,
+				MemorySegment.ofAddress(ttyPtr),
+				MemorySegment.ofArray(buffer).asSlice(offset, count),
+				count
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		return ioResult(result);
+	}
+
+	@Override int ttyFlushOutput(long ttyPtr) {
+		MemorySegment result;
+		try {
+			result = (MemorySegment) Downcalls.TTY_FLUSH_OUTPUT.invokeExact(
+				SCRATCH.get().result,
+				MemorySegment.ofAddress(ttyPtr)
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		return ioResult(result);
+	}
+
+	@Override void ttyEnableAsyncOutput(long ttyPtr, int capacity) {
+		int error;
+		try {
+			error = (int) Downcalls.TTY_ENABLE_ASYNC_OUTPUT.invokeExact(
+				MemorySegment.ofAddress(ttyPtr),
+				capacity
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		if (error != 0) {
+			throw ise(error);
+		}
+	}
+
+	@Override int ttyAwaitOutput(long ttyPtr, int timeoutMillis) {
+		MemorySegment result;
+		try {
+			result = (MemorySegment) Downcalls.TTY_AWAIT_OUTPUT.invokeExact(
+				SCRATCH.get().result,
+				MemorySegment.ofAddress(ttyPtr),
+				timeoutMillis
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		return ioResult(result);
+	}
+
+	@Override int ttyWriteError(long ttyPtr, byte[] buffer, int offset, int count) {
+		return write(Downcalls.TTY_WRITE_ERROR, ttyPtr, buffer, offset, count);
+	}
+
+	@Override void ttyEnableRawMode(long ttyPtr) {
+		int error;
+		try {
+			error = (int) Downcalls.TTY_ENABLE_RAW_MODE.invokeExact(MemorySegment.ofAddress(ttyPtr));
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		if (error != 0) {
+			throw ise(error);
+		}
+	}
+
+	@Override void ttyEnableWindowResizeEvents(long ttyPtr) {
+		int error;
+		try {
+			error = (int) Downcalls.TTY_ENABLE_WINDOW_RESIZE_EVENTS.invokeExact(
+				MemorySegment.ofAddress(ttyPtr)
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		if (error != 0) {
+			throw ise(error);
+		}
+	}
+
+	@Override boolean ttyEnableIoUring(long ttyPtr) {
+		int error;
+		try {
+			error = (int) Downcalls.TTY_ENABLE_IO_URING.invokeExact(MemorySegment.ofAddress(ttyPtr));
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		// Any error leaves the default implementation in place.
+		return error == 0;
+	}
+
+	@Override int[] ttyCurrentSize(long ttyPtr) {
+		MemorySegment result;
+		try {
+			result = (MemorySegment) Downcalls.TTY_CURRENT_TERMINAL_SIZE.invokeExact(
+				SCRATCH.get().result,
+				MemorySegment.ofAddress(ttyPtr)
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		int error = result.get(JAVA_INT, TERMINAL_SIZE_RESULT_ERROR);
+		if (error != 0) {
+			throw ise(error);
+		}
+		return result.asSlice(0, JAVA_INT.byteSize() * 4).toArray(JAVA_INT);
+	}
+
+	@Override void ttyFree(long ttyPtr) {
+		int error;
+		try {
+			error = (int) Downcalls.TTY_FREE.invokeExact(MemorySegment.ofAddress(ttyPtr));
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		if (error != 0) {
+			throw ise(error);
+		}
+	}
+
+	@Override long ttyReactorInit() {
+		MemorySegment result;
+		try {
+			result = (MemorySegment) Downcalls.TTY_REACTOR_INIT.invokeExact(SCRATCH.get().result);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		int error = result.get(JAVA_INT, TTY_REACTOR_INIT_RESULT_ERROR);
+		if (error != 0) {
+			throw ise(error);
+		}
+		// A null reactor without an error indicates OOM.
+		return result.get(ADDRESS, 0).address();
+	}
+
+	@Override void ttyReactorAdd(long reactorPtr, long ttyPtr) {
+		int error;
+		try {
+			error = (int) Downcalls.TTY_REACTOR_ADD.invokeExact(
+				MemorySegment.ofAddress(reactorPtr),
+				MemorySegment.ofAddress(ttyPtr)
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		if (error != 0) {
+			throw ise(error);
+		}
+	}
+
+	@Override void ttyReactorRemove(long reactorPtr, long ttyPtr) {
+		int error;
+		try {
+			error = (int) Downcalls.TTY_REACTOR_REMOVE.invokeExact(
+				MemorySegment.ofAddress(reactorPtr),
+				MemorySegment.ofAddress(ttyPtr)
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		if (error != 0) {
+			throw ise(error);
+		}
+	}
+
+	@Override void ttyReactorFree(long reactorPtr) {
+		int error;
+		try {
+			error = (int) Downcalls.TTY_REACTOR_FREE.invokeExact(MemorySegment.ofAddress(reactorPtr));
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		if (error != 0) {
+			throw ise(error);
+		}
+	}
+
+	@Override int rowEncoderEncode(
+		int[] codePoints,
+		int[] attributes,
+		int offset,
+		int count,
+		int flags,
+		byte[] output,
+		int outputOffset
+	) {
+		try {
+			return (int) Downcalls.ROW_ENCODER_ENCODE.invokeExact(
+				MemorySegment.ofArray(codePoints).asSlice(offset * 4L),
+				// Each cell has 4 attribute values.
+				MemorySegment.ofArray(attributes).asSlice(offset * 16L),
+				count,
+				flags,
+				MemorySegment.ofArray(output).asSlice(outputOffset)
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+	}
+
+	@Override long testTtyInit() {
+		MemorySegment result;
+		try {
+			result = (MemorySegment) Downcalls.TEST_TTY_INIT.invokeExact(SCRATCH.get().result);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		int error = result.get(JAVA_INT, TEST_TTY_INIT_RESULT_ERROR);
+		if (error != 0) {
+			throw ise(error);
+		}
+		return result.get(ADDRESS, 0).address();
+	}
+
+	@Override long testTtyGetTty(long testTtyPtr) {
+		try {
+			MemorySegment tty = (MemorySegment) Downcalls.TEST_TTY_GET_TTY.invokeExact(
+				MemorySegment.ofAddress(testTtyPtr)
+			);
+			return tty.address();
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+	}
+
+	@Override int testTtyWriteInput(long testTtyPtr, byte[] buffer, int offset, int count) {
+		return write(Downcalls.TEST_TTY_WRITE_INPUT, testTtyPtr, buffer, offset, count);
+	}
+
+	// Like the JNI bindings, failures to send test events are ignored.
+
+	@Override int testTtyReadOutput(long testTtyPtr, byte[] buffer, int offset, int count) {
+		Scratch scratch = SCRATCH.get();
+		MemorySegment result;
+		try {
+			// Reads may return fewer bytes than requested, so a larger count is simply truncated.
+			result = (MemorySegment) Downcalls.TEST_TTY_READ_OUTPUT.invokeExact(
+				scratch.result,
+				MemorySegment.ofAddress(testTtyPtr),
+				scratch.buffer,
+				Math.min(count, BOUNCE_BUFFER_SIZE)
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		return readResult(result, scratch.buffer, buffer, offset);
+	}
+
+	@Override void testTtyFocusEvent(long testTtyPtr, boolean focused) {
+		CallbackState callbacks = CALLBACK_STATE.get();
+		callbacks.downcall = true;
+		try {
+			int ignored = (int) Downcalls.TEST_TTY_FOCUS_EVENT.invokeExact(
+				MemorySegment.ofAddress(testTtyPtr),
+				focused
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		} finally {
+			callbacks.downcall = false;
+		}
+		callbacks.throwFailure();
+	}
+
+	@Override void testTtyKeyEvent(long testTtyPtr) {
+		CallbackState callbacks = CALLBACK_STATE.get();
+		callbacks.downcall = true;
+		try {
+			int ignored = (int) Downcalls.TEST_TTY_KEY_EVENT.invokeExact(
+				MemorySegment.ofAddress(testTtyPtr)
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		} finally {
+			callbacks.downcall = false;
+		}
+		callbacks.throwFailure();
+	}
+
+	@Override void testTtyMouseEvent(long testTtyPtr) {
+		CallbackState callbacks = CALLBACK_STATE.get();
+		callbacks.downcall = true;
+		try {
+			int ignored = (int) Downcalls.TEST_TTY_MOUSE_EVENT.invokeExact(
+				MemorySegment.ofAddress(testTtyPtr)
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		} finally {
+			callbacks.downcall = false;
+		}
+		callbacks.throwFailure();
+	}
+
+	@Override void testTtyResizeEvent(long testTtyPtr, int columns, int rows, int width, int height) {
+		CallbackState callbacks = CALLBACK_STATE.get();
+		callbacks.downcall = true;
+		try {
+			int ignored = (int) Downcalls.TEST_TTY_RESIZE_EVENT.invokeExact(
+				MemorySegment.ofAddress(testTtyPtr),
+				columns,
+				rows,
+				width,
+				height
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		} finally {
+			callbacks.downcall = false;
+		}
+		callbacks.throwFailure();
+	}
+
+	@Override void testTtyFree(long testTtyPtr) {
+		int error;
+		try {
+			error = (int) Downcalls.TEST_TTY_FREE.invokeExact(MemorySegment.ofAddress(testTtyPtr));
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		if (error != 0) {
+			throw ise(error);
+		}
+	}
+
+	/**
+	 * Call a write function of the form {@code (MosaicTty *, uint8_t *, int) -> MosaicTtyIoResult}.
+	 * Writes must be complete, so a count which does not fit in the scratch buffer is copied into a
+	 * temporary allocation.
+	 */
+	private static int write(MethodHandle function, long ptr, byte[] buffer, int offset, int count) {
+		Scratch scratch = SCRATCH.get();
+		if (count <= BOUNCE_BUFFER_SIZE) {
+			MemorySegment.copy(buffer, offset, scratch.buffer, JAVA_BYTE, 0, count);
+			return write(function, scratch, ptr, scratch.buffer, count);
+		}
+		try (Arena arena = Arena.ofConfined()) {
+			MemorySegment nativeBuffer = arena.allocate(count);
+			MemorySegment.copy(buffer, offset, nativeBuffer, JAVA_BYTE, 0, count);
+			return write(function, scratch, ptr, nativeBuffer, count);
+		}
+	}
+
+	private static int write(
+		MethodHandle function,
+		Scratch scratch,
+		long ptr,
+		MemorySegment nativeBuffer,
+		int count
+	) {
+		MemorySegment result;
+		try {
+			result = (MemorySegment) function.invokeExact(
+				scratch.result,
+				MemorySegment.ofAddress(ptr),
+				nativeBuffer,
+				count
+			);
+		} catch (Throwable t) {
+			throw sneakyThrow(t);
+		}
+		return ioResult(result);
+	}
+
+	/** @param offset The buffer's current position, which {@link MemorySegment#ofBuffer} starts at. */
+	private static MemorySegment directSegment(ByteBuffer buffer, int offset, int count) {
+		return MemorySegment.ofBuffer(buffer).asSlice(offset - buffer.position(), count);
+	}
+
+	private static int readResult(
+		MemorySegment result,
+		MemorySegment nativeBuffer,
+		byte[] buffer,
+		int offset
+	) {
+		int count = ioResult(result);
+		MemorySegment.copy(nativeBuffer, JAVA_BYTE, 0, buffer, offset, count);
+		return count;
+	}
+
+	private static int ioResult(MemorySegment result) {
+		int error = result.get(JAVA_INT, IO_RESULT_ERROR);
+		if (error != 0) {
+			throw ise(error);
+		}
+		return result.get(JAVA_INT, IO_RESULT_COUNT);
+	}
+
+	private static IllegalStateException ise(int error) {
+		return new IllegalStateException(Integer.toUnsignedString(error));
+	}
+
+	@SuppressWarnings("unchecked")
+	private static <T extends Throwable> RuntimeException sneakyThrow(Throwable t) throws T {
+		throw (T) t;
+	}
+}
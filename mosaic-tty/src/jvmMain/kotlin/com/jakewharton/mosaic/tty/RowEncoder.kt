@@ -0,0 +1,13 @@
+package com.jakewharton.mosaic.tty
+
+internal actual fun rowEncoderEncode(
+	codePoints: IntArray,
+	attributes: IntArray,
+	offset: Int,
+	count: Int,
+	flags: Int,
+	output: ByteArray,
+	outputOffset: Int,
+): Int {
+	return NativeBackend.INSTANCE.rowEncoderEncode(codePoints, attributes, offset, count, flags, output, outputOffset)
+}
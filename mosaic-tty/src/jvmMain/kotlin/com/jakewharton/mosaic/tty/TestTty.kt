@@ -1,8 +1,5 @@
 package com.jakewharton.mosaic.tty
 
-import com.jakewharton.mosaic.tty.Jni.testTtyGetTty
-import com.jakewharton.mosaic.tty.Jni.testTtyInit
-
 public actual class TestTty private constructor(
 	private var testTtyPtr: Long,
 	public actual val tty: Tty,
@@ -10,9 +7,9 @@ public actual class TestTty private constructor(
 	public actual companion object {
 		@JvmStatic
 		public actual fun create(): TestTty {
-			val testTtyPtr = testTtyInit()
+			val testTtyPtr = NativeBackend.INSTANCE.testTtyInit()
 			if (testTtyPtr != 0L) {
-				val ttyPtr = testTtyGetTty(testTtyPtr)
+				val ttyPtr = NativeBackend.INSTANCE.testTtyGetTty(testTtyPtr)
 				val tty = Tty(ttyPtr)
 				return TestTty(testTtyPtr, tty)
 			}
@@ -21,29 +18,33 @@ public actual class TestTty private constructor(
 	}
 
 	public actual fun writeInput(buffer: ByteArray, offset: Int, count: Int): Int {
-		return Jni.testTtyWriteInput(testTtyPtr, buffer, offset, count)
+		return NativeBackend.INSTANCE.testTtyWriteInput(testTtyPtr, buffer, offset, count)
+	}
+
+	public actual fun readOutput(buffer: ByteArray, offset: Int, count: Int): Int {
+		return NativeBackend.INSTANCE.testTtyReadOutput(testTtyPtr, buffer, offset, count)
 	}
 
 	public actual fun focusEvent(focused: Boolean) {
-		Jni.testTtyFocusEvent(testTtyPtr, focused)
+		NativeBackend.INSTANCE.testTtyFocusEvent(testTtyPtr, focused)
 	}
 
 	public actual fun keyEvent() {
-		Jni.testTtyKeyEvent(testTtyPtr)
+		NativeBackend.INSTANCE.testTtyKeyEvent(testTtyPtr)
 	}
 
 	public actual fun mouseEvent() {
-		Jni.testTtyMouseEvent(testTtyPtr)
+		NativeBackend.INSTANCE.testTtyMouseEvent(testTtyPtr)
 	}
 
 	public actual fun resizeEvent(columns: Int, rows: Int, width: Int, height: Int) {
-		Jni.testTtyResizeEvent(testTtyPtr, columns, rows, width, height)
+		NativeBackend.INSTANCE.testTtyResizeEvent(testTtyPtr, columns, rows, width, height)
 	}
 
 	actual override fun close() {
 		if (testTtyPtr != 0L) {
 			tty.close()
-			Jni.testTtyFree(testTtyPtr)
+			NativeBackend.INSTANCE.testTtyFree(testTtyPtr)
 			testTtyPtr = 0
 		}
 	}
@@ -1,29 +1,48 @@
 package com.jakewharton.mosaic.tty
 
+import java.nio.ByteBuffer
+
 public actual class Tty internal constructor(
 	private var ttyPtr: Long,
 ) : AutoCloseable {
 	public actual companion object {
 		@JvmStatic
 		public actual fun bind(): Tty {
-			val ttyPtr = Jni.ttyInit()
+			val ttyPtr = NativeBackend.INSTANCE.ttyInit()
+			if (ttyPtr != 0L) {
+				return Tty(ttyPtr)
+			}
+			throw OutOfMemoryError()
+		}
+
+		@JvmStatic
+		public actual fun bind(inputFd: Int, outputFd: Int, errorFd: Int): Tty {
+			val ttyPtr = NativeBackend.INSTANCE.ttyInitWithFds(inputFd, outputFd, errorFd)
 			if (ttyPtr != 0L) {
 				return Tty(ttyPtr)
 			}
 			throw OutOfMemoryError()
 		}
+
+		@JvmStatic
+		public actual fun monotonicNanos(): Long {
+			return NativeBackend.INSTANCE.ttyMonotonicNanos()
+		}
 	}
 
+	internal val nativePtr: Long get() = ttyPtr
+
 	private var callbackPtr = 0L
 
 	public actual fun setCallback(callback: Callback?) {
 		val oldCallbackPtr = callbackPtr
 		if (oldCallbackPtr != 0L) {
-			Jni.ttyCallbackFree(oldCallbackPtr)
+			NativeBackend.INSTANCE.ttyCallbackFree(oldCallbackPtr)
 		}
 
 		val newCallbackPtr = if (callback != null) {
-			Jni.ttyCallbackInit(callback).also { ptr ->
+			val dispatcher = EventDispatcher(NativeBackend.INSTANCE, ttyPtr, callback)
+			NativeBackend.INSTANCE.ttyCallbackInit(dispatcher).also { ptr ->
 				if (ptr == 0L) {
 					throw OutOfMemoryError()
 				}
@@ -33,48 +52,118 @@ public actual class Tty internal constructor(
 		}
 
 		callbackPtr = newCallbackPtr
-		Jni.ttySetCallback(ttyPtr, newCallbackPtr)
+		NativeBackend.INSTANCE.ttySetCallback(ttyPtr, newCallbackPtr)
 	}
 
 	public actual fun readInput(buffer: ByteArray, offset: Int, count: Int): Int {
-		return Jni.ttyReadInput(ttyPtr, buffer, offset, count)
+		return NativeBackend.INSTANCE.ttyReadInput(ttyPtr, buffer, offset, count)
 	}
 
 	public actual fun readInputWithTimeout(buffer: ByteArray, offset: Int, count: Int, timeoutMillis: Int): Int {
-		return Jni.ttyReadInputWithTimeout(ttyPtr, buffer, offset, count, timeoutMillis)
+		return NativeBackend.INSTANCE.ttyReadInputWithTimeout(ttyPtr, buffer, offset, count, timeoutMillis)
+	}
+
+	public actual fun readInputUntil(
+		buffer: ByteArray,
+		offset: Int,
+		count: Int,
+		minCount: Int,
+		deadlineNanos: Long,
+	): Int {
+		return NativeBackend.INSTANCE.ttyReadInputUntil(ttyPtr, buffer, offset, count, minCount, deadlineNanos)
+	}
+
+	/**
+	 * Read up to [ByteBuffer.remaining] bytes into the direct [buffer] at its position, advancing
+	 * the position by the number of bytes read. Otherwise behaves like [readInput].
+	 *
+	 * Unlike with a [ByteArray], the bytes are read directly into the buffer's memory without an
+	 * intermediate copy.
+	 */
+	public fun readInput(buffer: ByteBuffer): Int {
+		require(buffer.isDirect) { "buffer must be direct" }
+		val position = buffer.position()
+		val read = NativeBackend.INSTANCE.ttyReadInputDirect(ttyPtr, buffer, position, buffer.remaining())
+		if (read > 0) {
+			buffer.position(position + read)
+		}
+		return read
 	}
 
 	public actual fun interruptRead() {
-		Jni.ttyInterruptRead(ttyPtr)
+		NativeBackend.INSTANCE.ttyInterruptRead(ttyPtr)
 	}
 
 	public actual fun writeOutput(buffer: ByteArray, offset: Int, count: Int): Int {
-		return Jni.ttyWriteOutput(ttyPtr, buffer, offset, count)
+		return NativeBackend.INSTANCE.ttyWriteOutput(ttyPtr, buffer, offset, count)
+	}
+
+	/**
+	 * Write up to [ByteBuffer.remaining] bytes from the direct [buffer] at its position, advancing
+	 * the position by the number of bytes written. Otherwise behaves like [writeOutput].
+	 *
+	 * Unlike with a [ByteArray], the bytes are written directly from the buffer's memory without an
+	 * intermediate copy.
+	 */
+	public fun writeOutput(buffer: ByteBuffer): Int {
+		require(buffer.isDirect) { "buffer must be direct" }
+		val position = buffer.position()
+		val written = NativeBackend.INSTANCE.ttyWriteOutputDirect(ttyPtr, buffer, position, buffer.remaining())
+		if (written > 0) {
+			buffer.position(position + written)
+		}
+		return written
+	}
+
+	public actual fun writeOutput(buffers: Array<ByteArray>, offsets: IntArray, counts: IntArray): Int {
+		checkSegments(buffers, offsets, counts)
+		if (buffers.isEmpty()) return 0
+		return NativeBackend.INSTANCE.ttyWriteOutputv(ttyPtr, buffers, offsets, counts)
+	}
+
+	public actual fun bufferOutput(buffer: ByteArray, offset: Int, count: Int): Int {
+		return NativeBackend.INSTANCE.ttyBufferOutput(ttyPtr, buffer, offset, count)
+	}
+
+	public actual fun flushOutput(): Int {
+		return NativeBackend.INSTANCE.ttyFlushOutput(ttyPtr)
+	}
+
+	public actual fun enableAsyncOutput(capacity: Int) {
+		NativeBackend.INSTANCE.ttyEnableAsyncOutput(ttyPtr, capacity)
+	}
+
+	public actual fun awaitOutput(timeoutMillis: Int): Int {
+		return NativeBackend.INSTANCE.ttyAwaitOutput(ttyPtr, timeoutMillis)
 	}
 
 	public actual fun writeError(buffer: ByteArray, offset: Int, count: Int): Int {
-		return Jni.ttyWriteError(ttyPtr, buffer, offset, count)
+		return NativeBackend.INSTANCE.ttyWriteError(ttyPtr, buffer, offset, count)
 	}
 
 	public actual fun enableRawMode() {
-		Jni.ttyEnableRawMode(ttyPtr)
+		NativeBackend.INSTANCE.ttyEnableRawMode(ttyPtr)
 	}
 
 	public actual fun enableWindowResizeEvents() {
-		Jni.ttyEnableWindowResizeEvents(ttyPtr)
+		NativeBackend.INSTANCE.ttyEnableWindowResizeEvents(ttyPtr)
+	}
+
+	public actual fun enableIoUring(): Boolean {
+		return NativeBackend.INSTANCE.ttyEnableIoUring(ttyPtr)
 	}
 
 	public actual fun currentSize(): IntArray {
-		return Jni.ttyCurrentSize(ttyPtr)
+		return NativeBackend.INSTANCE.ttyCurrentSize(ttyPtr)
 	}
 
 	actual override fun close() {
 		if (ttyPtr != 0L) {
-			Jni.ttyFree(ttyPtr)
+			NativeBackend.INSTANCE.ttyFree(ttyPtr)
 			ttyPtr = 0
 
 			if (callbackPtr != 0L) {
-				Jni.ttyCallbackFree(callbackPtr)
+				NativeBackend.INSTANCE.ttyCallbackFree(callbackPtr)
 				callbackPtr = 0
 			}
 		}
@@ -85,5 +174,6 @@ public actual class Tty internal constructor(
 		public actual fun onKey()
 		public actual fun onMouse()
 		public actual fun onResize(columns: Int, rows: Int, width: Int, height: Int)
+		public actual fun onInput()
 	}
 }
@@ -0,0 +1,31 @@
+package com.jakewharton.mosaic.tty
+
+public actual class TtyReactor private constructor(
+	private var reactorPtr: Long,
+) : AutoCloseable {
+	public actual companion object {
+		@JvmStatic
+		public actual fun create(): TtyReactor {
+			val reactorPtr = NativeBackend.INSTANCE.ttyReactorInit()
+			if (reactorPtr != 0L) {
+				return TtyReactor(reactorPtr)
+			}
+			throw OutOfMemoryError()
+		}
+	}
+
+	public actual fun add(tty: Tty) {
+		NativeBackend.INSTANCE.ttyReactorAdd(reactorPtr, tty.nativePtr)
+	}
+
+	public actual fun remove(tty: Tty) {
+		NativeBackend.INSTANCE.ttyReactorRemove(reactorPtr, tty.nativePtr)
+	}
+
+	actual override fun close() {
+		if (reactorPtr != 0L) {
+			NativeBackend.INSTANCE.ttyReactorFree(reactorPtr)
+			reactorPtr = 0
+		}
+	}
+}
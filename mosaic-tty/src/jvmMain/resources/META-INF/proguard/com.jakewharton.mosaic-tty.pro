@@ -5,7 +5,15 @@
 
 -keepdirectories jni
 
-# These members are interacted with through native code.
--keep interface com.jakewharton.mosaic.tty.Tty$Callback {
-	<methods>;
+# This type is passed to and its members are interacted with through native code.
+-keep class com.jakewharton.mosaic.tty.EventDispatcher {
+	void onEvents();
+}
+
+# The FFM backend is loaded reflectively, and its upcall targets are looked up by name.
+-keep class com.jakewharton.mosaic.tty.FfmBackend {
+	static com.jakewharton.mosaic.tty.FfmBackend create(boolean);
+}
+-keepclassmembers class com.jakewharton.mosaic.tty.FfmBackend$Upcalls {
+	void on*(...);
 }
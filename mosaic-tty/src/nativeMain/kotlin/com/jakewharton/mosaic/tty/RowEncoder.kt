@@ -0,0 +1,29 @@
+package com.jakewharton.mosaic.tty
+
+import kotlinx.cinterop.addressOf
+import kotlinx.cinterop.usePinned
+
+internal actual fun rowEncoderEncode(
+	codePoints: IntArray,
+	attributes: IntArray,
+	offset: Int,
+	count: Int,
+	flags: Int,
+	output: ByteArray,
+	outputOffset: Int,
+): Int {
+	// Pinning is cheap, and all three arrays are only accessed for the duration of the call.
+	codePoints.asUIntArray().usePinned { codePointsPin ->
+		attributes.asUIntArray().usePinned { attributesPin ->
+			output.asUByteArray().usePinned { outputPin ->
+				return rowEncoder_encode(
+					codePointsPin.addressOf(offset),
+					attributesPin.addressOf(offset * RowEncoder.AttributeCount),
+					count,
+					flags.toUInt(),
+					outputPin.addressOf(outputOffset),
+				)
+			}
+		}
+	}
+}
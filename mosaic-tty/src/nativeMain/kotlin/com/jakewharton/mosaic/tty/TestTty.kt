@@ -37,6 +37,15 @@ public actual class TestTty private constructor(
 		}
 	}
 
+	public actual fun readOutput(buffer: ByteArray, offset: Int, count: Int): Int {
+		buffer.asUByteArray().usePinned {
+			testTty_readOutput(ptr, it.addressOf(offset), count).useContents {
+				if (error == 0U) return this.count
+				throwIse(error)
+			}
+		}
+	}
+
 	public actual fun focusEvent(focused: Boolean) {
 		testTty_focusEvent(ptr, focused)
 	}
@@ -2,13 +2,19 @@ package com.jakewharton.mosaic.tty
 
 import kotlinx.cinterop.COpaquePointer
 import kotlinx.cinterop.CPointer
+import kotlinx.cinterop.CPointerVar
 import kotlinx.cinterop.NativePlacement
 import kotlinx.cinterop.StableRef
+import kotlinx.cinterop.UByteVar
 import kotlinx.cinterop.addressOf
 import kotlinx.cinterop.alloc
+import kotlinx.cinterop.allocArray
 import kotlinx.cinterop.asStableRef
 import kotlinx.cinterop.free
+import kotlinx.cinterop.get
+import kotlinx.cinterop.memScoped
 import kotlinx.cinterop.nativeHeap
+import kotlinx.cinterop.pin
 import kotlinx.cinterop.ptr
 import kotlinx.cinterop.staticCFunction
 import kotlinx.cinterop.useContents
@@ -32,10 +38,27 @@ public actual class Tty internal constructor(
 				throw OutOfMemoryError()
 			}
 		}
+
+		public actual fun bind(inputFd: Int, outputFd: Int, errorFd: Int): Tty {
+			tty_initWithFds(inputFd, outputFd, errorFd).useContents {
+				tty?.let { ttyPtr ->
+					return Tty(ttyPtr)
+				}
+				if (error != 0U) {
+					throwIse(error)
+				}
+				throw OutOfMemoryError()
+			}
+		}
+
+		public actual fun monotonicNanos(): Long {
+			return tty_monotonicNanos()
+		}
 	}
 
 	private var ptr: CPointer<MosaicTty>? = ptr
-	private var callbackPtrAndRef: Pair<CPointer<MosaicTtyCallback>, StableRef<Callback>>? = null
+	internal val nativePtr: CPointer<MosaicTty>? get() = ptr
+	private var callbackPtrAndRef: Pair<CPointer<MosaicTtyCallback>, StableRef<EventDispatcher>>? = null
 
 	public actual fun setCallback(callback: Callback?) {
 		callbackPtrAndRef?.let { (callbackPtr, callbackRef) ->
@@ -45,7 +68,7 @@ public actual class Tty internal constructor(
 		}
 
 		val callbackPtr = callback?.let { callback ->
-			val callbackRef = StableRef.create(callback)
+			val callbackRef = StableRef.create(EventDispatcher(ptr!!, callback))
 			val callbackPtr = callbackRef.toNativeAllocationIn(nativeHeap).ptr
 
 			callbackPtrAndRef = callbackPtr to callbackRef
@@ -73,6 +96,21 @@ public actual class Tty internal constructor(
 		}
 	}
 
+	public actual fun readInputUntil(
+		buffer: ByteArray,
+		offset: Int,
+		count: Int,
+		minCount: Int,
+		deadlineNanos: Long,
+	): Int {
+		buffer.asUByteArray().usePinned {
+			tty_readInputUntil(ptr, it.addressOf(offset), count, minCount, deadlineNanos).useContents {
+				if (error == 0U) return this.count
+				throwIse(error)
+			}
+		}
+	}
+
 	public actual fun interruptRead() {
 		val error = tty_interruptRead(ptr)
 		if (error == 0U) return
@@ -88,6 +126,59 @@ public actual class Tty internal constructor(
 		}
 	}
 
+	public actual fun writeOutput(buffers: Array<ByteArray>, offsets: IntArray, counts: IntArray): Int {
+		checkSegments(buffers, offsets, counts)
+		if (buffers.isEmpty()) return 0
+		val pinned = Array(buffers.size) { buffers[it].asUByteArray().pin() }
+		try {
+			memScoped {
+				val segments = allocArray<CPointerVar<UByteVar>>(buffers.size) { index ->
+					// An empty range may start at the end of its buffer which has no address.
+					value = if (counts[index] == 0) null else pinned[index].addressOf(offsets[index])
+				}
+				counts.usePinned { counts ->
+					tty_writeOutputv(ptr, segments, counts.addressOf(0), buffers.size).useContents {
+						if (error == 0U) return this.count
+						throwIse(error)
+					}
+				}
+			}
+		} finally {
+			for (pin in pinned) {
+				pin.unpin()
+			}
+		}
+	}
+
+	public actual fun bufferOutput(buffer: ByteArray, offset: Int, count: Int): Int {
+		buffer.asUByteArray().usePinned {
+			tty_bufferOutput(ptr, it.addressOf(offset), count).useContents {
+				if (error == 0U) return this.count
+				throwIse(error)
+			}
+		}
+	}
+
+	public actual fun flushOutput(): Int {
+		tty_flushOutput(ptr).useContents {
+			if (error == 0U) return this.count
+			throwIse(error)
+		}
+	}
+
+	public actual fun enableAsyncOutput(capacity: Int) {
+		val error = tty_enableAsyncOutput(ptr, capacity)
+		if (error == 0U) return
+		throwIse(error)
+	}
+
+	public actual fun awaitOutput(timeoutMillis: Int): Int {
+		tty_awaitOutput(ptr, timeoutMillis).useContents {
+			if (error == 0U) return this.count
+			throwIse(error)
+		}
+	}
+
 	public actual fun writeError(buffer: ByteArray, offset: Int, count: Int): Int {
 		buffer.asUByteArray().usePinned {
 			tty_writeError(ptr, it.addressOf(offset), count).useContents {
@@ -109,6 +200,11 @@ public actual class Tty internal constructor(
 		throwIse(error)
 	}
 
+	public actual fun enableIoUring(): Boolean {
+		// Any error leaves the default implementation in place.
+		return tty_enableIoUring(ptr) == 0U
+	}
+
 	public actual fun currentSize(): IntArray {
 		tty_currentTerminalSize(ptr).useContents {
 			if (error == 0U) {
@@ -140,6 +236,7 @@ public actual class Tty internal constructor(
 		public actual fun onKey()
 		public actual fun onMouse()
 		public actual fun onResize(columns: Int, rows: Int, width: Int, height: Int)
+		public actual fun onInput()
 	}
 }
 
@@ -147,32 +244,49 @@ internal fun throwIse(error: UInt): Nothing {
 	throw IllegalStateException(error.toString())
 }
 
-internal fun StableRef<Tty.Callback>.toNativeAllocationIn(memory: NativePlacement): MosaicTtyCallback {
-	return memory.alloc<MosaicTtyCallback> {
-		opaque = asCPointer()
-		onFocus = staticCFunction(::onFocusCallback)
-		onKey = staticCFunction(::onKeyCallback)
-		onMouse = staticCFunction(::onMouseCallback)
-		onResize = staticCFunction(::onResizeCallback)
+/** Drains the events queued by the native library and dispatches them to [callback]. */
+internal class EventDispatcher(
+	private val ttyPtr: CPointer<MosaicTty>,
+	private val callback: Tty.Callback,
+) {
+	fun onEvents() {
+		// Events may be queued by multiple threads, so each drain uses its own memory.
+		memScoped {
+			val events = allocArray<MosaicTtyEvent>(EVENT_COUNT)
+			do {
+				val count = tty_readEvents(ttyPtr, events, EVENT_COUNT)
+				for (i in 0 until count) {
+					val event = events[i]
+					when (event.type) {
+						MOSAIC_TTY_EVENT_FOCUS -> callback.onFocus(event.values[0] != 0)
+						MOSAIC_TTY_EVENT_KEY -> callback.onKey()
+						MOSAIC_TTY_EVENT_MOUSE -> callback.onMouse()
+						MOSAIC_TTY_EVENT_RESIZE -> {
+							val values = event.values
+							callback.onResize(values[0], values[1], values[2], values[3])
+						}
+						MOSAIC_TTY_EVENT_INPUT -> callback.onInput()
+						else -> throw IllegalStateException("Unknown event type ${event.type}")
+					}
+				}
+			} while (count == EVENT_COUNT)
+		}
 	}
-}
-
-private fun onFocusCallback(opaque: COpaquePointer?, focused: Boolean) {
-	val callback = opaque!!.asStableRef<Tty.Callback>().get()
-	callback.onFocus(focused)
-}
 
-private fun onKeyCallback(opaque: COpaquePointer?) {
-	val callback = opaque!!.asStableRef<Tty.Callback>().get()
-	callback.onKey()
+	private companion object {
+		/** Matches the capacity of the native queue so it can always be drained in one call. */
+		const val EVENT_COUNT = 64
+	}
 }
 
-private fun onMouseCallback(opaque: COpaquePointer?) {
-	val callback = opaque!!.asStableRef<Tty.Callback>().get()
-	callback.onMouse()
+internal fun StableRef<EventDispatcher>.toNativeAllocationIn(memory: NativePlacement): MosaicTtyCallback {
+	return memory.alloc<MosaicTtyCallback> {
+		opaque = asCPointer()
+		onEvents = staticCFunction(::onEventsCallback)
+	}
 }
 
-private fun onResizeCallback(opaque: COpaquePointer?, columns: Int, rows: Int, width: Int, height: Int) {
-	val callback = opaque!!.asStableRef<Tty.Callback>().get()
-	callback.onResize(columns, rows, width, height)
+private fun onEventsCallback(opaque: COpaquePointer?) {
+	val dispatcher = opaque!!.asStableRef<EventDispatcher>().get()
+	dispatcher.onEvents()
 }
@@ -0,0 +1,46 @@
+package com.jakewharton.mosaic.tty
+
+import kotlinx.cinterop.CPointer
+import kotlinx.cinterop.useContents
+
+public actual class TtyReactor private constructor(
+	ptr: CPointer<MosaicTtyReactor>,
+) : AutoCloseable {
+	public actual companion object {
+		public actual fun create(): TtyReactor {
+			ttyReactor_init().useContents {
+				reactor?.let { reactorPtr ->
+					return TtyReactor(reactorPtr)
+				}
+				if (error != 0U) {
+					throwIse(error)
+				}
+				throw OutOfMemoryError()
+			}
+		}
+	}
+
+	private var ptr: CPointer<MosaicTtyReactor>? = ptr
+
+	public actual fun add(tty: Tty) {
+		val error = ttyReactor_add(ptr, tty.nativePtr)
+		if (error == 0U) return
+		throwIse(error)
+	}
+
+	public actual fun remove(tty: Tty) {
+		val error = ttyReactor_remove(ptr, tty.nativePtr)
+		if (error == 0U) return
+		throwIse(error)
+	}
+
+	actual override fun close() {
+		ptr?.let { ptr ->
+			this.ptr = null
+
+			val error = ttyReactor_free(ptr)
+			if (error == 0U) return
+			throwIse(error)
+		}
+	}
+}
@@ -0,0 +1,129 @@
+@file:JvmName("Main")
+
+package example
+
+import com.github.ajalt.clikt.core.CliktCommand
+import com.github.ajalt.clikt.core.main
+import com.github.ajalt.clikt.parameters.options.default
+import com.github.ajalt.clikt.parameters.options.option
+import com.github.ajalt.clikt.parameters.types.int
+import com.jakewharton.mosaic.terminal.TerminalParser
+import com.jakewharton.mosaic.terminal.event.KeyboardEvent
+import com.jakewharton.mosaic.terminal.event.KeyboardEvent.Companion.ModifierCtrl
+import com.jakewharton.mosaic.tty.TestTty
+import kotlin.jvm.JvmName
+import kotlin.time.Duration
+import kotlin.time.TimeSource
+import kotlinx.coroutines.Dispatchers
+import kotlinx.coroutines.coroutineScope
+import kotlinx.coroutines.launch
+import kotlinx.coroutines.runBlocking
+
+fun main(vararg args: String) = ParserBenchmarkCommand().main(args)
+
+/**
+ * Replays recorded input sessions through [TerminalParser] with and without
+ * [TerminalParser.scanWithStateMachine] and reports the time taken per byte.
+ *
+ * Sessions mirror input recorded with `raw-mode-echo`, and each ends with <kbd>Ctrl</kbd>+<kbd>C</kbd>
+ * which is used to detect the end of a replay. Input is written to the TTY in small chunks from
+ * another thread so that sequences regularly span multiple reads.
+ */
+private class ParserBenchmarkCommand : CliktCommand("parser-benchmark") {
+	private val warmups by option().int().default(200)
+	private val iterations by option().int().default(1_000)
+	private val chunkSize by option(help = "Number of bytes written to the TTY at a time")
+		.int()
+		.default(16)
+
+	override fun run() = runBlocking {
+		println("session          legacy ns/byte  state machine ns/byte")
+		for ((name, session) in sessions) {
+			val bytes = session.encodeToByteArray()
+			val legacy = benchmark(bytes, stateMachine = false)
+			val stateMachine = benchmark(bytes, stateMachine = true)
+			println(
+				name.padEnd(17) +
+					legacy.nanosPerByte(bytes.size).padStart(14) +
+					stateMachine.nanosPerByte(bytes.size).padStart(23),
+			)
+		}
+	}
+
+	private suspend fun benchmark(bytes: ByteArray, stateMachine: Boolean): Duration {
+		TestTty.create().use { testTty ->
+			val parser = TerminalParser(testTty.tty)
+			parser.scanWithStateMachine = stateMachine
+
+			repeat(warmups) {
+				replay(testTty, parser, bytes)
+			}
+			val start = TimeSource.Monotonic.markNow()
+			repeat(iterations) {
+				replay(testTty, parser, bytes)
+			}
+			return start.elapsedNow() / iterations
+		}
+	}
+
+	private suspend fun replay(testTty: TestTty, parser: TerminalParser, bytes: ByteArray) {
+		coroutineScope {
+			launch(Dispatchers.Default) {
+				var offset = 0
+				while (offset < bytes.size) {
+					offset += testTty.writeInput(bytes, offset, minOf(chunkSize, bytes.size - offset))
+				}
+			}
+			while (true) {
+				val event = parser.next() ?: error("Unexpected interrupt")
+				if (event is KeyboardEvent && event.codepoint == 'c'.code && event.modifiers == ModifierCtrl) {
+					break
+				}
+			}
+		}
+	}
+
+	private fun Duration.nanosPerByte(byteCount: Int): String {
+		val nanos = inWholeNanoseconds.toDouble() / byteCount
+		return ((nanos * 100).toLong() / 100.0).toString()
+	}
+}
+
+private val sessions = listOf(
+	"startup" to buildString {
+		append("\u001b[?62;22c") // Primary device attributes
+		append("\u001bP!|7B06F855\u001b\\") // Tertiary device attributes
+		append("\u001b[0n") // Operating status
+		append("\u001bP>|kitty(0.40.1)\u001b\\") // Terminal version
+		append("\u001b[?1004;2\$y") // Focus mode report
+		append("\u001b[?0u") // Kitty keyboard query
+		append("\u001b[?2048;1\$y") // In-band resize mode report
+		append("\u001b[48;24;80;480;640t") // In-band resize
+		append("\u001b[?997;1n") // System theme
+		append("\u0003")
+	},
+	"typing" to buildString {
+		repeat(50) {
+			append("hello world\u007f\u007f\r")
+			append("\u001b[A") // Up
+			append("\u001b[1;5D") // Ctrl+Left
+			append("\u001ba") // Alt+A
+		}
+		append("\u0003")
+	},
+	"mouse drag" to buildString {
+		append("\u001b[<0;10;20M")
+		for (x in 11..200) {
+			append("\u001b[<32;$x;20M")
+		}
+		append("\u001b[<0;200;20m")
+		append("\u0003")
+	},
+	"colors query" to buildString {
+		// Responses to the palette queries performed by raw-mode-echo.
+		for (i in 0 until 256) {
+			append("\u001b]4;$i;rgb:ffff/8080/0000\u001b\\")
+		}
+		append("\u0003")
+	},
+)
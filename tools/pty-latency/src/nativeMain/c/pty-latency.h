@@ -0,0 +1,136 @@
+#ifndef PTY_LATENCY_H
+#define PTY_LATENCY_H
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <util.h>
+#else
+#include <pty.h>
+#endif
+
+// These live in this header rather than in Kotlin because the child side of the fork must only
+// make async-signal-safe calls before exec, and the Kotlin runtime makes no such guarantee.
+
+/**
+ * Run argv[0] (searched for on the PATH) in a new session whose controlling terminal is a pty of
+ * the specified size. The master side of the pty is stored in masterFd.
+ *
+ * Returns the child's process ID, or -1 with errno set on failure.
+ */
+static pid_t pty_spawn(char *const argv[], int columns, int rows, int *masterFd) {
+	struct winsize size = {
+		.ws_row = (unsigned short) rows,
+		.ws_col = (unsigned short) columns,
+	};
+	pid_t pid = forkpty(masterFd, NULL, NULL, &size);
+	if (pid == 0) {
+		execvp(argv[0], argv);
+		_exit(127);
+	}
+	return pid;
+}
+
+/**
+ * Change the size of the pty. The kernel sends SIGWINCH to the foreground process group of the
+ * child's session, exactly as when a terminal emulator window is resized.
+ *
+ * Returns 0, or -1 with errno set on failure.
+ */
+static int pty_resize(int masterFd, int columns, int rows) {
+	struct winsize size = {
+		.ws_row = (unsigned short) rows,
+		.ws_col = (unsigned short) columns,
+	};
+	return ioctl(masterFd, TIOCSWINSZ, &size);
+}
+
+/**
+ * Read up to count bytes of the child's output, waiting at most timeoutMillis for some to arrive.
+ *
+ * Returns the number of bytes read, 0 if the timeout elapsed, or -1 if the child closed the pty or
+ * on failure. errno is 0 in the former case.
+ */
+static int pty_read(int masterFd, uint8_t *buffer, int count, int timeoutMillis) {
+	struct pollfd fds[1] = {
+		{ .fd = masterFd, .events = POLLIN },
+	};
+	int polled;
+	do {
+		polled = poll(fds, 1, timeoutMillis);
+	} while (polled == -1 && errno == EINTR);
+	if (polled <= 0) {
+		return polled;
+	}
+
+	ssize_t bytesRead;
+	do {
+		bytesRead = read(masterFd, buffer, count);
+	} while (bytesRead == -1 && errno == EINTR);
+	if (bytesRead > 0) {
+		return (int) bytesRead;
+	}
+	// Linux reports EIO rather than end-of-file once every slave descriptor is closed.
+	if (bytesRead == 0 || errno == EIO) {
+		errno = 0;
+	}
+	return -1;
+}
+
+/**
+ * Write all count bytes as input to the child.
+ *
+ * Returns 0, or -1 with errno set on failure.
+ */
+static int pty_write(int masterFd, const uint8_t *buffer, int count) {
+	while (count > 0) {
+		ssize_t written = write(masterFd, buffer, count);
+		if (written == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return -1;
+		}
+		buffer += written;
+		count -= (int) written;
+	}
+	return 0;
+}
+
+/**
+ * Terminate the child with SIGTERM, wait for it to exit, and close the pty.
+ *
+ * Returns 0, or -1 with errno set on failure.
+ */
+static int pty_free(pid_t pid, int masterFd) {
+	int result = 0;
+	if (kill(pid, SIGTERM) == -1 && errno != ESRCH) {
+		result = -1;
+	}
+	// Keep draining output so the child never blocks writing while trying to exit.
+	uint8_t buffer[1024];
+	while (pty_read(masterFd, buffer, sizeof(buffer), 1000) > 0) {
+	}
+	int status;
+	while (waitpid(pid, &status, 0) == -1) {
+		if (errno != EINTR) {
+			result = -1;
+			break;
+		}
+	}
+	if (close(masterFd) == -1) {
+		result = -1;
+	}
+	return result;
+}
+
+#endif // PTY_LATENCY_H
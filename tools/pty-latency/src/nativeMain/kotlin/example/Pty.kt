@@ -0,0 +1,77 @@
+package example
+
+import com.github.ajalt.clikt.core.CliktError
+import example.pty.pty_free
+import example.pty.pty_read
+import example.pty.pty_resize
+import example.pty.pty_spawn
+import example.pty.pty_write
+import kotlinx.cinterop.IntVar
+import kotlinx.cinterop.addressOf
+import kotlinx.cinterop.alloc
+import kotlinx.cinterop.allocArrayOf
+import kotlinx.cinterop.cstr
+import kotlinx.cinterop.memScoped
+import kotlinx.cinterop.ptr
+import kotlinx.cinterop.toKString
+import kotlinx.cinterop.usePinned
+import kotlinx.cinterop.value
+import platform.posix.errno
+import platform.posix.strerror
+
+/** A child process whose controlling terminal is a pseudoterminal. See pty-latency.h. */
+internal class Pty private constructor(
+	private val pid: Int,
+	private val masterFd: Int,
+) : AutoCloseable {
+	companion object {
+		fun spawn(command: List<String>, columns: Int, rows: Int): Pty = memScoped {
+			val argv = allocArrayOf(command.map { it.cstr.ptr } + null)
+			val masterFd = alloc<IntVar>()
+			val pid = pty_spawn(argv, columns, rows, masterFd.ptr)
+			if (pid == -1) {
+				throwErrno("forkpty")
+			}
+			Pty(pid, masterFd.value)
+		}
+	}
+
+	/** Returns the number of bytes read, or 0 if none arrived within [timeoutMillis]. */
+	fun read(buffer: ByteArray, timeoutMillis: Int): Int {
+		val read = buffer.asUByteArray().usePinned {
+			pty_read(masterFd, it.addressOf(0), buffer.size, timeoutMillis)
+		}
+		if (read == -1) {
+			if (errno == 0) {
+				throw CliktError("Command exited")
+			}
+			throwErrno("read")
+		}
+		return read
+	}
+
+	fun write(bytes: ByteArray) {
+		val result = bytes.asUByteArray().usePinned {
+			pty_write(masterFd, it.addressOf(0), bytes.size)
+		}
+		if (result == -1) {
+			throwErrno("write")
+		}
+	}
+
+	fun resize(columns: Int, rows: Int) {
+		if (pty_resize(masterFd, columns, rows) == -1) {
+			throwErrno("ioctl(TIOCSWINSZ)")
+		}
+	}
+
+	override fun close() {
+		if (pty_free(pid, masterFd) == -1) {
+			throwErrno("close")
+		}
+	}
+}
+
+private fun throwErrno(operation: String): Nothing {
+	throw CliktError("$operation failed: ${strerror(errno)?.toKString()}")
+}
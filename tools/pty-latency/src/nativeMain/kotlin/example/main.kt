@@ -0,0 +1,212 @@
+package example
+
+import com.github.ajalt.clikt.core.CliktCommand
+import com.github.ajalt.clikt.core.CliktError
+import com.github.ajalt.clikt.core.ProgramResult
+import com.github.ajalt.clikt.core.main
+import com.github.ajalt.clikt.parameters.arguments.argument
+import com.github.ajalt.clikt.parameters.arguments.multiple
+import com.github.ajalt.clikt.parameters.options.default
+import com.github.ajalt.clikt.parameters.options.multiple
+import com.github.ajalt.clikt.parameters.options.option
+import com.github.ajalt.clikt.parameters.types.double
+import com.github.ajalt.clikt.parameters.types.int
+import kotlin.math.roundToInt
+import kotlin.time.Duration
+import kotlin.time.Duration.Companion.microseconds
+import kotlin.time.Duration.Companion.milliseconds
+import kotlin.time.DurationUnit.MILLISECONDS
+import kotlin.time.TimeSource
+
+fun main(vararg args: String) = PtyLatencyCommand().main(args)
+
+/**
+ * Runs a program under a real pseudoterminal and measures the time from writing input to the
+ * resulting frame being written as output, the time to render the first frame on startup, and
+ * (with `--resizes`) the time from a window resize to the resulting frame.
+ *
+ * The harness acts as the terminal emulator. It answers the primary device attributes and device
+ * status queries which Mosaic sends while bootstrapping, but no others, so the program sees a
+ * basic VT220-like terminal. Window resizes change the pty size which causes the kernel to send
+ * `SIGWINCH`, exactly like resizing a terminal window.
+ *
+ * A frame is considered complete once no output has arrived for `--settle` milliseconds. Use a
+ * program whose output only changes in response to input, such as `samples/robot` whose face the
+ * default input moves right and then left:
+ *
+ * ```
+ * $ ./gradlew :samples:robot:linkReleaseExecutableLinuxX64 :tools:pty-latency:linkReleaseExecutableLinuxX64
+ * $ tools/pty-latency/build/bin/linuxX64/releaseExecutable/pty-latency.kexe \
+ *     samples/robot/build/bin/linuxX64/releaseExecutable/robot.kexe
+ * ```
+ */
+private class PtyLatencyCommand : CliktCommand("pty-latency") {
+	private val columns by option().int().default(80)
+	private val rows by option().int().default(24)
+	private val warmups by option().int().default(20)
+	private val iterations by option().int().default(200)
+	private val input by option(help = "Input written for each iteration, cycled in order. '\\e' is an escape.")
+		.multiple(default = listOf("\\e[C", "\\e[D"))
+	private val resizes by option(help = "Number of window resizes to measure").int().default(0)
+	private val settleMillis by option("--settle", help = "Milliseconds without output after which a frame is complete")
+		.int()
+		.default(50)
+	private val timeoutMillis by option("--timeout", help = "Milliseconds to wait for output before giving up")
+		.int()
+		.default(2_000)
+	private val maxP99Millis by option("--max-p99", help = "Fail if the 99th percentile input latency exceeds this many milliseconds")
+		.double()
+	private val command by argument().multiple(required = true)
+
+	override fun run() {
+		val inputs = input.map { it.replace("\\e", "\u001b").encodeToByteArray() }
+
+		val startupMark = TimeSource.Monotonic.markNow()
+		Pty.spawn(command, columns, rows).use { pty ->
+			val startup = awaitFrame(pty, startupMark)
+				?: throw CliktError("No output within $timeoutMillis ms of starting")
+			println("startup: ${startup.lastByte.format()} (${startup.bytes} bytes)")
+			println()
+
+			val inputHistogram = Histogram("input")
+			repeat(warmups + iterations) { iteration ->
+				val mark = TimeSource.Monotonic.markNow()
+				pty.write(inputs[iteration % inputs.size])
+				val frame = awaitFrame(pty, mark)
+				if (iteration >= warmups) {
+					inputHistogram += frame
+				}
+			}
+			inputHistogram.print()
+
+			if (resizes > 0) {
+				val resizeHistogram = Histogram("resize")
+				repeat(resizes) { iteration ->
+					// Alternate between one smaller and the original size so each resize is a change.
+					val shrink = if (iteration % 2 == 0) 1 else 0
+					val mark = TimeSource.Monotonic.markNow()
+					pty.resize(columns - shrink, rows - shrink)
+					resizeHistogram += awaitFrame(pty, mark)
+				}
+				println()
+				resizeHistogram.print()
+			}
+
+			val maxP99Millis = maxP99Millis
+			if (maxP99Millis != null && inputHistogram.percentile(0.99) > maxP99Millis.milliseconds) {
+				echo("input p99 exceeds ${maxP99Millis}ms", err = true)
+				throw ProgramResult(1)
+			}
+		}
+	}
+
+	private val buffer = ByteArray(8192)
+	private val queries = QueryResponder()
+
+	/**
+	 * Read output until none has arrived for [settleMillis], answering any bootstrap queries along
+	 * the way. Returns null if there was no output within [timeoutMillis].
+	 */
+	private fun awaitFrame(pty: Pty, start: TimeSource.Monotonic.ValueTimeMark): Frame? {
+		var firstByte: Duration? = null
+		var lastByte = Duration.ZERO
+		var bytes = 0
+		while (true) {
+			val read = pty.read(buffer, if (firstByte == null) timeoutMillis else settleMillis)
+			if (read == 0) break
+
+			lastByte = start.elapsedNow()
+			if (firstByte == null) {
+				firstByte = lastByte
+			}
+			bytes += read
+
+			queries.respond(pty, buffer, read)
+		}
+		return firstByte?.let { Frame(it, lastByte, bytes) }
+	}
+}
+
+private class Frame(
+	val firstByte: Duration,
+	val lastByte: Duration,
+	val bytes: Int,
+)
+
+/** Answers the queries which Mosaic waits on while bootstrapping, even if split across reads. */
+private class QueryResponder {
+	private var tail = ""
+
+	fun respond(pty: Pty, buffer: ByteArray, count: Int) {
+		val output = tail + buffer.decodeToString(endIndex = count)
+		var index = 0
+		while (true) {
+			val escape = output.indexOf('\u001b', index)
+			if (escape == -1) break
+			val reply = when {
+				output.startsWith("\u001b[c", escape) || output.startsWith("\u001b[0c", escape) -> "\u001b[?62c"
+				output.startsWith("\u001b[5n", escape) -> "\u001b[0n"
+				else -> null
+			}
+			if (reply != null) {
+				pty.write(reply.encodeToByteArray())
+			}
+			index = escape + 1
+		}
+		// Retain a trailing partial query so it can be matched once the rest of it is read.
+		val lastEscape = output.lastIndexOf('\u001b')
+		tail = if (lastEscape != -1 && output.length - lastEscape < 4 && !output.endsWith("\u001b[c")) {
+			output.substring(lastEscape)
+		} else {
+			""
+		}
+	}
+}
+
+private class Histogram(private val name: String) {
+	private val samples = mutableListOf<Duration>()
+	private var bytes = 0L
+	private var timeouts = 0
+
+	operator fun plusAssign(frame: Frame?) {
+		if (frame == null) {
+			timeouts++
+		} else {
+			samples += frame.lastByte
+			bytes += frame.bytes
+		}
+	}
+
+	fun percentile(fraction: Double): Duration {
+		if (samples.isEmpty()) return Duration.ZERO
+		samples.sort()
+		return samples[((samples.size - 1) * fraction).roundToInt()]
+	}
+
+	fun print() {
+		println("$name: ${samples.size} frames, $timeouts without output")
+		if (samples.isEmpty()) return
+
+		println(
+			"  min ${percentile(0.0).format()}" +
+				"  p50 ${percentile(0.5).format()}" +
+				"  p90 ${percentile(0.9).format()}" +
+				"  p99 ${percentile(0.99).format()}" +
+				"  max ${percentile(1.0).format()}" +
+				"  ${bytes / samples.size} bytes/frame",
+		)
+
+		// Power-of-two buckets of microseconds keep both fast and pathological frames readable.
+		val buckets = samples.groupingBy { 63 - it.inWholeMicroseconds.coerceAtLeast(1).countLeadingZeroBits() }
+			.eachCount()
+		val largest = buckets.values.max()
+		for (bucket in buckets.keys.min()..buckets.keys.max()) {
+			val count = buckets[bucket] ?: 0
+			val label = "≥ ${(1L shl bucket).microseconds.format()}".padStart(12)
+			val bar = "#".repeat((count * 40 + largest - 1) / largest)
+			println("  $label ${bar.padEnd(40)} $count")
+		}
+	}
+}
+
+private fun Duration.format() = toString(MILLISECONDS, decimals = 3)
@@ -0,0 +1,92 @@
+@file:JvmName("Main")
+
+package example
+
+import com.github.ajalt.clikt.core.CliktCommand
+import com.github.ajalt.clikt.core.main
+import com.github.ajalt.clikt.parameters.options.default
+import com.github.ajalt.clikt.parameters.options.option
+import com.github.ajalt.clikt.parameters.types.int
+import com.jakewharton.mosaic.tty.TestTty
+import kotlin.jvm.JvmName
+import kotlin.time.Duration
+import kotlin.time.TimeSource
+
+fun main(vararg args: String) = TtyBenchmarkCommand().main(args)
+
+/**
+ * Measures the cost of a round-trip through the TTY bindings: a [TestTty.writeInput] followed by
+ * [com.jakewharton.mosaic.tty.Tty.readInput] calls until the same bytes are received.
+ *
+ * Small sizes are dominated by the per-call overhead of crossing into native code, while larger
+ * sizes show the cost of moving the bytes between managed and native memory.
+ *
+ * On the JVM, compare the JNI and FFM bindings by running with the system property
+ * `com.jakewharton.mosaic.tty.backend` set to `jni` or `ffm` (the latter also requires
+ * `--enable-native-access=ALL-UNNAMED` to avoid a warning).
+ */
+private class TtyBenchmarkCommand : CliktCommand("tty-benchmark") {
+	private val warmups by option().int().default(10_000)
+	private val iterations by option().int().default(100_000)
+
+	override fun run() {
+		val variants = listOf<RoundTrip>(ByteArrayRoundTrip) + platformRoundTrips()
+
+		println("bytes" + variants.joinToString("") { "${it.name} ns/call".padStart(24) })
+		for (size in sizes) {
+			val line = StringBuilder()
+			line.append(size.toString().padEnd(5))
+			for (variant in variants) {
+				line.append(benchmark(variant, size).nanosPerCall().padStart(24))
+			}
+			println(line)
+		}
+	}
+
+	private fun benchmark(roundTrip: RoundTrip, size: Int): Duration {
+		TestTty.create().use { testTty ->
+			val bytes = ByteArray(size) { 'a'.code.toByte() }
+			repeat(warmups) {
+				roundTrip.run(testTty, bytes)
+			}
+			val start = TimeSource.Monotonic.markNow()
+			repeat(iterations) {
+				roundTrip.run(testTty, bytes)
+			}
+			return start.elapsedNow() / iterations
+		}
+	}
+
+	private fun Duration.nanosPerCall(): String {
+		val nanos = inWholeNanoseconds.toDouble()
+		return ((nanos * 100).toLong() / 100.0).toString()
+	}
+}
+
+private val sizes = listOf(1, 16, 256, 4096)
+
+internal interface RoundTrip {
+	val name: String
+
+	/** Write [bytes] to [testTty] and read them back from its TTY. */
+	fun run(testTty: TestTty, bytes: ByteArray)
+}
+
+private object ByteArrayRoundTrip : RoundTrip {
+	override val name get() = "ByteArray"
+
+	private val incoming = ByteArray(sizes.last())
+
+	override fun run(testTty: TestTty, bytes: ByteArray) {
+		check(testTty.writeInput(bytes, 0, bytes.size) == bytes.size)
+		var offset = 0
+		while (offset < bytes.size) {
+			val read = testTty.tty.readInput(incoming, offset, bytes.size - offset)
+			check(read > 0)
+			offset += read
+		}
+	}
+}
+
+/** Additional ways of reading from the TTY which are only available on this platform. */
+internal expect fun platformRoundTrips(): List<RoundTrip>
@@ -0,0 +1,21 @@
+package example
+
+import com.jakewharton.mosaic.tty.TestTty
+import java.nio.ByteBuffer
+
+internal actual fun platformRoundTrips(): List<RoundTrip> = listOf(DirectByteBufferRoundTrip)
+
+private object DirectByteBufferRoundTrip : RoundTrip {
+	override val name get() = "direct ByteBuffer"
+
+	private val incoming = ByteBuffer.allocateDirect(4096)
+
+	override fun run(testTty: TestTty, bytes: ByteArray) {
+		check(testTty.writeInput(bytes, 0, bytes.size) == bytes.size)
+		val incoming = incoming
+		incoming.clear().limit(bytes.size)
+		while (incoming.hasRemaining()) {
+			check(testTty.tty.readInput(incoming) > 0)
+		}
+	}
+}
@@ -0,0 +1,3 @@
+package example
+
+internal actual fun platformRoundTrips(): List<RoundTrip> = emptyList()